@@ -28,7 +28,7 @@ class AppProvenanceElastic : public ElasticSearchBase {
 public:
   AppProvenanceElastic(const HttpClientConfig elastic_client_config, std::string index,
           int time_to_wait_before_inserting, int bulk_size,
-          const bool stats, SConn conn);
+          int max_in_flight_batches, const bool stats, SConn conn);
 
   virtual ~AppProvenanceElastic();
 private:
@@ -36,8 +36,10 @@ private:
   std::string mElasticBulkAddr;
   SConn mConn;
 
-  virtual void process(std::vector<eBulk>* bulks);
+  virtual bool send(std::vector<eBulk>* bulks);
+  virtual void acknowledge(std::vector<eBulk>* bulks, bool sent, ptime start_time);
   bool bulkRequest(eEvent& event);
+  int removeLogs(std::vector<const LogHandler*>& handlers) override;
 };
 
 #endif /* APPPROVENANCEELASTIC_H */
\ No newline at end of file
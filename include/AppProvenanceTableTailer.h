@@ -33,11 +33,10 @@ private:
   virtual void handleEvent(NdbDictionary::Event::TableEvent eventType, AppProvenanceRow pre, AppProvenanceRow row);
   void barrierChanged();
 
-  void pushToQueue(AppPRpq* curr);
+  void pushToQueue(AppPq& rows);
 
   AppCPRq *mQueue;
-  AppPRpq* mCurrentPriorityQueue;
-  boost::mutex mLock;
+  AppPq mCurrentRows;
 };
 
 
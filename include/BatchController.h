@@ -0,0 +1,163 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef BATCHCONTROLLER_H
+#define BATCHCONTROLLER_H
+
+#include "Batcher.h"
+#include "http/server/MetricsProvider.h"
+
+#define BATCH_MAX_GROWTH 16
+#define BATCH_MIN_WINDOW_MS 1000
+
+/*
+ * Adapts the batch size and the time to wait of the batchers of a pipeline
+ * to keep the end to end latency of the bulks under a target. The batches
+ * grow additively every control window the latency stayed below the target
+ * and are halved once it is exceeded. The stage with the larger service time,
+ * ndb reads or elastic bulk requests, is the one whose batches are halved.
+ * The configured values are the initial settings.
+ */
+class BatchController : public MetricsProvider {
+public:
+
+  enum Stage {
+    Ndb = 0,
+    Elastic = 1
+  };
+
+  BatchController(const std::string pipe_name, const int target_latency_ms,
+      const int max_bulk_bytes) : mPipeName(pipe_name),
+  mTargetLatency(target_latency_ms), mMaxBulkBytes(max_bulk_bytes),
+  mWindowStart(Utils::getCurrentTime()), mMaxLatency(0), mNdbTime(0),
+  mElasticTime(0), mObservations(0), mIncreases(0), mDecreases(0) {
+    LOG_INFO(mPipeName << " batches adapt to a target latency of "
+        << mTargetLatency << " msec");
+  }
+
+  void addBatcher(Batcher* batcher, const Stage stage, const std::string name) {
+    boost::mutex::scoped_lock lock(mLock);
+    ControlledBatcher c;
+    c.mBatcher = batcher;
+    c.mStage = stage;
+    c.mName = name;
+    c.mSizeStep = std::max(batcher->getBatchSize() / 4, 1);
+    c.mMinSize = std::max(batcher->getBatchSize() / 8, 1);
+    c.mMaxSize = stage == Stage::Elastic && mMaxBulkBytes > 0 ? mMaxBulkBytes
+        : batcher->getBatchSize() * BATCH_MAX_GROWTH;
+    c.mMaxSize = std::max(c.mMaxSize, batcher->getBatchSize());
+    c.mWaitStep = std::max(batcher->getTimeToWait() / 4, 1);
+    c.mMinWait = std::max(batcher->getTimeToWait() / 8, 1);
+    c.mMaxWait = std::max(mTargetLatency / 2, c.mMinWait);
+    mBatchers.push_back(c);
+  }
+
+  /*
+   * called for every acknowledged bulk with its end to end latency, the time
+   * its rows were read from ndb and the time of the elastic bulk request.
+   */
+  void observe(const int latency_ms, const int ndb_ms, const int elastic_ms) {
+    boost::mutex::scoped_lock lock(mLock);
+    mMaxLatency = std::max(mMaxLatency, latency_ms);
+    mNdbTime += ndb_ms;
+    mElasticTime += elastic_ms;
+    mObservations++;
+
+    ptime now = Utils::getCurrentTime();
+    if (Utils::getTimeDiffInMilliseconds(mWindowStart, now) <
+        std::max(mTargetLatency, BATCH_MIN_WINDOW_MS)) {
+      return;
+    }
+
+    if (mMaxLatency > mTargetLatency) {
+      Stage slowest = mElasticTime > mNdbTime ? Stage::Elastic : Stage::Ndb;
+      for (ControlledBatcher& c : mBatchers) {
+        Batcher* b = c.mBatcher;
+        b->setTimeToWait(std::max(b->getTimeToWait() / 2, c.mMinWait));
+        if (c.mStage == slowest) {
+          b->setBatchSize(std::max(b->getBatchSize() / 2, c.mMinSize));
+        }
+      }
+      mDecreases++;
+      LOG_DEBUG(mPipeName << " latency " << mMaxLatency << " msec above target,"
+          " decrease the batches of the " << (slowest == Stage::Elastic ?
+          "elastic" : "ndb") << " stage");
+    } else if (mMaxLatency < mTargetLatency - mTargetLatency / 4) {
+      for (ControlledBatcher& c : mBatchers) {
+        Batcher* b = c.mBatcher;
+        b->setTimeToWait(std::min(b->getTimeToWait() + c.mWaitStep, c.mMaxWait));
+        b->setBatchSize(std::min(b->getBatchSize() + c.mSizeStep, c.mMaxSize));
+      }
+      mIncreases++;
+    }
+
+    mWindowStart = now;
+    mMaxLatency = 0;
+    mNdbTime = 0;
+    mElasticTime = 0;
+    mObservations = 0;
+  }
+
+  std::string getMetrics() override {
+    std::stringstream out;
+    boost::mutex::scoped_lock lock(mLock);
+    out << "epipe_" << mPipeName << "_batch_target_latency_milliseconds "
+        << mTargetLatency << std::endl;
+    out << "epipe_" << mPipeName << "_batch_increases_total " << mIncreases
+        << std::endl;
+    out << "epipe_" << mPipeName << "_batch_decreases_total " << mDecreases
+        << std::endl;
+    for (ControlledBatcher& c : mBatchers) {
+      out << "epipe_" << mPipeName << "_batch_size{batcher=\"" << c.mName
+          << "\"} " << c.mBatcher->getBatchSize() << std::endl;
+      out << "epipe_" << mPipeName << "_batch_wait_milliseconds{batcher=\""
+          << c.mName << "\"} " << c.mBatcher->getTimeToWait() << std::endl;
+    }
+    return out.str();
+  }
+
+private:
+  struct ControlledBatcher {
+    Batcher* mBatcher;
+    Stage mStage;
+    std::string mName;
+    int mSizeStep;
+    int mMinSize;
+    int mMaxSize;
+    int mWaitStep;
+    int mMinWait;
+    int mMaxWait;
+  };
+
+  const std::string mPipeName;
+  const int mTargetLatency;
+  const int mMaxBulkBytes;
+  boost::mutex mLock;
+  std::vector<ControlledBatcher> mBatchers;
+
+  ptime mWindowStart;
+  int mMaxLatency;
+  Uint64 mNdbTime;
+  Uint64 mElasticTime;
+  Uint64 mObservations;
+  Uint64 mIncreases;
+  Uint64 mDecreases;
+};
+
+#endif /* BATCHCONTROLLER_H */
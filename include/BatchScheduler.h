@@ -0,0 +1,80 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef BATCHSCHEDULER_H
+#define BATCHSCHEDULER_H
+
+#include "Utils.h"
+#include <boost/asio.hpp>
+
+/*
+ * Process wide scheduler of the batchers flush deadlines. A single thread
+ * runs the deadline timers of all batchers, so the timer handlers must not
+ * block.
+ */
+class BatchScheduler {
+public:
+
+  static BatchScheduler& getInstance() {
+    static BatchScheduler instance;
+    return instance;
+  }
+
+  boost::asio::io_service& getIOService() {
+    return mIOService;
+  }
+
+  void start() {
+    boost::mutex::scoped_lock lock(mLock);
+    if (mStarted) {
+      return;
+    }
+    LOG_INFO("start batch scheduler");
+    mThread = boost::thread(boost::bind(&boost::asio::io_service::run,
+        &mIOService));
+    mStarted = true;
+  }
+
+  template<typename Handler>
+  void post(Handler handler) {
+    mIOService.post(handler);
+  }
+
+  ~BatchScheduler() {
+    mIOService.stop();
+    if (mStarted) {
+      mThread.join();
+    }
+  }
+
+private:
+  BatchScheduler() : mWork(mIOService), mStarted(false) {
+  }
+
+  BatchScheduler(BatchScheduler const&);
+  void operator=(BatchScheduler const&);
+
+  boost::asio::io_service mIOService;
+  boost::asio::io_service::work mWork;
+  boost::mutex mLock;
+  boost::thread mThread;
+  bool mStarted;
+};
+
+#endif /* BATCHSCHEDULER_H */
@@ -21,42 +21,67 @@
 #define BATCHER_H
 
 #include "Utils.h"
-#include <boost/asio.hpp>
+#include "BatchScheduler.h"
+#include <boost/atomic.hpp>
 #include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+/*
+ * A batch is flushed by the batcher thread once it reaches mBatchSize, or
+ * by the shared BatchScheduler once mTimeToWait passed since the last flush.
+ * Both can be adapted at runtime by a BatchController.
+ */
 class Batcher {
 public:
   Batcher(const int time_to_wait, const int batch_size);
   void start();
   void shutdown();
   void waitToFinish();
+
+  int getBatchSize() const {
+    return mBatchSize;
+  }
+
+  int getTimeToWait() const {
+    return mTimeToWait;
+  }
+
+  void setBatchSize(const int batch_size) {
+    mBatchSize = batch_size;
+  }
+
+  void setTimeToWait(const int time_to_wait) {
+    mTimeToWait = time_to_wait;
+  }
+
   virtual ~Batcher();
 
 protected:
   virtual void run() = 0;
   virtual void processBatch() = 0;
+
+  /*
+   * called on the scheduler thread once the deadline expired, batchers
+   * whose processBatch can block have to hand the flush to their own thread.
+   */
+  virtual void timerExpired();
   void resetTimer();
 
-  const int mBatchSize;
-  bool mTimerProcessing;
-  const int mTimeToWait;
+  boost::atomic<int> mBatchSize;
+  boost::atomic<int> mTimeToWait;
 
 private:
   boost::thread mThread;
   bool mStarted;
-  bool mFirstTimer;
-  bool mScheduleShutdown;
-  bool mShutdownTimer;
-  boost::thread mTimerThread;
+  boost::atomic<bool> mScheduleShutdown;
+  bool mTimerStopped;
+  boost::mutex mTimerLock;
+  boost::condition_variable mTimerStoppedCond;
+  boost::asio::deadline_timer mTimer;
 
-  boost::asio::io_service mIOService;
-
-  void startTimer();
-  void timerThread();
-  void timerExpired(const boost::system::error_code& e);
+  void startTimer(int timeout);
+  void timerHandler(const boost::system::error_code& e);
 
 };
 
 #endif /* BATCHER_H */
-
@@ -20,10 +20,11 @@
 #ifndef CACHE_H
 #define CACHE_H
 #include "Utils.h"
-#include "boost/bimap.hpp"
-#include "boost/bimap/list_of.hpp"
-#include "boost/bimap/unordered_set_of.hpp"
 #include "boost/optional.hpp"
+#include "boost/scoped_array.hpp"
+#include "boost/atomic.hpp"
+#include "boost/thread/shared_mutex.hpp"
+#include "boost/thread/locks.hpp"
 
 template<typename T>
 class CacheSingleton {
@@ -41,16 +42,20 @@ private:
   void operator=(CacheSingleton const&);
 };
 
+#define CACHE_MAX_SHARDS 16
+
 /*
- * LRU Cache based on the design described in http://timday.bitbucket.org/lru.html
+ * Concurrent approximate LRU cache. Keys are spread over up to
+ * CACHE_MAX_SHARDS shards, each with its own readers-writer lock, so reader
+ * threads only contend when they hit the same shard and lookups of the same
+ * shard run in parallel. Every shard evicts with the CLOCK algorithm, a hit
+ * only sets the entry referenced bit instead of relocating it in a list.
  */
 template<typename Key, typename Value>
 class Cache {
 public:
 
-  typedef boost::bimaps::bimap<boost::bimaps::unordered_set_of<Key>,
-  boost::bimaps::list_of<Value> > CacheContainer;
-  typedef typename CacheContainer::size_type cache_size_type;
+  typedef std::size_t cache_size_type;
 
   Cache();
   Cache(const int max_capacity);
@@ -63,112 +68,208 @@ public:
   virtual ~Cache();
 
 private:
-  const cache_size_type mCapacity;
-  const char* mTracePrefix;
-  CacheContainer mCache;
 
-  int mHits;
-  int mMisses;
+  struct Entry {
+    Key mKey;
+    Value mValue;
+
+    Entry(Key key, Value value) : mKey(key), mValue(value) {
+    }
+  };
+
+  typedef boost::unordered_map<Key, cache_size_type> ShardIndex;
+
+  struct Shard {
+    boost::shared_mutex mLock;
+    ShardIndex mIndex;
+    std::vector<Entry> mEntries;
+    boost::scoped_array<boost::atomic<bool> > mReferenced;
+    cache_size_type mHand;
 
-  int mEvictions;
-  int mInserts;
+    boost::atomic<Uint64> mHits;
+    boost::atomic<Uint64> mMisses;
+    boost::atomic<Uint64> mEvictions;
+    boost::atomic<Uint64> mInserts;
 
-  mutable boost::mutex mLock;
+    Shard(cache_size_type capacity) : mReferenced(new boost::atomic<bool>[capacity]),
+    mHand(0), mHits(0), mMisses(0), mEvictions(0), mInserts(0) {
+      mEntries.reserve(capacity);
+    }
+  };
+
+  const cache_size_type mCapacity;
+  const char* mTracePrefix;
+  cache_size_type mShardCapacity;
+  int mShardBits;
+  std::vector<Shard*> mShards;
 
+  void init();
+  Shard* getShard(const Key& key);
+  void evict(Shard* shard);
 };
 
 template<typename Key, typename Value>
-Cache<Key, Value>::Cache() : mCapacity(DEFAULT_MAX_CAPACITY), mTracePrefix(""),
-mHits(0), mMisses(0), mEvictions(0), mInserts(0) {
-  LOG_INFO(mTracePrefix << " Cache created with Capacity of " << mCapacity);
+Cache<Key, Value>::Cache() : mCapacity(DEFAULT_MAX_CAPACITY), mTracePrefix("") {
+  init();
 }
 
 template<typename Key, typename Value>
 Cache<Key, Value>::Cache(const int max_capacity) : mCapacity(max_capacity),
-mTracePrefix(""), mHits(0), mMisses(0), mEvictions(0), mInserts(0) {
-  LOG_INFO(mTracePrefix << " Cache created with Capacity of " << mCapacity);
+mTracePrefix("") {
+  init();
 }
 
 template<typename Key, typename Value>
 Cache<Key, Value>::Cache(const int max_capacity, const char* trace_prefix)
-: mCapacity(max_capacity), mTracePrefix(trace_prefix), mHits(0), mMisses(0),
-mEvictions(0), mInserts(0) {
-  LOG_INFO(mTracePrefix << " Cache created with Capacity of " << mCapacity);
+: mCapacity(max_capacity), mTracePrefix(trace_prefix) {
+  init();
+}
+
+template<typename Key, typename Value>
+void Cache<Key, Value>::init() {
+  mShardBits = 0;
+  while ((1u << (mShardBits + 1)) <= CACHE_MAX_SHARDS
+      && (static_cast<cache_size_type>(1) << (mShardBits + 1)) <= mCapacity) {
+    mShardBits++;
+  }
+  cache_size_type numShards = static_cast<cache_size_type>(1) << mShardBits;
+  mShardCapacity = std::max<cache_size_type>(1, (mCapacity + numShards - 1) / numShards);
+  for (cache_size_type i = 0; i < numShards; i++) {
+    mShards.push_back(new Shard(mShardCapacity));
+  }
+  LOG_INFO(mTracePrefix << " Cache created with Capacity of " << mCapacity
+      << " in " << numShards << " shards");
 }
 
 template<typename Key, typename Value>
 Cache<Key, Value>::~Cache() {
+  for (Shard* shard : mShards) {
+    delete shard;
+  }
+}
+
+template<typename Key, typename Value>
+typename Cache<Key, Value>::Shard* Cache<Key, Value>::getShard(const Key& key) {
+  if (mShardBits == 0) {
+    return mShards[0];
+  }
+  // fibonacci hashing, keys are mostly sequential ids
+  Uint64 hash = static_cast<Uint64>(boost::hash<Key>()(key)) * 0x9E3779B97F4A7C15ULL;
+  return mShards[hash >> (64 - mShardBits)];
+}
 
+template<typename Key, typename Value>
+void Cache<Key, Value>::evict(Shard* shard) {
+  //second chance for every referenced entry, terminates within one round
+  while (shard->mReferenced[shard->mHand]) {
+    shard->mReferenced[shard->mHand] = false;
+    shard->mHand = (shard->mHand + 1) % shard->mEntries.size();
+  }
+  LOG_TRACE("EVICT " << mTracePrefix << " [" << shard->mEntries[shard->mHand].mKey << "]");
+  shard->mIndex.erase(shard->mEntries[shard->mHand].mKey);
+  shard->mEvictions++;
 }
 
 template<typename Key, typename Value>
 void Cache<Key, Value>::put(Key key, Value value) {
   LOG_TRACE("PUT " << mTracePrefix << " [" << key << "]");
-  boost::mutex::scoped_lock lock(mLock);
-  const typename CacheContainer::left_iterator it = mCache.left.find(key);
-  if (it == mCache.left.end()) {
+  Shard* shard = getShard(key);
+  boost::unique_lock<boost::shared_mutex> lock(shard->mLock);
+  const typename ShardIndex::iterator it = shard->mIndex.find(key);
+  if (it == shard->mIndex.end()) {
     //new key
-    if (mCache.size() == mCapacity) {
-      LOG_TRACE("EVICT " << mTracePrefix << " [" << mCache.right.begin()->second << "]");
-      mCache.right.erase(mCache.right.begin());
-      mEvictions++;
+    cache_size_type slot;
+    if (shard->mEntries.size() == mShardCapacity) {
+      evict(shard);
+      slot = shard->mHand;
+      shard->mEntries[slot] = Entry(key, value);
+      shard->mHand = (shard->mHand + 1) % shard->mEntries.size();
+    } else {
+      slot = shard->mEntries.size();
+      shard->mEntries.push_back(Entry(key, value));
     }
-    mCache.insert(typename CacheContainer::value_type(key, value));
-    mInserts++;
+    //new entries start unreferenced, only a hit gives them a second chance
+    shard->mReferenced[slot] = false;
+    shard->mIndex[key] = slot;
+    shard->mInserts++;
   } else {
     //update to most recent
-    mCache.right.relocate(mCache.right.end(), mCache.project_right(it));
+    shard->mReferenced[it->second] = true;
   }
 }
 
 template<typename Key, typename Value>
 boost::optional<Value> Cache<Key, Value>::get(Key key) {
   LOG_TRACE("GET " << mTracePrefix << " [" << key << "]");
-  boost::mutex::scoped_lock lock(mLock);
-  const typename CacheContainer::left_iterator it = mCache.left.find(key);
-  if (it != mCache.left.end()) {
+  Shard* shard = getShard(key);
+  boost::shared_lock<boost::shared_mutex> lock(shard->mLock);
+  const typename ShardIndex::const_iterator it = shard->mIndex.find(key);
+  if (it != shard->mIndex.end()) {
     //update to most recent
-    mCache.right.relocate(mCache.right.end(), mCache.project_right(it));
-    mHits++;
-    return it->second;
+    shard->mReferenced[it->second] = true;
+    shard->mHits++;
+    return shard->mEntries[it->second].mValue;
   }
-  mMisses++;
+  shard->mMisses++;
   return boost::none;
 }
 
 template<typename Key, typename Value>
 void Cache<Key, Value>::remove(Key key) {
-  LOG_TRACE("REMOVE " << mTracePrefix << " [" << key << "] " << (mCache.size() - 1) << "/" << mCapacity);
-  boost::mutex::scoped_lock lock(mLock);
-  const typename CacheContainer::left_iterator it = mCache.left.find(key);
-  if (it != mCache.left.end()) {
-    mCache.left.erase(it);
+  LOG_TRACE("REMOVE " << mTracePrefix << " [" << key << "]");
+  Shard* shard = getShard(key);
+  boost::unique_lock<boost::shared_mutex> lock(shard->mLock);
+  const typename ShardIndex::iterator it = shard->mIndex.find(key);
+  if (it != shard->mIndex.end()) {
+    //keep the entries dense by moving the last entry into the freed slot
+    cache_size_type slot = it->second;
+    cache_size_type last = shard->mEntries.size() - 1;
+    shard->mIndex.erase(it);
+    if (slot != last) {
+      shard->mEntries[slot] = shard->mEntries[last];
+      shard->mReferenced[slot] = shard->mReferenced[last].load();
+      shard->mIndex[shard->mEntries[slot].mKey] = slot;
+    }
+    shard->mEntries.pop_back();
+    if (shard->mHand >= shard->mEntries.size()) {
+      shard->mHand = 0;
+    }
   }
 }
 
 template<typename Key, typename Value>
 bool Cache<Key, Value>::contains(Key key) {
   LOG_TRACE("CONTAINS " << mTracePrefix << " [" << key << "]");
-  boost::mutex::scoped_lock lock(mLock);
-  const typename CacheContainer::left_iterator it = mCache.left.find(key);
-  if (it != mCache.left.end()) {
+  Shard* shard = getShard(key);
+  boost::shared_lock<boost::shared_mutex> lock(shard->mLock);
+  const typename ShardIndex::const_iterator it = shard->mIndex.find(key);
+  if (it != shard->mIndex.end()) {
     //update to most recent
-    mCache.right.relocate(mCache.right.end(), mCache.project_right(it));
-    mHits++;
+    shard->mReferenced[it->second] = true;
+    shard->mHits++;
     return true;
   }
-  mMisses++;
+  shard->mMisses++;
   return false;
 }
 
 template<typename Key, typename Value>
 void Cache<Key, Value>::stats() {
-  float hitsRate = (mHits * 100.0) / (mHits + mMisses);
-  float missesRate = (mMisses * 100.0) / (mHits + mMisses);
-  float evictionsRate = (mEvictions * 100.0) / mInserts;
+  Uint64 hits = 0, misses = 0, evictions = 0, inserts = 0;
+  cache_size_type size = 0;
+  for (Shard* shard : mShards) {
+    boost::shared_lock<boost::shared_mutex> lock(shard->mLock);
+    hits += shard->mHits;
+    misses += shard->mMisses;
+    evictions += shard->mEvictions;
+    inserts += shard->mInserts;
+    size += shard->mEntries.size();
+  }
+  float hitsRate = (hits * 100.0) / (hits + misses);
+  float missesRate = (misses * 100.0) / (hits + misses);
+  float evictionsRate = (evictions * 100.0) / inserts;
 
   LOG_INFO(mTracePrefix << " Cache Stats: Hits=" << hitsRate << ", Misses="
-          << missesRate << ", EvictionsRate=" << evictionsRate << ", Size=" << mCache.size() << "/" << mCapacity);
+          << missesRate << ", EvictionsRate=" << evictionsRate << ", Size=" << size << "/" << mCapacity);
 }
 #endif /* CACHE_H */
-
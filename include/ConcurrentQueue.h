@@ -28,6 +28,7 @@ public:
   ConcurrentQueue();
   void push(Data data);
   void wait_and_pop(Data &result);
+  bool try_pop(Data &result);
   bool empty();
   unsigned int size();
   virtual ~ConcurrentQueue();
@@ -44,7 +45,7 @@ ConcurrentQueue<Data>::ConcurrentQueue() {
 template<typename Data>
 void ConcurrentQueue<Data>::push(Data data) {
   boost::mutex::scoped_lock lock(mLock);
-  mQueue.push(data);
+  mQueue.push(std::move(data));
   lock.unlock();
   mQueueUpdated.notify_one();
 }
@@ -55,11 +56,22 @@ void ConcurrentQueue<Data>::wait_and_pop(Data& result) {
   while (mQueue.empty()) {
     mQueueUpdated.wait(lock);
   }
-  result = mQueue.front();
+  result = std::move(mQueue.front());
   mQueue.pop();
 
 }
 
+template<typename Data>
+bool ConcurrentQueue<Data>::try_pop(Data& result) {
+  boost::mutex::scoped_lock lock(mLock);
+  if (mQueue.empty()) {
+    return false;
+  }
+  result = std::move(mQueue.front());
+  mQueue.pop();
+  return true;
+}
+
 template<typename Data>
 bool ConcurrentQueue<Data>::empty() {
   boost::mutex::scoped_lock lock(mLock);
@@ -23,25 +23,191 @@
 #include "TimedRestBatcher.h"
 #include "http/server/MetricsProvider.h"
 #include "MetricsMovingCounters.h"
+#include "LogCleaner.h"
+#include "rapidjson/reader.h"
+
+/*
+ * SAX handler of an elastic response, keeps only the top level error and the
+ * position and error of every failed item of a bulk response.
+ */
+class BulkResponseHandler : public rapidjson::BaseReaderHandler<
+    rapidjson::UTF8<>, BulkResponseHandler> {
+public:
+  BulkResponseHandler() : mErrors(false), mHasError(false), mDepth(0),
+  mInItems(false), mErrorDepth(0), mItem(0), mStatus(0),
+  mItemHasError(false) {
+  }
+
+  bool Bool(bool b) {
+    if (mDepth == 1 && mKey == "errors") {
+      mErrors = b;
+    }
+    return true;
+  }
+
+  bool Int(int i) {
+    return status(i);
+  }
+
+  bool Uint(unsigned u) {
+    return status(u);
+  }
+
+  bool String(const char* str, rapidjson::SizeType length, bool copy) {
+    if (mErrorDepth > 0 && mDepth == mErrorDepth) {
+      if (mKey == "type") {
+        mErrorType.assign(str, length);
+      } else if (mKey == "reason") {
+        mErrorReason.assign(str, length);
+      }
+    } else if (mKey == "error" && (mDepth == 1 || (mInItems && mDepth == 4))) {
+      mErrorType.assign(str, length);
+      endError();
+    }
+    return true;
+  }
+
+  bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+    mKey.assign(str, length);
+    return true;
+  }
+
+  bool StartObject() {
+    mDepth++;
+    if (mInItems && mDepth == 3) {
+      mStatus = 0;
+      mItemHasError = false;
+    } else if (mKey == "error" && (mDepth == 2 || (mInItems && mDepth == 5))) {
+      mErrorDepth = mDepth;
+      mErrorType.clear();
+      mErrorReason.clear();
+    }
+    return true;
+  }
+
+  bool EndObject(rapidjson::SizeType memberCount) {
+    if (mErrorDepth > 0 && mDepth == mErrorDepth) {
+      mErrorDepth = 0;
+      endError();
+    } else if (mInItems && mDepth == 3) {
+      if (mItemHasError) {
+        BulkItemError error = {mItem, mStatus, mItemError};
+        mItemErrors.push_back(error);
+      }
+      mItem++;
+    }
+    mDepth--;
+    return true;
+  }
+
+  bool StartArray() {
+    mDepth++;
+    if (mDepth == 2 && mKey == "items") {
+      mInItems = true;
+    }
+    return true;
+  }
+
+  bool EndArray(rapidjson::SizeType elementCount) {
+    if (mInItems && mDepth == 2) {
+      mInItems = false;
+    }
+    mDepth--;
+    return true;
+  }
+
+  bool hasErrors() const {
+    return mErrors;
+  }
+
+  bool hasError() const {
+    return mHasError;
+  }
+
+  const std::string& getError() const {
+    return mError;
+  }
+
+  std::vector<BulkItemError>& getItemErrors() {
+    return mItemErrors;
+  }
+
+  Uint32 getItems() const {
+    return mItem;
+  }
+
+private:
+  bool mErrors;
+  bool mHasError;
+  std::string mError;
+  std::vector<BulkItemError> mItemErrors;
+
+  int mDepth;
+  std::string mKey;
+  bool mInItems;
+  int mErrorDepth;
+  std::string mErrorType;
+  std::string mErrorReason;
+  Uint32 mItem;
+  int mStatus;
+  bool mItemHasError;
+  std::string mItemError;
+
+  bool status(int status) {
+    if (mInItems && mDepth == 4 && mKey == "status") {
+      mStatus = status;
+    }
+    return true;
+  }
+
+  void endError() {
+    std::string error = mErrorType;
+    if (!mErrorReason.empty()) {
+      error += ":" + mErrorReason;
+    }
+    mErrorReason.clear();
+    if (mInItems) {
+      mItemHasError = true;
+      mItemError = error;
+    } else {
+      mHasError = true;
+      mError = error;
+    }
+  }
+};
 
 class ElasticSearchBase : public TimedRestBatcher, public
-    MetricsProvider {
+    MetricsProvider, public LogRemover {
 public:
   ElasticSearchBase(const HttpClientConfig elastic_client_config, int
-  time_to_wait_before_inserting, int bulk_size, const bool statsEnabled,
+  time_to_wait_before_inserting, int bulk_size, int max_in_flight_batches,
+  const std::string pipe_name, const bool statsEnabled,
   MovingCountersSet* const metricsCounters);
   
   virtual ~ElasticSearchBase();
 
   std::string getMetrics() final override;
+  void setCheckpoint(EpochCheckpoint* checkpoint);
 
 protected:
   std::string getElasticSearchBulkUrl(std::string index);
   std::string getElasticSearchBulkUrl();
   virtual ParsingResponse parseResponse(std::string response);
+  void drained() override;
+
+  /*
+   * hands the logs of acknowledged events to the log cleaner, the rows are
+   * removed later by its thread through removeLogs.
+   */
+  void cleanLogs(std::vector<const LogHandler*>& handlers);
+  void cleanLog(const LogHandler* handler);
 
   const bool mStats;
   MovingCountersSet* const mCounters;
   const std::string DEFAULT_TYPE;
+  const std::string BULK_FILTER;
+
+private:
+  LogCleaner mLogCleaner;
 };
 #endif //EPIPE_ELASTICSEARCHBASE_H
@@ -0,0 +1,73 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+#ifndef EPOCHCHECKPOINT_H
+#define EPOCHCHECKPOINT_H
+
+#include "Utils.h"
+#include "tables/DBWatchTable.h"
+#include "http/server/MetricsProvider.h"
+#include <map>
+
+#define EPOCH_CHECKPOINT_INTERVAL_MS 1000
+
+/*
+ * Tracks the highest epoch of a log table whose rows were all handed
+ * downstream by the tailer and removed by the log cleaner, and persists it
+ * to <dir>/<table>.checkpoint so that a restarted recovery only replays the
+ * rows committed after it.
+ */
+class EpochCheckpoint : public MetricsProvider {
+public:
+  EpochCheckpoint(const std::string dir, const std::string table,
+      const LogType type);
+  /*
+   * reads the persisted epoch, 0 if there is none.
+   */
+  Uint64 load();
+  /*
+   * rows per epoch that the tailer released downstream, the epochs are
+   * released in increasing order.
+   */
+  void released(const std::map<Uint64, Uint64>& rows);
+  void removed(const std::vector<const LogHandler*>& handlers);
+  /*
+   * writes the checkpoint if it advanced, at most once every
+   * EPOCH_CHECKPOINT_INTERVAL_MS unless forced.
+   */
+  void persist(bool force = false);
+  std::string getMetrics() override;
+
+private:
+  const std::string mTable;
+  const std::string mFile;
+  const LogType mType;
+
+  boost::mutex mLock;
+  std::map<Uint64, Uint64> mOutstanding;
+  Uint64 mReleasedEpoch;
+  Uint64 mEpoch;
+  Uint64 mPersistedEpoch;
+  ptime mLastPersist;
+
+  void advance();
+};
+
+#endif /* EPOCHCHECKPOINT_H */
@@ -0,0 +1,233 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef EVENTRECORDER_H
+#define EVENTRECORDER_H
+
+#include "Utils.h"
+#include <fstream>
+
+/*
+ * Event source of the table tailers. LIVE tails the NDB event api, CAPTURE
+ * tails the NDB event api and records every processed event into
+ * <dir>/<table>.events, and REPLAY feeds a recorded file back into the
+ * tailer instead of NDB.
+ */
+enum EventSourceMode {
+  LIVE = 0,
+  CAPTURE = 1,
+  REPLAY = 2
+};
+
+struct EventSourceConf {
+  EventSourceMode mMode;
+  std::string mDir;
+  bool mReplayMaxSpeed;
+
+  EventSourceConf() : mMode(LIVE), mReplayMaxSpeed(false) {
+  }
+
+  EventSourceConf(EventSourceMode mode, std::string dir, bool replayMaxSpeed)
+  : mMode(mode), mDir(dir), mReplayMaxSpeed(replayMaxSpeed) {
+  }
+
+  std::string getFile(const std::string& table) const {
+    std::stringstream out;
+    out << mDir << "/" << table << ".events";
+    return out.str();
+  }
+
+  std::string getString() const {
+    std::stringstream out;
+    switch (mMode) {
+      case LIVE:
+        out << "live";
+        break;
+      case CAPTURE:
+        out << "capture to " << mDir;
+        break;
+      case REPLAY:
+        out << "replay from " << mDir << (mReplayMaxSpeed ? " at max speed" :
+        " at recorded speed");
+        break;
+    }
+    return out.str();
+  }
+};
+
+enum EventRecordType {
+  RECORD_EVENT = 1,
+  RECORD_EPOCH = 2,
+  RECORD_END = 3
+};
+
+#define EVENT_RECORD_MAGIC "EPEV"
+#define EVENT_RECORD_VERSION 1
+
+/*
+ * Records are [type][time offset in usec][payload]. Integers are written as
+ * varints (signed ones zigzag encoded) and strings as varint length + bytes.
+ * Records are buffered and only written out on epoch records, so that a
+ * capture that gets killed still ends on a complete epoch.
+ */
+class EventRecordWriter {
+public:
+
+  EventRecordWriter(const std::string& file, const std::string& table)
+  : mOut(file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc),
+  mStart(Utils::getCurrentTime()) {
+    if (!mOut.is_open()) {
+      LOG_FATAL("failed to open " << file << " to record events of " << table);
+    }
+    mBuffer.append(EVENT_RECORD_MAGIC, 4);
+    putUInt(EVENT_RECORD_VERSION);
+    putString(table);
+    flush();
+  }
+
+  void beginEvent(Uint64 epoch, NdbDictionary::Event::TableEvent event) {
+    beginRecord(RECORD_EVENT);
+    putUInt(epoch);
+    putUInt(static_cast<Uint64> (event));
+  }
+
+  void writeEpoch(Uint64 epoch) {
+    beginRecord(RECORD_EPOCH);
+    putUInt(epoch);
+    flush();
+  }
+
+  void putUInt(Uint64 val) {
+    while (val >= 0x80) {
+      mBuffer.push_back(static_cast<char> ((val & 0x7f) | 0x80));
+      val >>= 7;
+    }
+    mBuffer.push_back(static_cast<char> (val));
+  }
+
+  void putInt(Int64 val) {
+    putUInt((static_cast<Uint64> (val) << 1) ^ static_cast<Uint64> (val >> 63));
+  }
+
+  void putString(const std::string& val) {
+    putUInt(val.size());
+    mBuffer.append(val);
+  }
+
+  ~EventRecordWriter() {
+    beginRecord(RECORD_END);
+    flush();
+    mOut.close();
+  }
+
+private:
+  std::ofstream mOut;
+  const ptime mStart;
+  std::string mBuffer;
+
+  void flush() {
+    mOut.write(mBuffer.data(), mBuffer.size());
+    mOut.flush();
+    mBuffer.clear();
+  }
+
+  void beginRecord(EventRecordType type) {
+    mBuffer.push_back(static_cast<char> (type));
+    putUInt((Utils::getCurrentTime() - mStart).total_microseconds());
+  }
+};
+
+class EventRecordReader {
+public:
+
+  EventRecordReader(const std::string& file, const std::string& table)
+  : mIn(file.c_str(), std::ios::in | std::ios::binary), mFile(file),
+  mTimeOffset(0) {
+    if (!mIn.is_open()) {
+      LOG_FATAL("failed to open " << file << " to replay events of " << table);
+    }
+    char magic[4];
+    mIn.read(magic, 4);
+    if (!mIn || std::strncmp(magic, EVENT_RECORD_MAGIC, 4) != 0) {
+      LOG_FATAL(file << " is not an events record file");
+    }
+    Uint64 version = getUInt();
+    if (version != EVENT_RECORD_VERSION) {
+      LOG_FATAL(file << " has unsupported version " << version);
+    }
+    std::string recordedTable = getString();
+    if (recordedTable != table) {
+      LOG_FATAL(file << " was recorded for " << recordedTable
+      << " not for " << table);
+    }
+  }
+
+  EventRecordType nextRecord() {
+    int type = mIn.get();
+    if (type == std::char_traits<char>::eof()) {
+      LOG_WARN(mFile << " is truncated, stopping replay");
+      return RECORD_END;
+    }
+    mTimeOffset = getUInt();
+    return static_cast<EventRecordType> (type);
+  }
+
+  Uint64 getTimeOffset() const {
+    return mTimeOffset;
+  }
+
+  Uint64 getUInt() {
+    Uint64 val = 0;
+    int shift = 0;
+    while (true) {
+      int b = mIn.get();
+      if (b == std::char_traits<char>::eof()) {
+        LOG_FATAL(mFile << " is corrupted, unexpected end of file");
+      }
+      val |= static_cast<Uint64> (b & 0x7f) << shift;
+      if ((b & 0x80) == 0) {
+        break;
+      }
+      shift += 7;
+    }
+    return val;
+  }
+
+  Int64 getInt() {
+    Uint64 val = getUInt();
+    return static_cast<Int64> ((val >> 1) ^ (~(val & 1) + 1));
+  }
+
+  std::string getString() {
+    Uint64 size = getUInt();
+    std::string val(size, '\0');
+    mIn.read(&val[0], size);
+    if (!mIn) {
+      LOG_FATAL(mFile << " is corrupted, unexpected end of file");
+    }
+    return val;
+  }
+
+private:
+  std::ifstream mIn;
+  const std::string mFile;
+  Uint64 mTimeOffset;
+};
+
+#endif /* EVENTRECORDER_H */
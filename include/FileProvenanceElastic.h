@@ -26,16 +26,17 @@
 class FileProvenanceElastic : public ElasticSearchBase {
 public:
   FileProvenanceElastic(const HttpClientConfig elastic_client_config,int time_to_wait_before_inserting, int bulk_size,
-      const bool stats, SConn conn, int file_lru_cap, int xattr_lru_cap);
+      int max_in_flight_batches, const bool stats, SConn conn, int file_lru_cap, int xattr_lru_cap);
 
   virtual ~FileProvenanceElastic();
 private:
   SConn mConn;
   FileProvenanceLogTable mFileProvTable;
 
-  void intProcessOneByOne(eBulk bulk);
-  bool intProcessBatch(std::string val, std::vector<eBulk>* bulks, std::vector<const LogHandler*> cleanupHandlers, ptime start_time);
-  virtual void process(std::vector<eBulk>* bulks);
+  void intProcessOneByOne(eBulk& bulk);
+  virtual bool send(std::vector<eBulk>* bulks);
+  virtual void acknowledge(std::vector<eBulk>* bulks, bool sent, ptime start_time);
+  int removeLogs(std::vector<const LogHandler*>& handlers) override;
 };
 
 template <typename Iter>
@@ -23,14 +23,92 @@
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
 #include "tables/XAttrTable.h"
 #include "tables/FileProvenanceXAttrBufferTable.h"
 #include "tables/INodeTable.h"
 #include "FileProvenanceConstants.h"
 #include "FileProvenanceElastic.h"
 
+typedef rapidjson::Writer<rapidjson::StringBuffer> JSONWriter;
+
+/*
+ * Reusable output buffer of the bulk ops of one provenance row. Every json
+ * line is written through the SAX writer straight into the buffer, the buffer
+ * keeps its capacity across rows.
+ */
+class ElasticBulkWriter {
+public:
+  ElasticBulkWriter() : mWriter(mBuffer), mParsedWriter(mParsed), mLines(0),
+  mActions(0) {
+  }
+
+  JSONWriter& startLine() {
+    mWriter.Reset(mBuffer);
+    mLines++;
+    return mWriter;
+  }
+
+  /*
+   * starts the action line of a bulk op, the source line if any follows
+   * through startLine.
+   */
+  JSONWriter& startAction() {
+    mActions++;
+    return startLine();
+  }
+
+  void endLine() {
+    mBuffer.Put('\n');
+  }
+
+  /*
+   * parses the json value into the scratch buffer, returns false if it is
+   * not valid json
+   */
+  bool parseJSON(const std::string& value) {
+    mParsed.Clear();
+    mParsedWriter.Reset(mParsed);
+    rapidjson::Reader reader;
+    rapidjson::StringStream in(value.c_str());
+    reader.Parse(in, mParsedWriter);
+    return !reader.HasParseError();
+  }
+
+  void writeParsed(JSONWriter& writer) {
+    writer.RawValue(mParsed.GetString(), mParsed.GetSize(), rapidjson::kObjectType);
+  }
+
+  void clear() {
+    mBuffer.Clear();
+    mLines = 0;
+    mActions = 0;
+  }
+
+  bool empty() const {
+    return mLines == 0;
+  }
+
+  Uint32 getActions() const {
+    return mActions;
+  }
+
+  std::string str() const {
+    return std::string(mBuffer.GetString(), mBuffer.GetSize());
+  }
+
+private:
+  rapidjson::StringBuffer mBuffer;
+  JSONWriter mWriter;
+  rapidjson::StringBuffer mParsed;
+  JSONWriter mParsedWriter;
+  int mLines;
+  Uint32 mActions;
+};
+
 struct ProcessRowResult {
-  std::list<std::string> mElasticOps;
   FileProvenancePK mLogPK;
   boost::optional<FPXAttrBufferPK> mCompanionPK;
   FileProvenanceConstantsRaw::Operation mProvOp;
@@ -38,16 +116,21 @@ struct ProcessRowResult {
 
 class FileProvenanceElasticDataReader : public NdbDataReader<FileProvenanceRow, SConn> {
 public:
-  FileProvenanceElasticDataReader(SConn hopsConn, const bool hopsworks, int prov_file_lru_cap, int prov_core_lru_cap, int inodes_lru_cap);
+  FileProvenanceElasticDataReader(SConn hopsConn, const bool hopsworks, int prov_file_lru_cap, int prov_core_lru_cap, int inodes_lru_cap,
+          const int max_batches_in_flight);
   virtual ~FileProvenanceElasticDataReader();
 protected:
 
 private:
   FileProvenanceLogTable mFileLogTable;
   INodeTable inodesTable;
+  boost::unordered_map<Pq*, AsyncRead*> mPrefetchedINodes;
+  ElasticBulkWriter mBulkOps;
 
   void processAddedandDeleted(Pq* data_batch, eBulk& bulk);
-  ProcessRowResult rowResult(std::list<std::string> elasticOps, FileProvenancePK logPK,
+  int prefetch(Pq* data_batch);
+  void waitForPrefetched(int transactions);
+  ProcessRowResult rowResult(FileProvenancePK logPK,
           boost::optional<FPXAttrBufferPK> companionPK, FileProvenanceConstantsRaw::Operation provOp);
   ProcessRowResult process_row(FileProvenanceRow row);
   bool projectExists(Int64 projectIId, Int64 timestamp);
@@ -55,17 +138,20 @@ private:
   boost::optional<FPXAttrBufferRow> getProvCore(Int64 inodeId, int inodeLogicalTime);
   boost::optional<FPXAttrBufferRow> readProvCore(Int64 inodeId, int fromLogicalTime, int toLogicalTime);
   ULSet getViewInodes(Pq* data_batch);
-  std::string getElasticBulkOps(std::list <std::string> bulkOps);
+  INodePKs getViewInodesPKs(Pq* data_batch);
+  std::string getElasticBulkOps();
 };
 
 class FileProvenanceElasticDataReaders :  public NdbDataReaders<FileProvenanceRow, SConn>{
   public:
     FileProvenanceElasticDataReaders(SConn* hopsConns, int num_readers,const bool hopsworks,
-          TimedRestBatcher* restEndpoint, int prov_file_lru_cap, int prov_core_lru_cap, int inodes_lru_ca) :
+          TimedRestBatcher* restEndpoint, int prov_file_lru_cap, int prov_core_lru_cap, int inodes_lru_ca,
+          const int max_batches_in_flight) :
     NdbDataReaders(restEndpoint){
       for(int i=0; i<num_readers; i++){
         FileProvenanceElasticDataReader* dr
-          = new FileProvenanceElasticDataReader(hopsConns[i], hopsworks, prov_file_lru_cap, prov_core_lru_cap, inodes_lru_ca);
+          = new FileProvenanceElasticDataReader(hopsConns[i], hopsworks, prov_file_lru_cap, prov_core_lru_cap, inodes_lru_ca,
+                  max_batches_in_flight);
         dr->start(i, this);
         mDataReaders.push_back(dr);
       }
@@ -33,11 +33,10 @@ private:
   virtual void handleEvent(NdbDictionary::Event::TableEvent eventType, FileProvenanceRow pre, FileProvenanceRow row);
   void barrierChanged();
 
-  void pushToQueue(PRpq* curr);
+  void pushToQueue(Pq& rows);
 
   CPRq *mQueue;
-  PRpq* mCurrentPriorityQueue;
-  boost::mutex mLock;
+  Pq mCurrentRows;
 
 };
 
@@ -28,8 +28,8 @@ class FsMutationsBatcher : public RCBatcher<FsMutationRow, MConn> {
 public:
 
   FsMutationsBatcher(FsMutationsTableTailer* table_tailer, FsMutationsDataReaders* data_reader,
-          const int time_before_issuing_ndb_reqs, const int batch_size)
-  : RCBatcher<FsMutationRow, MConn>(table_tailer, data_reader, time_before_issuing_ndb_reqs, batch_size) {
+          const int time_before_issuing_ndb_reqs, const int batch_size, const int queue_id)
+  : RCBatcher<FsMutationRow, MConn>(table_tailer, data_reader, time_before_issuing_ndb_reqs, batch_size, queue_id) {
 
   }
 };
@@ -91,7 +91,8 @@ private:
 class FsMutationsDataReader : public NdbDataReader<FsMutationRow, MConn> {
 public:
   FsMutationsDataReader(MConn connection, const bool hopsworks, const int lru_cap,
-          const std::string search_index, const std::string featurestore_index);
+          const std::string search_index, const std::string featurestore_index,
+          const int max_batches_in_flight);
   virtual ~FsMutationsDataReader();
 private:
   INodeTable mInodesTable;
@@ -101,8 +102,15 @@ private:
   FsMutationsLogTable mFSLogTable;
   std::string mSearchIndex;
   std::string mFeaturestoreIndex;
+  boost::unordered_map<Fmq*, AsyncRead*> mPrefetchedINodes;
+  boost::unordered_map<Fmq*, Fmq> mSupersededMutations;
 
   virtual void processAddedandDeleted(Fmq* data_batch, eBulk& bulk);
+  virtual int prefetch(Fmq* data_batch);
+  virtual void waitForPrefetched(int transactions);
+  virtual void coalesce(Fmq* data_batch);
+  INodeMap getINodes(Fmq* data_batch);
+  void removeSuperseded(Fmq* data_batch, eBulk& bulk);
 
   void createJSON(Fmq* pending, INodeMap& inodes, XAttrMap& xattrs, eBulk& bulk);
 };
@@ -111,9 +119,11 @@ class FsMutationsDataReaders : public NdbDataReaders<FsMutationRow, MConn>{
 public:
   FsMutationsDataReaders(MConn* connections, int num_readers, const bool hopsworks,
           ProjectsElasticSearch* elastic, const int lru_cap, const std::string search_index,
-          const std::string featurestore_index) : NdbDataReaders(elastic){
+          const std::string featurestore_index, const int max_batches_in_flight,
+          const int partition) : NdbDataReaders(elastic, partition){
     for(int i=0; i< num_readers; i++){
-      FsMutationsDataReader* dr = new FsMutationsDataReader(connections[i], hopsworks, lru_cap, search_index, featurestore_index);
+      FsMutationsDataReader* dr = new FsMutationsDataReader(connections[i], hopsworks, lru_cap, search_index,
+          featurestore_index, max_batches_in_flight);
       dr->start(i, this);
       mDataReaders.push_back(dr);
     }
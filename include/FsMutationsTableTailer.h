@@ -26,17 +26,31 @@
 class FsMutationsTableTailer : public RCTableTailer<FsMutationRow> {
 public:
   FsMutationsTableTailer(Ndb* ndb, Ndb* ndbRecovery, const int
-  poll_maxTimeToWait, const Barrier barrier);
+  poll_maxTimeToWait, const Barrier barrier, const int num_queues);
   FsMutationRow consume();
+  FsMutationRow consumeMultiQueue(int queue_id);
+  int getNumQueues() const;
   virtual ~FsMutationsTableTailer();
 
 private:
   virtual void handleEvent(NdbDictionary::Event::TableEvent eventType, FsMutationRow pre, FsMutationRow row);
   void barrierChanged();
-  void pushToQueue(FSpq* curr);
-  CFSq* mQueue;
-  FSpq* mCurrentPriorityQueue;
-  boost::mutex mLock;
+  void pushToQueue(Fmq& rows);
+  int getQueueId(const FsMutationRow& row) const;
+  /*
+   * mutations are partitioned by inode into mNumQueues queues, each one
+   * drained by its own batcher and readers. The document of an inode is only
+   * written from one queue, also when the inode moves to another dataset, so
+   * the order of its mutations is kept while other inodes progress in
+   * parallel.
+   */
+  const int mNumQueues;
+  std::vector<CFSq*> mQueues;
+  /*
+   * mutations of the current epoch, only touched by the events thread and
+   * sorted once the barrier changes.
+   */
+  Fmq mCurrentRows;
 
   //    double mTimeTakenForEventsToArrive;
   //    long mNumOfEvents;
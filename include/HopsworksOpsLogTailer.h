@@ -35,6 +35,7 @@ public:
 private:
   HopsworksOpsLogTable mHopsworksLogTable;
   virtual void handleEvent(NdbDictionary::Event::TableEvent eventType, HopsworksOpRow pre, HopsworksOpRow row);
+  virtual void waitForCapacity();
 
   void handleDataset(ptime arrivalTime, eBulk &bulk, HopsworksOpRow logEvent);
   void handleProject(ptime arrivalTime, eBulk &bulk, HopsworksOpRow logEvent);
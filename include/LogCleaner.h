@@ -0,0 +1,89 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef LOGCLEANER_H
+#define LOGCLEANER_H
+
+#include "Utils.h"
+#include "ConcurrentQueue.h"
+#include "tables/DBWatchTable.h"
+#include "EpochCheckpoint.h"
+#include "http/server/MetricsProvider.h"
+#include <boost/atomic.hpp>
+
+#define LOG_CLEANER_MAX_BATCH 1000
+
+class LogRemover {
+public:
+  /*
+   * removes the log rows of the handlers in as few transactions as possible,
+   * returns the number of rows that were already deleted.
+   */
+  virtual int removeLogs(std::vector<const LogHandler*>& handlers) = 0;
+};
+
+struct LogCleanerJob {
+  std::vector<const LogHandler*> mHandlers;
+  ptime mEnqueueTime;
+};
+
+/*
+ * Removes the log rows of the acknowledged events on its own thread so that
+ * the elastic sink does not wait for NDB. The handlers queued by several
+ * batches are merged into delete transactions of at most
+ * LOG_CLEANER_MAX_BATCH rows.
+ */
+class LogCleaner : public MetricsProvider {
+public:
+  LogCleaner(const std::string pipe_name, LogRemover* remover);
+  void start();
+  void add(std::vector<const LogHandler*>& handlers);
+  void add(const LogHandler* handler);
+  /*
+   * the removed logs advance the checkpoint, which is persisted by the
+   * cleaner thread.
+   */
+  void setCheckpoint(EpochCheckpoint* checkpoint);
+  /*
+   * removes the queued logs and stops the cleaner thread.
+   */
+  void shutdown();
+  std::string getMetrics() override;
+  virtual ~LogCleaner();
+
+private:
+  const std::string mPipeName;
+  LogRemover* mRemover;
+  EpochCheckpoint* mCheckpoint;
+  ConcurrentQueue<LogCleanerJob> mQueue;
+  boost::thread mThread;
+  bool mStarted;
+  boost::atomic<bool> mShutdown;
+
+  boost::atomic<Uint64> mPending;
+  boost::atomic<Uint64> mRemoved;
+  boost::atomic<Uint64> mMissing;
+  boost::atomic<Uint64> mBatches;
+  boost::atomic<int> mLagMS;
+
+  void run();
+  void removeLogs(std::vector<const LogHandler*>& handlers);
+};
+
+#endif /* LOGCLEANER_H */
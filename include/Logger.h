@@ -47,6 +47,8 @@ enum LogSeverityLevel
 #define LOG_FATAL(msg) Logger::fatal(FORMAT(msg))
 #define LOG_NDB_API_FATAL(ctx, error) \
         LOG_FATAL(ctx << " - got error code: " << error.code << ", msg: " << error.message << ".")
+#define LOG_NDB_API_ERROR(ctx, error) \
+        LOG_ERROR(ctx << " - got error code: " << error.code << ", msg: " << error.message << ".")
 
 class Logger {
 public:
@@ -0,0 +1,215 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include "Utils.h"
+#include "http/server/MetricsProvider.h"
+#include <boost/atomic.hpp>
+#include <functional>
+
+#define MEMORY_BUDGET_DRAIN_FACTOR 2
+
+class MemoryBudget;
+
+/*
+ * stage name of a queue that is replicated per partition of a pipeline
+ */
+inline std::string getPartitionStage(const std::string stage, const int
+partition) {
+  if (partition < 0) {
+    return stage;
+  }
+  std::stringstream out;
+  out << stage << "_" << partition;
+  return out.str();
+}
+
+/*
+ * Byte and item accounting of one queue of a pipeline, every byte added to a
+ * gauge is also charged to the global memory budget.
+ */
+class MemoryGauge {
+public:
+  MemoryGauge(MemoryBudget* budget, const std::string owner, const
+  std::string stage) : mBudget(budget), mOwner(owner), mStage(stage),
+  mBytes(0), mItems(0) {
+  }
+
+  void add(Uint64 bytes, Uint64 items = 1);
+  void remove(Uint64 bytes, Uint64 items = 1);
+
+  Uint64 getBytes() const {
+    return mBytes;
+  }
+
+  Uint64 getItems() const {
+    return mItems;
+  }
+
+  std::string getLabels() const {
+    return "{queue=\"" + mOwner + "\",stage=\"" + mStage + "\"} ";
+  }
+
+private:
+  MemoryBudget* mBudget;
+  const std::string mOwner;
+  const std::string mStage;
+  boost::atomic<Uint64> mBytes;
+  boost::atomic<Uint64> mItems;
+};
+
+/*
+ * Process wide budget of the bytes held in the pipelines queues. Producers
+ * never block on push, instead the table tailers stop polling NDB while the
+ * budget is exhausted and resume once the queues drained below the low
+ * watermark, so that the NDB event buffer and the log tables absorb the
+ * backlog instead of the ePipe heap.
+ */
+class MemoryBudget : public MetricsProvider {
+public:
+
+  static MemoryBudget& getInstance() {
+    static MemoryBudget instance;
+    return instance;
+  }
+
+  void setLimit(Uint64 limit_bytes) {
+    mLimit = limit_bytes;
+    mLowWatermark = limit_bytes - limit_bytes / 10;
+    if (mLimit > 0) {
+      LOG_INFO("memory budget of the pipelines is " << mLimit << " bytes");
+    }
+  }
+
+  MemoryGauge* getGauge(const std::string owner, const std::string stage) {
+    boost::mutex::scoped_lock lock(mLock);
+    MemoryGauge* gauge = new MemoryGauge(this, owner, stage);
+    mGauges.push_back(gauge);
+    return gauge;
+  }
+
+  void charge(Uint64 bytes) {
+    mUsed += bytes;
+  }
+
+  void release(Uint64 bytes) {
+    Uint64 used = mUsed.fetch_sub(bytes) - bytes;
+    if (mWaiters > 0 && used <= mLowWatermark) {
+      boost::mutex::scoped_lock lock(mLock);
+      mCapacityAvailable.notify_all();
+    }
+  }
+
+  bool isExhausted() const {
+    return isExhausted(0);
+  }
+
+  /*
+   * blocks the caller while the budget is exhausted until enough bytes were
+   * released to drop below the low watermark. held are the bytes charged by
+   * the caller that are only released once it continues, they are not
+   * counted against it. While draining, checked every second, returns true
+   * the caller is only held above MEMORY_BUDGET_DRAIN_FACTOR times the limit.
+   */
+  void waitForCapacity(const std::string& who, Uint64 held = 0,
+      std::function<bool()> draining = nullptr) {
+    if (!isExhausted(held, draining && draining())) {
+      return;
+    }
+    ptime start = Utils::getCurrentTime();
+    LOG_WARN(who << " paused, memory budget exhausted " << mUsed << "/"
+        << mLimit << " bytes, " << held << " bytes held by " << who);
+    mThrottled++;
+    boost::mutex::scoped_lock lock(mLock);
+    mWaiters++;
+    while (getUsed(held) > mLowWatermark) {
+      mCapacityAvailable.timed_wait(lock, boost::posix_time::seconds(1));
+      if (draining && draining() && !isExhausted(held, true)) {
+        break;
+      }
+    }
+    mWaiters--;
+    lock.unlock();
+    int waited = Utils::getTimeDiffInMilliseconds(start, Utils::getCurrentTime());
+    mThrottledMS += waited;
+    LOG_INFO(who << " resumed after " << waited << " msec, memory budget "
+        << mUsed << "/" << mLimit << " bytes");
+  }
+
+  std::string getMetrics() override {
+    std::stringstream out;
+    out << "epipe_memory_budget_limit_bytes " << mLimit << std::endl;
+    out << "epipe_memory_budget_used_bytes " << mUsed << std::endl;
+    out << "epipe_memory_budget_throttled_total " << mThrottled << std::endl;
+    out << "epipe_memory_budget_throttled_milliseconds_total " << mThrottledMS
+        << std::endl;
+    boost::mutex::scoped_lock lock(mLock);
+    for (MemoryGauge* gauge : mGauges) {
+      out << "epipe_queue_bytes" << gauge->getLabels() << gauge->getBytes()
+          << std::endl;
+      out << "epipe_queue_items" << gauge->getLabels() << gauge->getItems()
+          << std::endl;
+    }
+    return out.str();
+  }
+
+private:
+  MemoryBudget() : mLimit(0), mLowWatermark(0), mUsed(0), mWaiters(0),
+  mThrottled(0), mThrottledMS(0) {
+  }
+
+  MemoryBudget(MemoryBudget const&);
+  void operator=(MemoryBudget const&);
+
+  Uint64 getUsed(Uint64 held) const {
+    Uint64 used = mUsed;
+    return used > held ? used - held : 0;
+  }
+
+  bool isExhausted(Uint64 held, bool draining = false) const {
+    Uint64 limit = draining ? mLimit * MEMORY_BUDGET_DRAIN_FACTOR : mLimit;
+    return mLimit > 0 && getUsed(held) >= limit;
+  }
+
+  Uint64 mLimit;
+  Uint64 mLowWatermark;
+  boost::atomic<Uint64> mUsed;
+  boost::atomic<int> mWaiters;
+  boost::atomic<Uint64> mThrottled;
+  boost::atomic<Uint64> mThrottledMS;
+  boost::mutex mLock;
+  boost::condition_variable mCapacityAvailable;
+  std::vector<MemoryGauge*> mGauges;
+};
+
+inline void MemoryGauge::add(Uint64 bytes, Uint64 items) {
+  mBytes += bytes;
+  mItems += items;
+  mBudget->charge(bytes);
+}
+
+inline void MemoryGauge::remove(Uint64 bytes, Uint64 items) {
+  mBytes -= bytes;
+  mItems -= items;
+  mBudget->release(bytes);
+}
+
+#endif /* MEMORYBUDGET_H */
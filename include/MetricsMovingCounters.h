@@ -144,7 +144,7 @@ struct MovingCountersBulkImpl : public MovingCounters, public MovingCountersBulk
     updateAccumlator("avg_elastic_bulk_req_time_milliseconds",
         Utils::getTimeDiffInMilliseconds(elastic_start_time, end_time));
     for (auto it = bulks->begin(); it != bulks->end(); ++it) {
-      eBulk bulk = *it;
+      const eBulk& bulk = *it;
       bulkProcessedInternal(bulk, end_time);
     }
   }
@@ -155,7 +155,7 @@ private:
     updateAccumlator("avg_elastic_batching_time_milliseconds", bulk
     .geteWaitTimeMS(end_time));
     updateAccumlator("avg_total_time_per_batch_milliseconds", bulk.getTotalTimeMS(end_time));
-    for(eEvent event : bulk.mEvents){
+    for(const eEvent& event : bulk.mEvents){
       updateAccumlator("avg_total_time_per_event_milliseconds",
           Utils::getTimeDiffInMilliseconds(event.getArrivalTime(), end_time));
     }
@@ -165,7 +165,7 @@ private:
   }
 
   void updateCounters(const eBulk& bulk){
-    for(eEvent event : bulk.mEvents){
+    for(const eEvent& event : bulk.mEvents){
       if(event.getAssetType() != eEvent::AssetType::AssetNA){
         switch(event.getEventType()){
           case eEvent::EventType::AddEvent:
@@ -244,7 +244,7 @@ struct MovingCountersBulkSet : public MovingCountersSet{
     ptime firstEventInCurrentBulksArrivalTime = bulks->at(0).getFirstArrivalTime();
     int numOfEvents = 0;
     for (auto it = bulks->begin(); it != bulks->end(); ++it) {
-      eBulk bulk = *it;
+      const eBulk& bulk = *it;
       numOfEvents += bulk.mEvents.size();
     }
 
@@ -47,7 +47,7 @@ struct IndexedDataBatch{
 template<typename Data, typename Conn>
 class NdbDataReader {
 public:
-  NdbDataReader(Conn connection, const bool hopsworks);
+  NdbDataReader(Conn connection, const bool hopsworks, const int max_batches_in_flight);
   void start(int readerId, DataReaderOutHandler* outHandler);
   void processBatch(Uint64 index, std::vector<Data>* data_batch);
   virtual ~NdbDataReader();
@@ -58,17 +58,36 @@ protected:
   const bool mHopsworksEnabled;
   virtual void processAddedandDeleted(std::vector<Data>* data_batch,
       eBulk& bulk) = 0;
+
+  /*
+   * prefetch prepares the batch reads on the NDB asynchronous api and returns
+   * the number of transactions it prepared, waitForPrefetched then sends and
+   * polls all the prepared transactions of the queued batches at once.
+   * processAddedandDeleted is still called for the batches one by one, in
+   * order, and completes the prefetched reads.
+   */
+  virtual int prefetch(std::vector<Data>* data_batch);
+  virtual void waitForPrefetched(int transactions);
+
+  /*
+   * coalesce is called once for every batch before any of its reads are
+   * prepared, so that redundant rows can be dropped from the batch.
+   */
+  virtual void coalesce(std::vector<Data>* data_batch);
   
  private:
+  const unsigned int mMaxBatchesInFlight;
   int mReaderId;
   DataReaderOutHandler* mOutHandler;
   ConcurrentQueue<IndexedDataBatch<Data> >* mBatchedQueue;
   void run();
+  void processBatch(IndexedDataBatch<Data>& batch);
 };
 
 template<typename Data, typename Conn>
-NdbDataReader<Data, Conn>::NdbDataReader(Conn connection, const bool hopsworks)
-: mNdbConnection(connection), mHopsworksEnabled(hopsworks) {
+NdbDataReader<Data, Conn>::NdbDataReader(Conn connection, const bool hopsworks, const int max_batches_in_flight)
+: mNdbConnection(connection), mHopsworksEnabled(hopsworks),
+mMaxBatchesInFlight(std::max(1, std::min(max_batches_in_flight, NDB_MAX_TRANSACTIONS / 2))) {
   mBatchedQueue = new ConcurrentQueue<IndexedDataBatch<Data> >();
 }
 
@@ -83,31 +102,78 @@ void NdbDataReader<Data, Conn>::start(int readerId, DataReaderOutHandler* outHan
 template<typename Data, typename Conn>
 void NdbDataReader<Data, Conn>::run() {
   while (true) {
+    std::vector<IndexedDataBatch<Data> > batches;
     IndexedDataBatch<Data> batch;
     mBatchedQueue->wait_and_pop(batch);
+    batches.push_back(batch);
+    while (batches.size() < mMaxBatchesInFlight && mBatchedQueue->try_pop(batch)) {
+      batches.push_back(batch);
+    }
+
+    for (IndexedDataBatch<Data>& b : batches) {
+      coalesce(b.mDataBatch);
+    }
+
+    if (batches.size() > 1) {
+      int transactions = 0;
+      for (IndexedDataBatch<Data>& b : batches) {
+        if (!b.mDataBatch->empty()) {
+          transactions += prefetch(b.mDataBatch);
+        }
+      }
+      if (transactions > 0) {
+        ptime t1 = getCurrentTime();
+        waitForPrefetched(transactions);
+        LOG_DEBUG("Reader-" << mReaderId << " prefetched " << batches.size()
+            << " batches in " << transactions << " transactions took "
+            << getTimeDiffInMilliseconds(t1, getCurrentTime()) << " msec");
+      }
+    }
 
-    if (!batch.mDataBatch->empty()) {
-      eBulk bulk;
+    for (IndexedDataBatch<Data>& b : batches) {
+      processBatch(b);
+    }
+  }
+}
 
-      bulk.mProcessingIndex = batch.mIndex;
-      
-      bulk.mStartProcessing = getCurrentTime();
+template<typename Data, typename Conn>
+void NdbDataReader<Data, Conn>::processBatch(IndexedDataBatch<Data>& batch) {
+  if (!batch.mDataBatch->empty()) {
+    eBulk bulk;
 
-      processAddedandDeleted(batch.mDataBatch, bulk);
-      
-      bulk.mEndProcessing = getCurrentTime();
+    bulk.mProcessingIndex = batch.mIndex;
 
-      bulk.sortArrivalTimes();
+    bulk.mStartProcessing = getCurrentTime();
 
-      mOutHandler->writeOutput(bulk);
-      
-      LOG_DEBUG("Reader-" << mReaderId << " processing batch " << batch.mIndex << " of size [" << batch.mDataBatch->size() << "] took "
-          << getTimeDiffInMilliseconds(bulk.mStartProcessing, bulk.mEndProcessing) << " msec");
-    }
+    processAddedandDeleted(batch.mDataBatch, bulk);
+
+    bulk.mEndProcessing = getCurrentTime();
 
+    bulk.sortArrivalTimes();
+
+    LOG_DEBUG("Reader-" << mReaderId << " processing batch " << batch.mIndex << " of size [" << batch.mDataBatch->size() << "] took "
+        << getTimeDiffInMilliseconds(bulk.mStartProcessing, bulk.mEndProcessing) << " msec");
+
+    mOutHandler->writeOutput(std::move(bulk));
   }
 }
 
+template<typename Data, typename Conn>
+int NdbDataReader<Data, Conn>::prefetch(std::vector<Data>* data_batch) {
+  //synchronous reads by default
+  return 0;
+}
+
+template<typename Data, typename Conn>
+void NdbDataReader<Data, Conn>::waitForPrefetched(int transactions) {
+  //do nothing
+}
+
+template<typename Data, typename Conn>
+void NdbDataReader<Data, Conn>::coalesce(std::vector<Data>* data_batch) {
+  //process every row by default
+}
+
 template<typename Data, typename Conn>
 void NdbDataReader<Data, Conn>::processBatch(Uint64 index, std::vector<Data>* data_batch) {
   mBatchedQueue->push(IndexedDataBatch<Data>(index, data_batch));
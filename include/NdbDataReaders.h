@@ -21,15 +21,18 @@
 #define NDBDATAREADERS_H
 
 #include "NdbDataReader.h"
-#include "ConcurrentPriorityQueue.h"
 #include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
 
 typedef boost::atomic<Uint64> AtomicLong;
 
-struct BulkIndexComparator {
-  
-  bool operator()(const eBulk &r1, const eBulk &r2) const {
-    return r1.mProcessingIndex > r2.mProcessingIndex;
+#define REORDER_BUFFER_SIZE 1024
+
+struct ReorderSlot {
+  eBulk mBulk;
+  boost::atomic<bool> mReady;
+
+  ReorderSlot() : mReady(false) {
   }
 };
 
@@ -38,7 +41,7 @@ class NdbDataReaders : public DataReaderOutHandler{
 public:
   typedef std::vector<NdbDataReader<Data, Conn>* > DataReadersVec;
   typedef typename DataReadersVec::size_type drvec_size_type;
-  NdbDataReaders(TimedRestBatcher* elastic);
+  NdbDataReaders(TimedRestBatcher* elastic, const int partition = -1);
   void start();
   void processBatch(std::vector<Data>* data_batch);
   void writeOutput(eBulk out);
@@ -50,24 +53,43 @@ private:
   boost::thread mThread;
   
   ConcurrentQueue<std::vector<Data>*>* mBatchedQueue;
-  ConcurrentPriorityQueue<eBulk, BulkIndexComparator >* mWaitingOutQueue;
-  
+
+  /*
+   * Ring of REORDER_BUFFER_SIZE slots indexed by the bulk processing index.
+   * Readers fill their slot without locking, whoever wins mReleasing then
+   * hands the contiguous ready bulks to the rest batcher in order. Batches
+   * are not handed to the readers while the ring is full.
+   */
+  boost::scoped_array<ReorderSlot> mReorderBuffer;
+  boost::atomic<bool> mReleasing;
+  boost::mutex mReorderLock;
+  boost::condition_variable mReorderSpace;
+
+  MemoryGauge* mBatchedGauge;
+  MemoryGauge* mWaitingOutGauge;
+
   AtomicLong mLastSent;
   AtomicLong mCurrIndex;
   drvec_size_type mRoundRobinDrIndex;
   
   void run();
   void processWaiting();
+  void waitForReorderSpace();
+  Uint64 getBatchSize(std::vector<Data>* data_batch);
   
 protected:
   std::vector<NdbDataReader<Data, Conn>* > mDataReaders;
 };
 
 template<typename Data, typename Conn>
-NdbDataReaders<Data, Conn>::NdbDataReaders(TimedRestBatcher* batcher) : timedRestBatcher(batcher) {
+NdbDataReaders<Data, Conn>::NdbDataReaders(TimedRestBatcher* batcher, const int partition) : timedRestBatcher(batcher),
+mReorderBuffer(new ReorderSlot[REORDER_BUFFER_SIZE]), mReleasing(false) {
   mStarted = false;
   mBatchedQueue = new ConcurrentQueue<std::vector<Data>*>();
-  mWaitingOutQueue = new ConcurrentPriorityQueue<eBulk, BulkIndexComparator>();
+  mBatchedGauge = MemoryBudget::getInstance().getGauge(batcher->getPipeName(),
+      getPartitionStage("readers", partition));
+  mWaitingOutGauge = MemoryBudget::getInstance().getGauge(batcher->getPipeName(),
+      getPartitionStage("reorder", partition));
   mLastSent = 0; 
   mCurrIndex = 0;
   mRoundRobinDrIndex = -1;
@@ -89,6 +111,7 @@ void NdbDataReaders<Data, Conn>::run() {
   while (true) {
     std::vector<Data>* curr;
     mBatchedQueue->wait_and_pop(curr);
+    mBatchedGauge->remove(getBatchSize(curr));
     
     if(mRoundRobinDrIndex < mDataReaders.size()){
       mRoundRobinDrIndex++;
@@ -98,37 +121,83 @@ void NdbDataReaders<Data, Conn>::run() {
       mRoundRobinDrIndex = 0;
     }
     
+    waitForReorderSpace();
     mDataReaders[mRoundRobinDrIndex]->processBatch(++mCurrIndex, curr);
   }
 }
 
+template<typename Data, typename Conn>
+void NdbDataReaders<Data, Conn>::waitForReorderSpace() {
+  if (mCurrIndex - mLastSent < REORDER_BUFFER_SIZE) {
+    return;
+  }
+  LOG_DEBUG("reorder buffer is full, waiting for bulk " << (mLastSent + 1));
+  boost::mutex::scoped_lock lock(mReorderLock);
+  while (mCurrIndex - mLastSent >= REORDER_BUFFER_SIZE) {
+    mReorderSpace.timed_wait(lock, boost::posix_time::milliseconds(100));
+  }
+}
+
 template<typename Data, typename Conn>
 void NdbDataReaders<Data, Conn>::processBatch(std::vector<Data>* data_batch) {
+  mBatchedGauge->add(getBatchSize(data_batch));
   mBatchedQueue->push(data_batch);
 }
 
+template<typename Data, typename Conn>
+Uint64 NdbDataReaders<Data, Conn>::getBatchSize(std::vector<Data>* data_batch) {
+  Uint64 size = 0;
+  for (const Data& row : *data_batch) {
+    size += row.getSize();
+  }
+  return size;
+}
+
 template<typename Data, typename Conn>
 void NdbDataReaders<Data, Conn>::writeOutput(eBulk out) {
-  mWaitingOutQueue->push(out);
+  mWaitingOutGauge->add(out.mJSONLength);
+  ReorderSlot& slot = mReorderBuffer[out.mProcessingIndex % REORDER_BUFFER_SIZE];
+  slot.mBulk = std::move(out);
+  slot.mReady.store(true, boost::memory_order_release);
   processWaiting();
 }
 
 template<typename Data, typename Conn>
 void NdbDataReaders<Data, Conn>::processWaiting() {
-  while (!mWaitingOutQueue->empty()) {
-    boost::optional<eBulk> out_ptr = mWaitingOutQueue->pop();
-    if (out_ptr) {
-      eBulk out = out_ptr.get();
-      if (out.mProcessingIndex == mLastSent + 1) {
-        LOG_INFO("publish enriched events with index [" << out.mProcessingIndex << "] to Elastic");
-        timedRestBatcher->addData(out);
-        mLastSent++;
-      } else {
-        mWaitingOutQueue->push(out);
+  while (true) {
+    bool releasing = false;
+    if (!mReleasing.compare_exchange_strong(releasing, true,
+        boost::memory_order_acquire)) {
+      // the current releaser will pick up our bulk
+      return;
+    }
+
+    int released = 0;
+    while (true) {
+      ReorderSlot& slot = mReorderBuffer[(mLastSent + 1) % REORDER_BUFFER_SIZE];
+      if (!slot.mReady.load(boost::memory_order_acquire)) {
         break;
       }
-    } else {
-      break;
+      eBulk out = std::move(slot.mBulk);
+      slot.mBulk = eBulk();
+      slot.mReady.store(false, boost::memory_order_relaxed);
+      mWaitingOutGauge->remove(out.mJSONLength);
+      LOG_INFO("publish enriched events with index [" << out.mProcessingIndex << "] to Elastic");
+      timedRestBatcher->addData(std::move(out));
+      mLastSent++;
+      released++;
+    }
+
+    mReleasing.store(false, boost::memory_order_release);
+    if (released > 0) {
+      mReorderSpace.notify_all();
+    }
+
+    // a bulk that got ready after our last check but before we released the
+    // flag would otherwise wait for the next writer
+    ReorderSlot& next = mReorderBuffer[(mLastSent + 1) % REORDER_BUFFER_SIZE];
+    if (!next.mReady.load(boost::memory_order_acquire)) {
+      return;
     }
   }
 }
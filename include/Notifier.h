@@ -44,20 +44,24 @@ class Notifier : public ClusterConnectionBase {
 public:
   Notifier(const char* connection_string, const char* database_name,
           const char* meta_database_name, const char* hive_meta_database_name,
-          const TableUnitConf mutations_tu,const TableUnitConf provenance_tu,
+          const TableUnitConf mutations_tu, const int mutations_partitions,
+          const TableUnitConf provenance_tu,
           const int poll_maxTimeToWait, const HttpClientConfig elastic_client_config, const bool hopsworks,
           const std::string elastic_search_index, const std::string elastic_featurestore_index,
           const std::string elastic_app_provenance_index,
-          const int elastic_batch_size, const int elastic_issue_time,
-          const int lru_cap, const int prov_file_lru_cap, const int prov_core_lru_cap, const bool recovery, const bool stats,
-          Barrier barrier, const bool hiveCleaner, const std::string
-          metricsServer);
+          const int elastic_batch_size, const int elastic_issue_time, const int elastic_max_in_flight,
+          const int batch_target_latency, const int elastic_max_bulk, const int memory_budget_mb, const int lru_cap, const int prov_file_lru_cap, const int prov_core_lru_cap,
+          const int ndb_async_batches, const bool recovery, const bool stats,
+          Barrier barrier, const EpochGroupConf epoch_group, const EventSourceConf event_source,
+          const std::string checkpoint_dir, const bool hiveCleaner,
+          const std::string metricsServer);
   void start();
   virtual ~Notifier();
 
 private:
 
   const TableUnitConf mMutationsTU;
+  const int mMutationsPartitions;
   const TableUnitConf mFileProvenanceTU;
   const TableUnitConf mAppProvenanceTU;
 
@@ -69,20 +73,28 @@ private:
   const std::string mElasticAppProvenanceIndex;
   const int mElasticBatchsize;
   const int mElasticIssueTime;
+  const int mElasticMaxInFlight;
+  const int mBatchTargetLatency;
+  const int mElasticMaxBulk;
+  const int mMemoryBudgetMB;
   const int mLRUCap;
   const int mProvFileLRUCap;
   const int mProvCoreLRUCap;
+  const int mNdbAsyncBatches;
   const bool mRecovery;
   const bool mStats;
   const Barrier mBarrier;
+  const EpochGroupConf mEpochGroup;
+  const EventSourceConf mEventSource;
+  const std::string mCheckpointDir;
   const bool mHiveCleaner;
   const std::string mMetricsServer;
 
   ProjectsElasticSearch* mProjectsElasticSearch;
 
   FsMutationsTableTailer* mFsMutationsTableTailer;
-  FsMutationsDataReaders* mFsMutationsDataReaders;
-  FsMutationsBatcher* mFsMutationsBatcher;
+  std::vector<FsMutationsDataReaders*> mFsMutationsDataReaders;
+  std::vector<FsMutationsBatcher*> mFsMutationsBatchers;
 
   HopsworksOpsLogTailer* mhopsworksOpsLogTailer;
 
@@ -107,9 +119,17 @@ private:
   SkewedLocTailer* mSkewedLocTailer;
   SkewedValuesTailer* mSkewedValuesTailer;
 
+  std::vector<BatchController*> mBatchControllers;
+  std::vector<EpochCheckpoint*> mCheckpoints;
+
   HttpServer* mHttpServer;
   MetricsProviders* mMetricsProviders;
   void setup();
+  BatchController* createBatchController(const std::string pipe_name,
+      TimedRestBatcher* elastic);
+  template<typename TableRow>
+  void setupCheckpoint(RCTableTailer<TableRow>* tailer, LogType type,
+      ElasticSearchBase* elastic);
 };
 
 #endif /* NOTIFIER_H */
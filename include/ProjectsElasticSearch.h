@@ -28,16 +28,18 @@
 class ProjectsElasticSearch : public ElasticSearchBase{
 public:
   ProjectsElasticSearch(const HttpClientConfig elastic_client_config, int time_to_wait_before_inserting,
-          int bulk_size, const bool stats, MConn conn);
+          int bulk_size, int max_in_flight_batches, const bool stats, MConn conn);
           
   virtual ~ProjectsElasticSearch();
 private:
   std::string mElasticBulkAddr;
   MConn mConn;
 
-  virtual void process(std::vector<eBulk>* bulks);
+  virtual bool send(std::vector<eBulk>* bulks);
+  virtual void acknowledge(std::vector<eBulk>* bulks, bool sent, ptime start_time);
 
   bool bulkRequest(eEvent& event);
+  int removeLogs(std::vector<const LogHandler*>& handlers) override;
 };
 
 #endif /* PROJECTSELASTICSEARCH_H */
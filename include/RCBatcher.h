@@ -39,6 +39,8 @@ private:
   const int mQueueId;
 
   int mCurrentCount;
+  Uint64 mCurrentBytes;
+  MemoryGauge* mGauge;
   boost::mutex mLock;
   std::vector<DataRow>* mOperations;
   virtual void run();
@@ -50,6 +52,8 @@ RCBatcher<DataRow, Conn>::RCBatcher(RCTableTailer<DataRow>* table_tailer, NdbDat
         const int time_before_issuing_ndb_reqs, const int batch_size)
 : Batcher(time_before_issuing_ndb_reqs, batch_size), mTableTailer(table_tailer), mNdbDataReaders(ndb_data_readers), mQueueId(SINGLE_QUEUE) {
   mCurrentCount = 0;
+  mCurrentBytes = 0;
+  mGauge = MemoryBudget::getInstance().getGauge(table_tailer->getTableName(), "batcher");
   mOperations = new std::vector<DataRow>();
 }
 
@@ -58,6 +62,9 @@ RCBatcher<DataRow, Conn>::RCBatcher(RCTableTailer<DataRow>* table_tailer, NdbDat
         const int time_before_issuing_ndb_reqs, const int batch_size, const int queue_id)
 : Batcher(time_before_issuing_ndb_reqs, batch_size), mTableTailer(table_tailer), mNdbDataReaders(ndb_data_readers), mQueueId(queue_id) {
   mCurrentCount = 0;
+  mCurrentBytes = 0;
+  mGauge = MemoryBudget::getInstance().getGauge(table_tailer->getTableName(),
+      getPartitionStage("batcher", queue_id));
   mOperations = new std::vector<DataRow>();
 }
 
@@ -69,9 +76,12 @@ void RCBatcher<DataRow, Conn>::run() {
     mLock.lock();
     mOperations->push_back(row);
     mCurrentCount++;
+    mCurrentBytes += row.getSize();
+    mGauge->add(row.getSize());
+    bool full = mCurrentCount >= mBatchSize;
     mLock.unlock();
 
-    if (mCurrentCount == mBatchSize && !mTimerProcessing) {
+    if (full) {
       resetTimer();
       processBatch();
     }
@@ -80,14 +90,18 @@ void RCBatcher<DataRow, Conn>::run() {
 
 template<typename DataRow, typename Conn>
 void RCBatcher<DataRow, Conn>::processBatch() {
+  // the scheduler thread and the batcher thread both flush, batches are
+  // handed over under the lock to keep them in order
+  boost::mutex::scoped_lock lock(mLock);
   if (mCurrentCount > 0) {
     LOG_DEBUG("process batch");
 
-    mLock.lock();
     std::vector<DataRow>* added_deleted_batch = mOperations;
     mOperations = new std::vector<DataRow>();
+    Uint64 bytes = mCurrentBytes;
     mCurrentCount = 0;
-    mLock.unlock();
+    mCurrentBytes = 0;
+    mGauge->remove(bytes, added_deleted_batch->size());
 
     mNdbDataReaders->processBatch(added_deleted_batch);
   }
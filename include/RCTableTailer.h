@@ -21,17 +21,21 @@
 #define RCTABLETAILER_H
 
 #include "TableTailer.h"
+#include "MemoryBudget.h"
+#include "EpochCheckpoint.h"
+#include "http/server/MetricsProvider.h"
 
 const int SINGLE_QUEUE = -1;
 
 template<typename TableRow>
-class RCTableTailer : public TableTailer<TableRow> {
+class RCTableTailer : public TableTailer<TableRow>, public MetricsProvider {
 public:
 
   RCTableTailer(Ndb* ndb, Ndb* ndbRecovery, DBWatchTable<TableRow>* table,
       const int poll_maxTimeToWait, const Barrier barrier)
   : TableTailer<TableRow>(ndb, ndbRecovery, table, poll_maxTimeToWait,
-      barrier) {
+      barrier), mTableName(table->getName()), mCheckpoint(nullptr) {
+    mQueueGauge = MemoryBudget::getInstance().getGauge(mTableName, "tailer");
   }
 
   virtual TableRow consumeMultiQueue(int queue_id) {
@@ -40,6 +44,82 @@ public:
   }
 
   virtual TableRow consume() = 0;
+
+  const std::string& getTableName() const {
+    return mTableName;
+  }
+
+  /*
+   * the released rows are tracked by the checkpoint and the recovery starts
+   * after its persisted epoch.
+   */
+  void setCheckpoint(EpochCheckpoint* checkpoint) {
+    mCheckpoint = checkpoint;
+    this->setRecoveryEpoch(mCheckpoint->load());
+  }
+
+  std::string getMetrics() override {
+    return this->getEpochGroupMetrics(mTableName) +
+        this->getEventBufferMetrics(mTableName);
+  }
+
+protected:
+  void waitForCapacity() override {
+    if (MemoryBudget::getInstance().isExhausted()) {
+      // the held group is charged to the budget, it must not wait on itself
+      this->flushGroup();
+    }
+    // the rows of the unsealed epoch are only released once it is sealed,
+    // which needs the tailer to keep polling
+    MemoryBudget::getInstance().waitForCapacity(mTableName,
+        this->getHeldBytes(), [this]{ return this->checkEventBuffer(); });
+  }
+
+  void releaseGroup() override {
+    if (mGroupedRows.empty()) {
+      return;
+    }
+    if (mCheckpoint != nullptr) {
+      std::map<Uint64, Uint64> epochs;
+      for (const TableRow& row : mGroupedRows) {
+        epochs[row.mEpoch]++;
+      }
+      mCheckpoint->released(epochs);
+    }
+    pushToQueue(mGroupedRows);
+    mGroupedRows.clear();
+  }
+
+  /*
+   * appends the sorted rows of a barrier to the current group, the barriers
+   * are kept in the order they were sealed.
+   */
+  void addToGroup(std::vector<TableRow>& rows) {
+    if (mGroupedRows.empty()) {
+      mGroupedRows.swap(rows);
+    } else {
+      mGroupedRows.insert(mGroupedRows.end(),
+          std::make_move_iterator(rows.begin()),
+          std::make_move_iterator(rows.end()));
+    }
+  }
+
+  virtual void pushToQueue(std::vector<TableRow>& rows) = 0;
+
+  void queued(const TableRow& row) {
+    mQueueGauge->add(row.getSize());
+    this->addToEpoch(row.getSize());
+  }
+
+  void dequeued(const TableRow& row) {
+    mQueueGauge->remove(row.getSize());
+  }
+
+private:
+  const std::string mTableName;
+  MemoryGauge* mQueueGauge;
+  std::vector<TableRow> mGroupedRows;
+  EpochCheckpoint* mCheckpoint;
 };
 
 #endif /* RCTABLETAILER_H */
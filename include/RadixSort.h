@@ -0,0 +1,104 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include "common.h"
+#include <array>
+
+/*
+ * Sort key of a row packed into Words unsigned words that are compared from
+ * the first to the last one, rows provide it through an overload of
+ * getSortKey(const Row&, Uint64* words).
+ */
+template<int Words>
+struct RadixKey {
+  Uint64 mWords[Words];
+  Uint32 mIndex;
+};
+
+/*
+ * maps signed values to unsigned ones with the same order
+ */
+inline Uint64 getRadixOrdered(Int64 value) {
+  return static_cast<Uint64>(value) ^ 0x8000000000000000ULL;
+}
+
+inline Uint32 getRadixOrdered(int value) {
+  return static_cast<Uint32>(value) ^ 0x80000000U;
+}
+
+/*
+ * digit 0 is the least significant byte of the last word
+ */
+template<int Words>
+inline Uint8 getRadixDigit(const RadixKey<Words>& key, int digit) {
+  return (key.mWords[Words - 1 - digit / 8] >> ((digit % 8) * 8)) & 0xff;
+}
+
+/*
+ * Stable LSD radix sort of the rows by their packed sort key, one byte per
+ * pass. The histograms of all the bytes are built in a single pass over the
+ * keys and the bytes in which all the keys agree are skipped, so small
+ * values cost only a few passes.
+ */
+template<int Words, typename Row>
+void radixSort(std::vector<Row>& rows) {
+  const int digits = Words * 8;
+  std::vector<RadixKey<Words> > keys(rows.size());
+  std::vector<std::array<Uint32, 256> > counts(digits);
+  for (std::array<Uint32, 256>& count : counts) {
+    count.fill(0);
+  }
+  for (Uint32 i = 0; i < rows.size(); i++) {
+    getSortKey(rows[i], keys[i].mWords);
+    keys[i].mIndex = i;
+    for (int d = 0; d < digits; d++) {
+      counts[d][getRadixDigit(keys[i], d)]++;
+    }
+  }
+
+  std::vector<RadixKey<Words> > buffer(keys.size());
+  for (int d = 0; d < digits; d++) {
+    std::array<Uint32, 256>& count = counts[d];
+    if (keys.empty() || count[getRadixDigit(keys[0], d)] == keys.size()) {
+      continue;
+    }
+    Uint32 offset = 0;
+    for (Uint32& c : count) {
+      Uint32 n = c;
+      c = offset;
+      offset += n;
+    }
+    for (RadixKey<Words>& key : keys) {
+      buffer[count[getRadixDigit(key, d)]++] = key;
+    }
+    keys.swap(buffer);
+  }
+
+  std::vector<Row> sorted;
+  sorted.reserve(rows.size());
+  for (RadixKey<Words>& key : keys) {
+    sorted.push_back(std::move(rows[key.mIndex]));
+  }
+  rows.swap(sorted);
+}
+
+#endif /* RADIXSORT_H */
@@ -22,6 +22,8 @@
 #include "ClusterConnectionBase.h"
 #include "ProjectsElasticSearch.h"
 
+#define REINDEX_SCAN_RANGES 100
+
 class Reindexer : public ClusterConnectionBase {
 public:
   Reindexer(const char* connection_string, const char* database_name,
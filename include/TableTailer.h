@@ -22,8 +22,20 @@
 
 #include "Utils.h"
 #include "tables/DBWatchTable.h"
+#include "MemoryBudget.h"
 #include <mutex>
 #include <condition_variable>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+#include <boost/atomic.hpp>
+
+#define RECOVERY_MAX_SCANNERS 4
+#define RECOVERY_BUFFER_ROWS 100000
+#define RECOVERY_RUN_ROWS 250000
+#define EPOCH_GROUP_BUCKETS 10
+#define EVENT_BUFFER_ALERT_PERCENT 60
+#define EVENT_BUFFER_DRAIN_PERCENT 80
 
 enum Barrier {
   EPOCH = 0,
@@ -39,6 +51,8 @@ public:
   TableTailer(Ndb* ndb, DBWatchTable<TableRow>* table, const
   int poll_maxTimeToWait, const Barrier barrier);
 
+  void setEventSource(const EventSourceConf eventSource);
+  void setEpochGrouping(const EpochGroupConf epochGroup);
   void start();
   void waitToFinish();
   virtual ~TableTailer();
@@ -46,18 +60,84 @@ public:
 protected:
   virtual void handleEvent(NdbDictionary::Event::TableEvent eventType, TableRow pre, TableRow row) = 0;
   virtual void barrierChanged();
+  virtual void waitForCapacity();
+  /*
+   * hands the rows of all the barriers grouped so far downstream, called on
+   * the events thread right after barrierChanged once the group is complete.
+   */
+  virtual void releaseGroup();
+
+  void addToEpoch(Uint64 bytes);
+  void flushGroup();
+  /*
+   * bytes of the rows of the current epoch and of the held group, they are
+   * charged to the memory budget but only released by the events thread.
+   */
+  Uint64 getHeldBytes() const;
+  /*
+   * the recovery only replays the rows committed after the given epoch.
+   */
+  void setRecoveryEpoch(Uint64 epoch);
+  Uint64 getEventEpoch() const;
+  /*
+   * samples the NDB event buffer, returns true while the tailer drains it
+   * first and is only paused above the drain ceiling of the memory budget.
+   */
+  bool checkEventBuffer();
+  std::string getEventBufferMetrics(const std::string& table);
+  std::string getEpochGroupMetrics(const std::string& table);
 
   Ndb* mNdbConnection;
 
 private:
-  void createListenerEvent();
+  bool createListenerEvent();
   void removeListenerEvent();
+  NdbEventOperation* subscribe(RowValues& recAttr, RowValues& recAttrPre);
+  NdbEventOperation* resubscribe(NdbEventOperation* subscription,
+      RowValues& recAttr, RowValues& recAttrPre);
+  void restartRecovery(Uint64 epoch);
   void waitForEvents();
+  void replayEvents();
+  void recordEpoch(Uint64 epoch);
   void run();
+  /*
+   * rows read by one scanner sorted by epoch, either kept in memory or
+   * spilled to a file once the scanner read RECOVERY_RUN_ROWS rows.
+   */
+  struct RecoveryRun {
+    std::vector<EpochRow<TableRow> > mRows;
+    std::string mFile;
+  };
+
+  struct RecoveryCursor {
+    std::vector<EpochRow<TableRow> >* mRows;
+    size_t mNext;
+    std::string mFile;
+    EventRecordReader* mReader;
+    EpochRow<TableRow> mRow;
+  };
+
   void recover();
+  void readRecoveryRuns(Ndb* connection, Uint32 scanner, Uint32 scanners,
+      std::vector<RecoveryRun>* runs, int* skipped);
+  RecoveryRun spillRecoveryRun(Uint32 scanner, size_t run,
+      std::vector<EpochRow<TableRow> >& rows);
+  void mergeRecoveryRuns(std::vector<std::vector<RecoveryRun> >& runs);
+  void removeRecoveryRuns(std::vector<RecoveryRun>& runs);
+  bool nextRecoveredRow(RecoveryCursor& cursor);
+  void closeRecoveryCursor(RecoveryCursor& cursor);
+  void addRecoveredRows(std::vector<EpochRow<TableRow> >& rows);
+  bool hasRecoveredRows();
+  void applyRecoveredRows();
   const char* getEventName(NdbDictionary::Event::TableEvent event);
   Uint64 getGCI(Uint64 epoch);
   void checkIfBarrierReached(Uint64 epoch);
+  void sealGroupBarrier();
+  bool isGroupFull();
+  int getGroupHoldLeft();
+  int getPollTimeout(bool recovering);
+  void handleEventBufferLoss(NdbDictionary::Event::TableEvent event,
+      Uint64 epoch);
   bool deferEvent(Uint64 epoch, NdbDictionary::Event::TableEvent event,
       TableRow pre, TableRow row);
   void processEvent(Uint64 epoch, NdbDictionary::Event::TableEvent event,
@@ -74,9 +154,53 @@ private:
   const Barrier mBarrier;
 
   Uint64 mLastReportedBarrier;
+  Uint64 mEventEpoch;
+  Uint64 mRecoveryEpoch;
+
+  /*
+   * rows of the current barrier and of the sealed barriers waiting in the
+   * group, only touched by the events thread.
+   */
+  EpochGroupConf mEpochGroup;
+  Uint64 mEpochRows;
+  Uint64 mEpochBytes;
+  ptime mEpochStart;
+  Uint64 mGroupRows;
+  Uint64 mGroupBytes;
+  Uint64 mGroupBarriers;
+  ptime mGroupStart;
+
+  boost::atomic<Uint64> mGroupBuckets[EPOCH_GROUP_BUCKETS + 1];
+  boost::atomic<Uint64> mGroupsTotal;
+  boost::atomic<Uint64> mGroupedRowsTotal;
+  boost::atomic<Uint64> mGroupedBarriersTotal;
+  boost::atomic<Uint64> mGroupsHeld;
+
+  /*
+   * event buffer usage sampled by the events thread and the lag in GCIs
+   * between the highest queued epoch after a poll and the epoch of the last
+   * event consumed.
+   */
+  bool mEventBufferAlert;
+  boost::atomic<bool> mDraining;
+  Uint64 mConsumedEpoch;
+  boost::atomic<Uint64> mEventBufferUsedBytes;
+  boost::atomic<Uint64> mEventBufferAllocatedBytes;
+  boost::atomic<Uint64> mEventBufferUsagePercent;
+  boost::atomic<Uint64> mGCILag;
+  boost::atomic<Uint64> mDrainsTotal;
+  boost::atomic<Uint64> mEventBufferOverflows;
+  boost::atomic<Uint64> mInconsistentEpochs;
+  boost::atomic<Uint64> mClusterFailures;
+
+  EventSourceConf mEventSource;
+  EventRecordWriter* mEventRecorder;
+  Uint64 mLastRecordedEpoch;
 
   Ndb* mNdbRecoveryConnection;
   bool mUnderRecovery;
+  // set by the events thread to stop a recovery it is about to restart
+  boost::atomic<bool> mRecoveryAborted;
 
   Uint64 mFirstEpochToWatch;
   std::mutex mFirstEpochMutex;
@@ -91,9 +215,25 @@ private:
   bool mStartProcessingDeferredEvents;
   Uint64 mLastEpochInRecovery;
 
+  typedef typename WatchRowKey<TableRow>::Type RowKey;
+
   boost::unordered_map<Uint64, std::queue<DeferredEvent>> mEventsDuringRecovery;
-  boost::unordered_set<std::string> mEventsPKDuringRecovery;
+  boost::unordered_set<RowKey> mEventsPKDuringRecovery;
   boost::unordered_set<Uint64> mEpochsDuringRecovery;
+
+  /*
+   * rows read by the recovery thread in epoch order, handed over to the
+   * events thread through a bounded buffer.
+   */
+  std::deque<EpochRow<TableRow> > mRecoveredRows;
+  bool mRecoveryScanDone;
+  std::mutex mRecoveredRowsMutex;
+  std::condition_variable mRecoveredRowsCond;
+
+  ptime mRecoveryStart;
+  int mRecoveredOldEvents;
+  int mRecoveredNewEvents;
+  int mRecoveredExistingEvents;
 };
 
 template<typename TableRow>
@@ -101,9 +241,20 @@ TableTailer<TableRow>::TableTailer(Ndb* ndb, Ndb* recoveryNdb, DBWatchTable<Tabl
     const int poll_maxTimeToWait, const Barrier barrier) : mNdbConnection(ndb), mStarted(false),
 mEventName(Utils::concat("tail-", table->getName())), mTable(table),
 mPollMaxTimeToWait(poll_maxTimeToWait), mBarrier(barrier),
-mLastReportedBarrier(0), mNdbRecoveryConnection(recoveryNdb), mUnderRecovery(false),
+mLastReportedBarrier(0), mEventEpoch(0), mRecoveryEpoch(0), mEpochRows(0), mEpochBytes(0), mGroupRows(0),
+mGroupBytes(0), mGroupBarriers(0), mGroupsTotal(0), mGroupedRowsTotal(0),
+mGroupedBarriersTotal(0), mGroupsHeld(0), mEventBufferAlert(false),
+mDraining(false), mConsumedEpoch(0), mEventBufferUsedBytes(0),
+mEventBufferAllocatedBytes(0), mEventBufferUsagePercent(0), mGCILag(0),
+mDrainsTotal(0), mEventBufferOverflows(0), mInconsistentEpochs(0),
+mClusterFailures(0), mEventRecorder(nullptr), mLastRecordedEpoch(0),
+mNdbRecoveryConnection(recoveryNdb), mUnderRecovery(false), mRecoveryAborted(false),
     mFirstEpochToWatch(0), mStartProcessingDeferredEvents(false),
-    mLastEpochInRecovery(0) {
+    mLastEpochInRecovery(0), mRecoveryScanDone(false), mRecoveredOldEvents(0),
+    mRecoveredNewEvents(0), mRecoveredExistingEvents(0) {
+  for (int i = 0; i <= EPOCH_GROUP_BUCKETS; i++) {
+    mGroupBuckets[i] = 0;
+  }
 }
 
 template<typename TableRow>
@@ -112,14 +263,54 @@ int poll_maxTimeToWait, const Barrier barrier) : TableTailer(ndb, nullptr, table
   
 }
 
+template<typename TableRow>
+void TableTailer<TableRow>::setEventSource(const EventSourceConf eventSource) {
+  mEventSource = eventSource;
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::setEpochGrouping(const EpochGroupConf epochGroup) {
+  mEpochGroup = epochGroup;
+  if (mEpochGroup.isEnabled()) {
+    LOG_INFO(mTable->getName() << " groups barriers up to "
+        << mEpochGroup.mMaxRows << " rows, " << mEpochGroup.mMaxBytes
+        << " bytes or " << mEpochGroup.mMaxHoldMS << " msec");
+  }
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::setRecoveryEpoch(Uint64 epoch) {
+  mRecoveryEpoch = epoch;
+}
+
+template<typename TableRow>
+Uint64 TableTailer<TableRow>::getEventEpoch() const {
+  return mEventEpoch;
+}
+
 template<typename TableRow>
 void TableTailer<TableRow>::start() {
   if (mStarted) {
     return;
   }
 
+  if (mEventSource.mMode == REPLAY) {
+    mThread = boost::thread(&TableTailer::run, this);
+    LOG_INFO("start " << mEventSource.getString() << " for " << mTable->getName());
+    mStarted = true;
+    return;
+  }
+
+  if (mEventSource.mMode == CAPTURE) {
+    mEventRecorder = new EventRecordWriter(mEventSource.getFile
+        (mTable->getName()), mTable->getName());
+    LOG_INFO("start " << mEventSource.getString() << " for " << mTable->getName());
+  }
+
   mUnderRecovery = mNdbRecoveryConnection != nullptr;
-  createListenerEvent();
+  if (!createListenerEvent()) {
+    LOG_FATAL("failed to create the event of " << mTable->getName());
+  }
   mThread = boost::thread(&TableTailer::run, this);
 
   if(mUnderRecovery) {
@@ -132,62 +323,337 @@ void TableTailer<TableRow>::start() {
   mStarted = true;
 }
 
+/*
+ * reads the log table once with parallel fragment scans. The fragments are
+ * not ordered by epoch, so every scanner sorts the rows it read in runs of
+ * RECOVERY_RUN_ROWS rows and spills the full runs to files, the runs are then
+ * merged by epoch into the bounded buffer that the events thread drains. A
+ * backlog that fits the runs is never written to disk.
+ */
 template<typename TableRow>
 void TableTailer<TableRow>::recover() {
   std::unique_lock<std::mutex> lk(mFirstEpochMutex);
   LOG_DEBUG("Waiting for the firstEpoch to start recovery for " << mTable->getName());
-  mFirstEpochCond.wait(lk, [this]{return mFirstEpochToWatch != 0;});
-  LOG_DEBUG(mTable->getName() << " recovery started for events before epoch "
-  << mFirstEpochToWatch);
-
-  ptime t1 = Utils::getCurrentTime();
-
-  EpochsRowsMap<TableRow> re = mTable->getAllForRecovery
-      (mNdbRecoveryConnection);
-
-  int eventsApplied=0;
-  int eventsToAdd=0;
-  int alreadyExistsingEvents=0;
-
-  for (std::vector<Uint64>::iterator it = re.mEpochs->begin(); it !=
-      re.mEpochs->end(); it++) {
-    Uint64 epoch = *it;
-    std::queue<TableRow>* rows = re.mRowsByEpoch->at(epoch);
-    if(epoch >= mFirstEpochToWatch){
-      while(!rows->empty()){
-        TableRow row = rows->front();
-        //event is not in our deferred queue
-        if(deferEvent(epoch, NdbDictionary::Event::TE_INSERT, row, row)){
-          eventsToAdd++;
-        }else{
-          alreadyExistsingEvents++;
+  mFirstEpochCond.wait(lk, [this]{
+    return mFirstEpochToWatch != 0 || mRecoveryAborted;});
+  if (mRecoveryAborted) {
+    return;
+  }
+  LOG_DEBUG(mTable->getName() << " recovery started for events after epoch "
+  << mRecoveryEpoch << " and before epoch " << mFirstEpochToWatch);
+  lk.unlock();
+
+  mRecoveryStart = Utils::getCurrentTime();
+
+  Uint32 scanners = mTable->getNoRecoveryScanners(mNdbRecoveryConnection,
+      RECOVERY_MAX_SCANNERS);
+  std::vector<Ndb*> connections(scanners, mNdbRecoveryConnection);
+  for (Uint32 s = 1; s < scanners; s++) {
+    connections[s] = new Ndb(&mNdbRecoveryConnection->get_ndb_cluster_connection(),
+        mNdbRecoveryConnection->getDatabaseName());
+    if (connections[s]->init(NDB_MAX_TRANSACTIONS) == -1) {
+      LOG_NDB_API_FATAL(mTable->getName(), connections[s]->getNdbError());
+    }
+  }
+
+  std::vector<std::vector<RecoveryRun> > runs(scanners);
+  std::vector<int> skipped(scanners, 0);
+  boost::thread_group threads;
+  for (Uint32 s = 1; s < scanners; s++) {
+    threads.create_thread(boost::bind(&TableTailer::readRecoveryRuns, this,
+        connections[s], s, scanners, &runs[s], &skipped[s]));
+  }
+  readRecoveryRuns(connections[0], 0, scanners, &runs[0], &skipped[0]);
+  threads.join_all();
+
+  for (Uint32 s = 1; s < scanners; s++) {
+    DictionaryCache::getInstance().release(connections[s]);
+    delete connections[s];
+  }
+
+  if (mRecoveryAborted) {
+    for (std::vector<RecoveryRun>& scannerRuns : runs) {
+      removeRecoveryRuns(scannerRuns);
+    }
+    return;
+  }
+
+  int skippedRows = 0;
+  size_t spilledRuns = 0;
+  for (Uint32 s = 0; s < scanners; s++) {
+    skippedRows += skipped[s];
+    spilledRuns += runs[s].size() - 1;
+  }
+  if (skippedRows > 0) {
+    LOG_WARN(skippedRows << " rows of " << mTable->getName() << " committed "
+        << "before the checkpointed epoch " << mRecoveryEpoch
+        << " were skipped");
+  }
+
+  mergeRecoveryRuns(runs);
+  if (mRecoveryAborted) {
+    return;
+  }
+
+  LOG_INFO(mTable->getName() << " recovery read the log table with "
+  << scanners << " scanners and " << spilledRuns << " spilled runs in "
+  << Utils::getTimeDiffInMilliseconds(mRecoveryStart, Utils::getCurrentTime())
+  << " msec");
+
+  std::unique_lock<std::mutex> buffer(mRecoveredRowsMutex);
+  mRecoveryScanDone = true;
+}
+
+/*
+ * reads the fragments of one scanner, every full run is spilled while the
+ * last one stays in memory at the end of the runs. A scan interrupted by a
+ * temporary error is read again from the start once the cluster is back.
+ */
+template<typename TableRow>
+void TableTailer<TableRow>::readRecoveryRuns(Ndb* connection, Uint32 scanner,
+    Uint32 scanners, std::vector<RecoveryRun>* runs, int* skipped) {
+  ptime start = Utils::getCurrentTime();
+  std::vector<EpochRow<TableRow> > rows;
+  while (true) {
+    try {
+      *skipped = mTable->readForRecovery(connection, scanner, scanners,
+          mRecoveryEpoch, [this, &rows, runs, scanner](EpochRow<TableRow>& row) {
+        if (mRecoveryAborted) {
+          return;
         }
-        rows->pop();
+        rows.push_back(std::move(row));
+        if (rows.size() >= RECOVERY_RUN_ROWS) {
+          runs->push_back(spillRecoveryRun(scanner, runs->size(), rows));
+        }
+      });
+      break;
+    } catch (NdbScanInterrupted& e) {
+      removeRecoveryRuns(*runs);
+      rows.clear();
+      if (mRecoveryAborted) {
+        break;
+      }
+      LOG_WARN(mTable->getName() << " recovery scanner " << scanner
+          << " restarts its scan : " << e.what());
+      waitForCluster(connection, mTable->getName());
+      boost::this_thread::sleep(boost::posix_time::seconds(DELAY_BETWEEN_RETRIES));
+    }
+  }
+
+  std::sort(rows.begin(), rows.end(), [](const EpochRow<TableRow>& a,
+      const EpochRow<TableRow>& b) {
+    return a.mEpoch < b.mEpoch;
+  });
+  runs->push_back(RecoveryRun());
+  runs->back().mRows.swap(rows);
+
+  LOG_DEBUG("ePipe done reading/sorting " << runs->size() << " runs for "
+  << mTable->getName() << " recovery scanner " << scanner << " in "
+  << Utils::getTimeDiffInMilliseconds(start, Utils::getCurrentTime()) << " msec");
+}
+
+/*
+ * writes the rows sorted by epoch in the event record format, an epoch
+ * record after the rows of every epoch flushes them to the file.
+ */
+template<typename TableRow>
+typename TableTailer<TableRow>::RecoveryRun
+TableTailer<TableRow>::spillRecoveryRun(Uint32 scanner, size_t run,
+    std::vector<EpochRow<TableRow> >& rows) {
+  std::sort(rows.begin(), rows.end(), [](const EpochRow<TableRow>& a,
+      const EpochRow<TableRow>& b) {
+    return a.mEpoch < b.mEpoch;
+  });
+
+  const char* dir = std::getenv("TMPDIR");
+  std::stringstream file;
+  file << (dir != nullptr ? dir : "/tmp") << "/epipe-" << getpid() << "-"
+      << mTable->getName() << "-recovery-" << scanner << "-" << run
+      << ".events";
+
+  RecoveryRun spilled;
+  spilled.mFile = file.str();
+  EventRecordWriter writer(spilled.mFile, mTable->getName());
+  for (size_t i = 0; i < rows.size(); i++) {
+    writer.beginEvent(rows[i].mEpoch, NdbDictionary::Event::TE_INSERT);
+    mTable->writeRow(writer, rows[i].mRow);
+    if (i + 1 == rows.size() || rows[i + 1].mEpoch != rows[i].mEpoch) {
+      writer.writeEpoch(rows[i].mEpoch);
+    }
+  }
+  LOG_DEBUG(mTable->getName() << " recovery scanner " << scanner
+      << " spilled " << rows.size() << " rows to " << spilled.mFile);
+  rows.clear();
+  return spilled;
+}
+
+/*
+ * merges the runs of all the scanners by epoch into the buffer, the spilled
+ * runs are read back one row at a time and removed once merged.
+ */
+template<typename TableRow>
+void TableTailer<TableRow>::mergeRecoveryRuns(
+    std::vector<std::vector<RecoveryRun> >& runs) {
+  std::vector<RecoveryCursor> cursors;
+  for (std::vector<RecoveryRun>& scannerRuns : runs) {
+    for (RecoveryRun& run : scannerRuns) {
+      RecoveryCursor cursor = {&run.mRows, 0, run.mFile, nullptr, EpochRow<TableRow>()};
+      if (!run.mFile.empty()) {
+        cursor.mReader = new EventRecordReader(run.mFile, mTable->getName());
       }
-    }else{
-      while(!rows->empty()){
-        TableRow row = rows->front();
-        deferEvent(epoch, NdbDictionary::Event::TE_INSERT, row, row);
-        rows->pop();
-        eventsApplied++;
+      cursors.push_back(cursor);
+    }
+  }
+
+  typedef std::pair<Uint64, size_t> RunHead;
+  std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead> > heads;
+  for (size_t c = 0; c < cursors.size(); c++) {
+    if (nextRecoveredRow(cursors[c])) {
+      heads.push(RunHead(cursors[c].mRow.mEpoch, c));
+    }
+  }
+
+  std::vector<EpochRow<TableRow> > rows;
+  while (!heads.empty()) {
+    if (mRecoveryAborted) {
+      for (RecoveryCursor& cursor : cursors) {
+        closeRecoveryCursor(cursor);
       }
+      return;
+    }
+    RunHead head = heads.top();
+    heads.pop();
+    RecoveryCursor& cursor = cursors[head.second];
+    bool more;
+    do {
+      rows.push_back(std::move(cursor.mRow));
+      more = nextRecoveredRow(cursor);
+    } while (more && cursor.mRow.mEpoch == head.first);
+    if (more) {
+      heads.push(RunHead(cursor.mRow.mEpoch, head.second));
+    }
+    if (rows.size() >= RECOVERY_BUFFER_ROWS / 10) {
+      addRecoveredRows(rows);
+    }
+  }
+  addRecoveredRows(rows);
+}
+
+template<typename TableRow>
+bool TableTailer<TableRow>::nextRecoveredRow(RecoveryCursor& cursor) {
+  if (cursor.mReader == nullptr) {
+    if (cursor.mNext == cursor.mRows->size()) {
+      std::vector<EpochRow<TableRow> >().swap(*cursor.mRows);
+      return false;
+    }
+    cursor.mRow = std::move((*cursor.mRows)[cursor.mNext++]);
+    return true;
+  }
+  while (true) {
+    EventRecordType type = cursor.mReader->nextRecord();
+    if (type == RECORD_EVENT) {
+      cursor.mRow.mEpoch = cursor.mReader->getUInt();
+      cursor.mReader->getUInt();
+      cursor.mRow.mRow = mTable->readRow(*cursor.mReader);
+      return true;
+    }
+    if (type != RECORD_EPOCH) {
+      break;
+    }
+    cursor.mReader->getUInt();
+  }
+  closeRecoveryCursor(cursor);
+  return false;
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::closeRecoveryCursor(RecoveryCursor& cursor) {
+  if (cursor.mReader == nullptr) {
+    return;
+  }
+  delete cursor.mReader;
+  cursor.mReader = nullptr;
+  std::remove(cursor.mFile.c_str());
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::removeRecoveryRuns(std::vector<RecoveryRun>& runs) {
+  for (RecoveryRun& run : runs) {
+    if (!run.mFile.empty()) {
+      std::remove(run.mFile.c_str());
     }
-    delete rows;
   }
+  runs.clear();
+}
+
+/*
+ * blocks the recovery threads while the events thread has not drained the
+ * buffer, so that only the recovery runs and a bounded number of rows are
+ * held during recovery. The rows of an aborted recovery are dropped.
+ */
+template<typename TableRow>
+void TableTailer<TableRow>::addRecoveredRows(std::vector<EpochRow<TableRow> >& rows) {
+  std::unique_lock<std::mutex> lk(mRecoveredRowsMutex);
+  mRecoveredRowsCond.wait(lk, [this]{
+    return mRecoveredRows.size() < RECOVERY_BUFFER_ROWS || mRecoveryAborted;});
+  if (mRecoveryAborted) {
+    rows.clear();
+    return;
+  }
+  for (EpochRow<TableRow>& row : rows) {
+    mRecoveredRows.push_back(std::move(row));
+  }
+  rows.clear();
+}
 
-  delete re.mEpochs;
-  delete re.mRowsByEpoch;
+template<typename TableRow>
+bool TableTailer<TableRow>::hasRecoveredRows() {
+  std::unique_lock<std::mutex> lk(mRecoveredRowsMutex);
+  return !mRecoveredRows.empty();
+}
 
-  mStartProcessingDeferredEvents = true;
+/*
+ * runs on the events thread, the recovered rows older than the first watched
+ * epoch are processed right away in epoch order while the newer ones are
+ * deferred together with the events received during recovery. Every
+ * recovered barrier is sealed by the first row of the next one, the tailer
+ * then waits for capacity like it does between polls.
+ */
+template<typename TableRow>
+void TableTailer<TableRow>::applyRecoveredRows() {
+  std::deque<EpochRow<TableRow> > rows;
+  std::unique_lock<std::mutex> lk(mRecoveredRowsMutex);
+  rows.swap(mRecoveredRows);
+  bool done = mRecoveryScanDone;
+  lk.unlock();
+  mRecoveredRowsCond.notify_all();
+
+  for (EpochRow<TableRow>& row : rows) {
+    if (row.mEpoch < mFirstEpochToWatch) {
+      bool sealed = row.mEpoch != mEventEpoch;
+      processEvent(row.mEpoch, NdbDictionary::Event::TE_INSERT, row.mRow,
+          row.mRow);
+      if (sealed) {
+        waitForCapacity();
+      }
+      mRecoveredOldEvents++;
+    } else if (deferEvent(row.mEpoch, NdbDictionary::Event::TE_INSERT,
+        row.mRow, row.mRow)) {
+      mRecoveredNewEvents++;
+    } else {
+      mRecoveredExistingEvents++;
+    }
+  }
 
-  ptime t2 = Utils::getCurrentTime();
-  LOG_INFO(mTable->getName() << " recovery done in " <<
-  Utils::getTimeDiffInMilliseconds(t1, t2) << " msec : " << eventsApplied
-  << " old events recovered, " << alreadyExistsingEvents
-  << " already captured events, " << eventsToAdd
-  << " concurrent events during recovery, " <<
-  (eventsApplied + eventsToAdd)
-  << " total number of events added to deferred events.");
+  if (done) {
+    mStartProcessingDeferredEvents = true;
+    LOG_INFO(mTable->getName() << " recovery done in " <<
+    Utils::getTimeDiffInMilliseconds(mRecoveryStart, Utils::getCurrentTime())
+    << " msec : " << mRecoveredOldEvents << " old events recovered, "
+    << mRecoveredExistingEvents << " already captured events, "
+    << mRecoveredNewEvents << " concurrent events during recovery added to "
+    << "deferred events.");
+  }
 }
 
 template<typename TableRow>
@@ -200,7 +666,11 @@ void TableTailer<TableRow>::waitToFinish() {
 template<typename TableRow>
 void TableTailer<TableRow>::run() {
   try {
-    waitForEvents();
+    if (mEventSource.mMode == REPLAY) {
+      replayEvents();
+    } else {
+      waitForEvents();
+    }
   } catch (boost::thread_interrupted&) {
     LOG_ERROR("Thread is stopped");
     return;
@@ -208,12 +678,18 @@ void TableTailer<TableRow>::run() {
 }
 
 template<typename TableRow>
-void TableTailer<TableRow>::createListenerEvent() {
+bool TableTailer<TableRow>::createListenerEvent() {
   NdbDictionary::Dictionary *myDict = mNdbConnection->getDictionary();
-  if (!myDict) LOG_NDB_API_FATAL(mTable->getName(), mNdbConnection->getNdbError());
+  if (!myDict) {
+    LOG_NDB_API_ERROR(mTable->getName(), mNdbConnection->getNdbError());
+    return false;
+  }
 
   const NdbDictionary::Table *table = myDict->getTable(mTable->getName().c_str());
-  if (!table) LOG_NDB_API_FATAL(mTable->getName(), myDict->getNdbError());
+  if (!table) {
+    LOG_NDB_API_ERROR(mTable->getName(), myDict->getNdbError());
+    return false;
+  }
 
   NdbDictionary::Event myEvent(mEventName.c_str(), *table);
 
@@ -231,16 +707,20 @@ void TableTailer<TableRow>::createListenerEvent() {
              NdbError::SchemaObjectExists) {
     LOG_DEBUG("Event creation failed, event exists, dropping Event...");
     if (myDict->dropEvent(mEventName.c_str(), 1)) {
-      LOG_NDB_API_FATAL(mTable->getName(), myDict->getNdbError());
+      LOG_NDB_API_ERROR(mTable->getName(), myDict->getNdbError());
+      return false;
     }
     // try again
     // Add event to database
     if (myDict->createEvent(myEvent)) {
-      LOG_NDB_API_FATAL(mTable->getName(), myDict->getNdbError());
+      LOG_NDB_API_ERROR(mTable->getName(), myDict->getNdbError());
+      return false;
     }
   } else {
-    LOG_NDB_API_FATAL(mTable->getName(), myDict->getNdbError());
+    LOG_NDB_API_ERROR(mTable->getName(), myDict->getNdbError());
+    return false;
   }
+  return true;
 }
 
 template<typename TableRow>
@@ -252,27 +732,134 @@ void TableTailer<TableRow>::removeListenerEvent() {
 }
 
 template<typename TableRow>
-void TableTailer<TableRow>::waitForEvents() {
+NdbEventOperation* TableTailer<TableRow>::subscribe(RowValues& recAttr,
+    RowValues& recAttrPre) {
   NdbEventOperation* op;
   LOG_INFO("create EventOperation for [" << mEventName << "]");
-  if ((op = mNdbConnection->createEventOperation(mEventName.c_str())) == NULL)
-    LOG_NDB_API_FATAL(mTable->getName(), mNdbConnection->getNdbError());
-
-  NdbRecAttr * recAttr[mTable->getNoColumns()];
-  NdbRecAttr * recAttrPre[mTable->getNoColumns()];
+  if ((op = mNdbConnection->createEventOperation(mEventName.c_str())) == NULL) {
+    LOG_NDB_API_ERROR(mTable->getName(), mNdbConnection->getNdbError());
+    return nullptr;
+  }
 
   // primary keys should always be a part of the result
   for (strvec_size_type i = 0; i < mTable->getNoColumns(); i++) {
-    recAttr[i] = op->getValue(mTable->getColumn(i).c_str());
-    recAttrPre[i] = op->getPreValue(mTable->getColumn(i).c_str());
+    recAttr.set(i, op->getValue(mTable->getColumn(i).c_str()));
+    recAttrPre.set(i, op->getPreValue(mTable->getColumn(i).c_str()));
   }
 
   LOG_INFO("Execute");
   // This starts changes to "start flowing"
-  if (op->execute())
-    LOG_NDB_API_FATAL(mTable->getName(), op->getNdbError());
+  if (op->execute()) {
+    LOG_NDB_API_ERROR(mTable->getName(), op->getNdbError());
+    mNdbConnection->dropEventOperation(op);
+    return nullptr;
+  }
+  return op;
+}
+
+/*
+ * the subscription does not survive a cluster failure, the pending rows are
+ * released, the event is recreated once the cluster is back and the rows
+ * committed meanwhile are read by a recovery starting after the last
+ * consumed epoch, while the caches and the queued rows are kept. A recovery
+ * that was still running is started over from its first epoch, the rows it
+ * already handed downstream are then processed again.
+ */
+template<typename TableRow>
+NdbEventOperation* TableTailer<TableRow>::resubscribe(
+    NdbEventOperation* subscription, RowValues& recAttr, RowValues& recAttrPre) {
+  Uint64 resumeEpoch = mUnderRecovery ? mRecoveryEpoch : mConsumedEpoch;
+  mClusterFailures++;
+  LOG_WARN(mTable->getName() << " lost the cluster after epoch " << mConsumedEpoch
+      << " GCI " << getGCI(mConsumedEpoch) << ", resubscribing"
+      << (mUnderRecovery ? " and restarting the running recovery" : ""));
+
+  barrierChanged();
+  sealGroupBarrier();
+  flushGroup();
+  mNdbConnection->dropEventOperation(subscription);
+
+  while (true) {
+    waitForCluster(mNdbConnection, mTable->getName());
+    DictionaryCache::getInstance().invalidate(mTable->getName());
+    if (createListenerEvent()) {
+      subscription = subscribe(recAttr, recAttrPre);
+      if (subscription != nullptr) {
+        break;
+      }
+    }
+    boost::this_thread::sleep(boost::posix_time::seconds(DELAY_BETWEEN_RETRIES));
+  }
+
+  if (mNdbRecoveryConnection != nullptr) {
+    restartRecovery(resumeEpoch);
+  } else {
+    LOG_WARN(mTable->getName() << " resubscribed without recovery, the rows "
+        << "committed after epoch " << resumeEpoch << " while the cluster was "
+        << "down are only read by the next recovery");
+  }
+  return subscription;
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::restartRecovery(Uint64 epoch) {
+  if (mRecoveryThread.joinable()) {
+    std::unique_lock<std::mutex> lk(mFirstEpochMutex);
+    std::unique_lock<std::mutex> buffer(mRecoveredRowsMutex);
+    mRecoveryAborted = true;
+    buffer.unlock();
+    lk.unlock();
+    mFirstEpochCond.notify_all();
+    mRecoveredRowsCond.notify_all();
+    mRecoveryThread.join();
+    mRecoveryAborted = false;
+  }
+  std::unique_lock<std::mutex> lk(mFirstEpochMutex);
+  mFirstEpochToWatch = 0;
+  lk.unlock();
+  std::unique_lock<std::mutex> buffer(mRecoveredRowsMutex);
+  mRecoveredRows.clear();
+  mRecoveryScanDone = false;
+  buffer.unlock();
+
+  // the deferred events are read again by the new recovery
+  mEventsDuringRecovery.clear();
+  mEventsPKDuringRecovery.clear();
+  mEpochsDuringRecovery.clear();
+
+  mRecoveryEpoch = std::max(mRecoveryEpoch, epoch);
+  mLastEpochInRecovery = 0;
+  mStartProcessingDeferredEvents = false;
+  mRecoveredOldEvents = 0;
+  mRecoveredNewEvents = 0;
+  mRecoveredExistingEvents = 0;
+  mUnderRecovery = true;
+  mRecoveryThread = boost::thread(&TableTailer::recover, this);
+  LOG_INFO("restart recovery after epoch " << mRecoveryEpoch << " for "
+      << mTable->getName());
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::waitForEvents() {
+  NdbEventOperation* op;
+  // the values are bound once, every event is decoded through them
+  RowValues recAttr(mTable->getNoColumns());
+  RowValues recAttrPre(mTable->getNoColumns());
+
+  NdbEventOperation* subscription = subscribe(recAttr, recAttrPre);
+  if (subscription == nullptr) {
+    LOG_FATAL("failed to subscribe to the events of " << mTable->getName());
+  }
   while (true) {
-    int r = mNdbConnection->pollEvents2(mPollMaxTimeToWait);
+    checkEventBuffer();
+    waitForCapacity();
+    bool recovering = mUnderRecovery && !mStartProcessingDeferredEvents;
+    int r = mNdbConnection->pollEvents2(mDraining ? 0 :
+        getPollTimeout(recovering));
+    // the epochs received by the poll but not consumed yet
+    Uint64 queued = getGCI(mNdbConnection->getHighestQueuedEpoch());
+    Uint64 consumed = getGCI(mConsumedEpoch);
+    mGCILag = mConsumedEpoch > 0 && queued > consumed ? queued - consumed : 0;
 
     if (mFirstEpochToWatch == 0) {
       std::unique_lock<std::mutex> lk(mFirstEpochMutex);
@@ -283,6 +870,10 @@ void TableTailer<TableRow>::waitForEvents() {
       mFirstEpochCond.notify_all();
     }
 
+    if (recovering) {
+      applyRecoveredRows();
+    }
+
     if (mStartProcessingDeferredEvents) {
       if(mLastEpochInRecovery == 0 && !mEpochsDuringRecovery.empty()){
         std::vector<Uint64> orderedEpochs;
@@ -308,8 +899,9 @@ void TableTailer<TableRow>::waitForEvents() {
       }
     }
 
+    bool clusterFailure = false;
     if (r > 0) {
-      while ((op = mNdbConnection->nextEvent2())) {
+      while (!clusterFailure && (op = mNdbConnection->nextEvent2())) {
         NdbDictionary::Event::TableEvent event = op->getEventType2();
 
         if (event != NdbDictionary::Event::TE_EMPTY) {
@@ -329,16 +921,112 @@ void TableTailer<TableRow>::waitForEvents() {
             }
             break;
           }
+          case NdbDictionary::Event::TE_CLUSTER_FAILURE: {
+            clusterFailure = true;
+            break;
+          }
+          case NdbDictionary::Event::TE_OUT_OF_MEMORY:
+          case NdbDictionary::Event::TE_INCONSISTENT: {
+            handleEventBufferLoss(event, op->getEpoch());
+            break;
+          }
+          case NdbDictionary::Event::TE_ALTER:
+          case NdbDictionary::Event::TE_DROP: {
+            LOG_WARN(mTable->getName() << " got schema change event "
+                << getEventName(event));
+            DictionaryCache::getInstance().invalidate(mTable->getName());
+            break;
+          }
           default:
             break;
         }
-
+        if (!clusterFailure) {
+          mConsumedEpoch = op->getEpoch();
+        }
       }
     }
+    if (clusterFailure) {
+      subscription = resubscribe(subscription, recAttr, recAttrPre);
+      continue;
+    }
     //        boost::this_thread::sleep(boost::posix_time::milliseconds(mPollMaxTimeToWait));
-    checkIfBarrierReached(mNdbConnection->getHighestQueuedEpoch());
+    // every queued epoch was consumed, the empty ones have no events
+    mConsumedEpoch = mNdbConnection->getHighestQueuedEpoch();
+    recordEpoch(mNdbConnection->getHighestQueuedEpoch());
+    // the events are deferred during recovery, the barriers follow the
+    // epochs of the recovered rows until then
+    if (!mUnderRecovery) {
+      checkIfBarrierReached(mNdbConnection->getHighestQueuedEpoch());
+    }
+    if (mGroupRows > 0 && getGroupHoldLeft() == 0) {
+      flushGroup();
+    }
+  }
+
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::replayEvents() {
+  EventRecordReader reader(mEventSource.getFile(mTable->getName()),
+      mTable->getName());
+  ptime start = Utils::getCurrentTime();
+  int events = 0;
+  int epochs = 0;
+
+  while (true) {
+    EventRecordType type = reader.nextRecord();
+    if (type == RECORD_END) {
+      break;
+    }
+
+    if (!mEventSource.mReplayMaxSpeed) {
+      ptime due = start + boost::posix_time::microseconds(reader.getTimeOffset());
+      ptime now = Utils::getCurrentTime();
+      if (due > now) {
+        boost::this_thread::sleep(due - now);
+      }
+    }
+
+    switch (type) {
+      case RECORD_EVENT: {
+        Uint64 epoch = reader.getUInt();
+        NdbDictionary::Event::TableEvent event =
+            static_cast<NdbDictionary::Event::TableEvent> (reader.getUInt());
+        TableRow pre = mTable->readRow(reader);
+        TableRow row = mTable->readRow(reader);
+        processEvent(epoch, event, pre, row);
+        events++;
+        break;
+      }
+      case RECORD_EPOCH: {
+        checkIfBarrierReached(reader.getUInt());
+        epochs++;
+        waitForCapacity();
+        break;
+      }
+      default:
+        LOG_FATAL("unknown record type " << type << " while replaying "
+        << mTable->getName());
+    }
   }
 
+  //flush whatever is pending in the last epoch
+  barrierChanged();
+  sealGroupBarrier();
+  flushGroup();
+
+  double elapsed = Utils::getTimeDiffInMilliseconds(start, Utils::getCurrentTime());
+  LOG_INFO(mTable->getName() << " replayed " << events << " events in "
+  << epochs << " epochs in " << elapsed << " msec");
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::recordEpoch(Uint64 epoch) {
+  if (mEventRecorder == nullptr || epoch == mLastRecordedEpoch) {
+    return;
+  }
+  mEventRecorder->writeEpoch(epoch);
+  mLastRecordedEpoch = epoch;
 }
 
 template<typename TableRow>
@@ -385,6 +1073,200 @@ void TableTailer<TableRow>::barrierChanged() {
   //do nothing
 }
 
+template<typename TableRow>
+void TableTailer<TableRow>::waitForCapacity() {
+  //do nothing
+}
+
+template<typename TableRow>
+bool TableTailer<TableRow>::checkEventBuffer() {
+  if (mEventSource.mMode == REPLAY) {
+    return false;
+  }
+  Ndb::EventBufferMemoryUsage usage;
+  mNdbConnection->getEventBufferUsage(usage);
+  mEventBufferUsedBytes = usage.used_bytes;
+  mEventBufferAllocatedBytes = usage.allocated_bytes;
+  mEventBufferUsagePercent = usage.usage_percent;
+  if (!mEventBufferAlert && usage.usage_percent >= EVENT_BUFFER_ALERT_PERCENT) {
+    mEventBufferAlert = true;
+    LOG_WARN(mTable->getName() << " event buffer is " << usage.usage_percent
+        << "% full (" << usage.used_bytes << "/" << usage.allocated_bytes
+        << " bytes), " << mGCILag << " GCIs behind");
+  }
+  if (!mDraining && usage.usage_percent >= EVENT_BUFFER_DRAIN_PERCENT) {
+    mDraining = true;
+    mDrainsTotal++;
+    LOG_WARN(mTable->getName() << " event buffer is " << usage.usage_percent
+        << "% full, draining it up to " << MEMORY_BUDGET_DRAIN_FACTOR
+        << " times the memory budget");
+  }
+  if (mEventBufferAlert && usage.usage_percent < EVENT_BUFFER_ALERT_PERCENT / 2) {
+    mEventBufferAlert = false;
+    mDraining = false;
+    LOG_INFO(mTable->getName() << " event buffer is back to "
+        << usage.usage_percent << "%, " << mGCILag << " GCIs behind");
+  }
+  return mDraining;
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::handleEventBufferLoss(
+    NdbDictionary::Event::TableEvent event, Uint64 epoch) {
+  if (event == NdbDictionary::Event::TE_OUT_OF_MEMORY) {
+    mEventBufferOverflows++;
+  } else {
+    mInconsistentEpochs++;
+  }
+  LOG_ERROR(mTable->getName() << " got " << getEventName(event)
+      << " for epoch " << epoch << " GCI " << getGCI(epoch) << ", events of "
+      << "this epoch were lost, the log rows stay in the table until the "
+      << "next recovery");
+}
+
+template<typename TableRow>
+std::string TableTailer<TableRow>::getEventBufferMetrics(const std::string& table) {
+  std::stringstream out;
+  std::string labels = "{table=\"" + table + "\"} ";
+  out << "epipe_tailer_event_buffer_used_bytes" << labels
+      << mEventBufferUsedBytes << std::endl;
+  out << "epipe_tailer_event_buffer_allocated_bytes" << labels
+      << mEventBufferAllocatedBytes << std::endl;
+  out << "epipe_tailer_event_buffer_usage_percent" << labels
+      << mEventBufferUsagePercent << std::endl;
+  out << "epipe_tailer_gci_lag" << labels << mGCILag << std::endl;
+  out << "epipe_tailer_event_buffer_draining" << labels
+      << (mDraining ? 1 : 0) << std::endl;
+  out << "epipe_tailer_event_buffer_drains_total" << labels << mDrainsTotal
+      << std::endl;
+  out << "epipe_tailer_event_buffer_overflows_total" << labels
+      << mEventBufferOverflows << std::endl;
+  out << "epipe_tailer_inconsistent_epochs_total" << labels
+      << mInconsistentEpochs << std::endl;
+  out << "epipe_tailer_cluster_failures_total" << labels << mClusterFailures
+      << std::endl;
+  return out.str();
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::releaseGroup() {
+  //do nothing
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::addToEpoch(Uint64 bytes) {
+  if (mEpochRows == 0) {
+    mEpochStart = Utils::getCurrentTime();
+  }
+  mEpochRows++;
+  mEpochBytes += bytes;
+}
+
+template<typename TableRow>
+Uint64 TableTailer<TableRow>::getHeldBytes() const {
+  return mEpochBytes + mGroupBytes;
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::sealGroupBarrier() {
+  if (mEpochRows > 0) {
+    if (mGroupRows == 0) {
+      mGroupStart = mEpochStart;
+    }
+    mGroupRows += mEpochRows;
+    mGroupBytes += mEpochBytes;
+    mEpochRows = 0;
+    mEpochBytes = 0;
+  }
+  if (mGroupRows == 0) {
+    return;
+  }
+  mGroupBarriers++;
+  if (!mEpochGroup.isEnabled() || isGroupFull() || getGroupHoldLeft() == 0) {
+    flushGroup();
+  }
+}
+
+template<typename TableRow>
+bool TableTailer<TableRow>::isGroupFull() {
+  return (mEpochGroup.mMaxRows > 0 && mGroupRows >= static_cast<Uint64>
+      (mEpochGroup.mMaxRows)) || (mEpochGroup.mMaxBytes > 0 && mGroupBytes
+      >= static_cast<Uint64>(mEpochGroup.mMaxBytes));
+}
+
+template<typename TableRow>
+int TableTailer<TableRow>::getGroupHoldLeft() {
+  int held = Utils::getTimeDiffInMilliseconds(mGroupStart,
+      Utils::getCurrentTime());
+  return std::max(mEpochGroup.mMaxHoldMS - held, 0);
+}
+
+template<typename TableRow>
+int TableTailer<TableRow>::getPollTimeout(bool recovering) {
+  if (recovering && hasRecoveredRows()) {
+    return 0;
+  }
+  if (mGroupRows > 0) {
+    return std::min(mPollMaxTimeToWait, getGroupHoldLeft());
+  }
+  return mPollMaxTimeToWait;
+}
+
+template<typename TableRow>
+void TableTailer<TableRow>::flushGroup() {
+  if (mGroupRows == 0) {
+    return;
+  }
+  bool held = mEpochGroup.isEnabled() && !isGroupFull();
+  LOG_TRACE(mTable->getName() << " release group of " << mGroupBarriers
+      << " barriers, " << mGroupRows << " rows, " << mGroupBytes << " bytes"
+      << (held ? " after the hold time" : ""));
+  releaseGroup();
+
+  int bucket = 0;
+  Uint64 le = 1;
+  while (bucket < EPOCH_GROUP_BUCKETS && mGroupRows > le) {
+    bucket++;
+    le *= 4;
+  }
+  mGroupBuckets[bucket]++;
+  mGroupsTotal++;
+  mGroupedRowsTotal += mGroupRows;
+  mGroupedBarriersTotal += mGroupBarriers;
+  if (held) {
+    mGroupsHeld++;
+  }
+  mGroupRows = 0;
+  mGroupBytes = 0;
+  mGroupBarriers = 0;
+}
+
+template<typename TableRow>
+std::string TableTailer<TableRow>::getEpochGroupMetrics(const std::string& table) {
+  std::stringstream out;
+  std::string labels = "table=\"" + table + "\"";
+  Uint64 count = 0;
+  Uint64 le = 1;
+  for (int i = 0; i < EPOCH_GROUP_BUCKETS; i++) {
+    count += mGroupBuckets[i];
+    out << "epipe_tailer_group_rows_bucket{" << labels << ",le=\"" << le
+        << "\"} " << count << std::endl;
+    le *= 4;
+  }
+  count += mGroupBuckets[EPOCH_GROUP_BUCKETS];
+  out << "epipe_tailer_group_rows_bucket{" << labels << ",le=\"+Inf\"} "
+      << count << std::endl;
+  out << "epipe_tailer_group_rows_sum{" << labels << "} " << mGroupedRowsTotal
+      << std::endl;
+  out << "epipe_tailer_group_rows_count{" << labels << "} " << mGroupsTotal
+      << std::endl;
+  out << "epipe_tailer_group_barriers_total{" << labels << "} "
+      << mGroupedBarriersTotal << std::endl;
+  out << "epipe_tailer_group_held_total{" << labels << "} " << mGroupsHeld
+      << std::endl;
+  return out.str();
+}
+
 template<typename TableRow>
 Uint64 TableTailer<TableRow>::getGCI(Uint64 epoch) {
   return (epoch & 0xffffffff00000000) >> 32;
@@ -405,6 +1287,7 @@ void TableTailer<TableRow>::checkIfBarrierReached(Uint64 epoch) {
     barrierChanged();
     mLastReportedBarrier = currentBarrier;
     LOG_TRACE("************************** NEW BARRIER [" << currentBarrier << "] ************ ");
+    sealGroupBarrier();
   }
 }
 
@@ -412,8 +1295,8 @@ template<typename TableRow>
 bool TableTailer<TableRow>::deferEvent(Uint64 epoch,
     NdbDictionary::Event::TableEvent event, TableRow pre, TableRow row) {
   //event already exists
-  if(mEventsPKDuringRecovery.find(mTable->getPKStr(row)) !=
-     mEventsPKDuringRecovery.end()){
+  RowKey key = WatchRowKey<TableRow>::get(mTable, row);
+  if(mEventsPKDuringRecovery.find(key) != mEventsPKDuringRecovery.end()){
     return false;
   }
 
@@ -423,7 +1306,7 @@ bool TableTailer<TableRow>::deferEvent(Uint64 epoch,
   }
 
   mEventsDuringRecovery[epoch].push({event, pre, row});
-  mEventsPKDuringRecovery.insert(mTable->getPKStr(row));
+  mEventsPKDuringRecovery.insert(key);
   mEpochsDuringRecovery.insert(epoch);
   return true;
 }
@@ -431,7 +1314,13 @@ bool TableTailer<TableRow>::deferEvent(Uint64 epoch,
 template<typename TableRow>
 void TableTailer<TableRow>::processEvent(Uint64 epoch,
     NdbDictionary::Event::TableEvent event, TableRow pre, TableRow row) {
+  if (mEventRecorder != nullptr) {
+    mEventRecorder->beginEvent(epoch, event);
+    mTable->writeRow(*mEventRecorder, pre);
+    mTable->writeRow(*mEventRecorder, row);
+  }
   checkIfBarrierReached(epoch);
+  mEventEpoch = epoch;
   handleEvent(event, pre, row);
 }
 
@@ -461,6 +1350,7 @@ int TableTailer<TableRow>::processDeferredEvents() {
 
 template<typename TableRow>
 TableTailer<TableRow>::~TableTailer() {
+  delete mEventRecorder;
   delete mNdbConnection;
 }
 #endif /* TABLETAILER_H */
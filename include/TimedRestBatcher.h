@@ -26,6 +26,8 @@
 #include "tables/DBTableBase.h"
 #include "http/HttpClient.h"
 #include "tables/DBWatchTable.h"
+#include "MemoryBudget.h"
+#include "BatchController.h"
 
 struct eEvent{
   enum EventType{
@@ -40,39 +42,51 @@ struct eEvent{
     Dataset = 2,
     Project = 3
   };
+  enum ItemStatus{
+    ItemUnknown = 0,
+    ItemSucceeded = 1,
+    ItemFailed = 2
+  };
 
-  eEvent(const LogHandler* ptr, const ptime arrivalTime, const
-  std::string json, const EventType eventType, const AssetType assetType) 
-  : mLogHandler(ptr), mArrivalTime(arrivalTime), mEventType(eventType), mAssetType(assetType){
-    mJSON = json + "\n";
+  eEvent(const LogHandler* ptr, const ptime arrivalTime,
+  std::string json, const Uint32 bulkItems, const EventType eventType,
+  const AssetType assetType) 
+  : mLogHandler(ptr), mArrivalTime(arrivalTime), mJSON(std::move(json)),
+  mBulkItems(bulkItems), mEventType(eventType), mAssetType(assetType),
+  mItemStatus(ItemUnknown){
+    mJSON.push_back('\n');
   }
 
- eEvent(const LogHandler* ptr, const ptime arrivalTime, const
-  std::string json) : eEvent(ptr, arrivalTime, json, EventType::EventNA, AssetType::AssetNA){
+ eEvent(const LogHandler* ptr, const ptime arrivalTime,
+  std::string json, const Uint32 bulkItems) : eEvent(ptr, arrivalTime, std::move(json), bulkItems, EventType::EventNA, AssetType::AssetNA){
  
   }
 
-  const LogHandler* getLogHandler(){
+  const LogHandler* getLogHandler() const{
     return mLogHandler;
   };
 
-  const ptime& getArrivalTime(){
+  const ptime& getArrivalTime() const{
     return mArrivalTime;
   }
 
-  const std::string& getJSON(){
+  const std::string& getJSON() const{
     return mJSON;
   }
 
-  EventType getEventType(){
+  bool hasJSON() const{
+    return mJSON.length() > 1;
+  }
+
+  EventType getEventType() const{
     return mEventType;
   }
 
-  AssetType getAssetType(){
+  AssetType getAssetType() const{
     return mAssetType;
   }
 
-  std::string getAssetTypeString(){
+  std::string getAssetTypeString() const{
     switch(mAssetType){
       case AssetType::INode:
         return "inodes";
@@ -83,13 +97,37 @@ struct eEvent{
     }
     return "";
   }
-  
+
+  /*
+   * number of actions of the event in a bulk request, as counted by the
+   * writer of its json.
+   */
+  Uint32 getBulkItems() const{
+    return mBulkItems;
+  }
+
+  void setItemStatus(ItemStatus status, const std::string& error = ""){
+    mItemStatus = status;
+    mItemError = error;
+  }
+
+  ItemStatus getItemStatus() const{
+    return mItemStatus;
+  }
+
+  const std::string& getItemError() const{
+    return mItemError;
+  }
+
 private:
   const LogHandler* mLogHandler;
   ptime mArrivalTime;
   std::string mJSON;
+  Uint32 mBulkItems;
   EventType mEventType;
   AssetType mAssetType;
+  ItemStatus mItemStatus;
+  std::string mItemError;
 };
 
 struct eBulk {
@@ -101,18 +139,26 @@ struct eBulk {
 
   std::vector<const LogHandler*> mLogHandlers;
 
-  void push(const ptime arrivaltime, const std::string json){
-    push(nullptr, arrivaltime, json);
+  eBulk() : mProcessingIndex(0), mJSONLength(0) {
+  }
+
+  /*
+   * items is the number of bulk actions in json, it maps the items of the
+   * bulk response back to the events.
+   */
+  void push(const ptime arrivaltime, std::string json, Uint32 items){
+    push(nullptr, arrivaltime, std::move(json), items);
   }
 
-  void push(const LogHandler* lh, const ptime arrivaltime, const std::string json){
-    push(lh, arrivaltime, json, eEvent::EventType::EventNA, eEvent::AssetType::AssetNA);
+  void push(const LogHandler* lh, const ptime arrivaltime, std::string json,
+      Uint32 items){
+    push(lh, arrivaltime, std::move(json), items, eEvent::EventType::EventNA, eEvent::AssetType::AssetNA);
   }
 
-  void push(const LogHandler* lh, const ptime arrivaltime, const
-  std::string json, const eEvent::EventType eventType, const eEvent::AssetType assetType){
-    eEvent e(lh, arrivaltime, json, eventType, assetType);
-    mEvents.push_back(e);
+  void push(const LogHandler* lh, const ptime arrivaltime,
+  std::string json, Uint32 items, const eEvent::EventType eventType, const eEvent::AssetType assetType){
+    mEvents.emplace_back(lh, arrivaltime, std::move(json), items, eventType, assetType);
+    eEvent& e = mEvents.back();
     mJSONLength += e.getJSON().length();
     mArrivalTimes.push_back(e.getArrivalTime());
     mLogHandlers.push_back(e.getLogHandler());
@@ -126,13 +172,15 @@ struct eBulk {
     }
   }
 
-  std::string batchJSON(){
-    std::string out;
-    for(auto e : mEvents){
-      out += e.getJSON();
+  /*
+   * appends the events json to the chain without copying them, the bulk must
+   * not be modified until the chain was written.
+   */
+  void appendBuffers(HttpBufferChain& chain){
+    for(eEvent& e : mEvents){
+      chain.push_back(net::buffer(e.getJSON()));
     }
-    out += "\n";
-    return out;
+    chain.push_back(net::buffer("\n", 1));
   }
 
   int getCount(LogType type){
@@ -182,7 +230,7 @@ struct eBulk {
     std::stringstream out;
     out << "Bulk[" << mProcessingIndex << "] " << std::endl 
         << mEvents.size() << " events" << std::endl;
-    for(auto event : mEvents){
+    for(const eEvent& event : mEvents){
       std::string _logdesc = "N/A";
       if(event.getLogHandler() != nullptr){
         _logdesc = event.getLogHandler()->getDescription();
@@ -198,52 +246,127 @@ private:
 
 };
 
+struct eBatch{
+  Uint64 mIndex;
+  std::vector<eBulk>* mBulks;
+  bool mSent;
+  ptime mStartTime;
+};
+
+struct BulkItemError{
+  Uint32 mItem;
+  int mStatus;
+  std::string mError;
+};
+
 struct ParsingResponse{
   bool mSuccess;
   bool mRetryable;
   std::string errorMsg;
+  std::vector<BulkItemError> mItemErrors;
+  Uint32 mItems;
 };
 
 class TimedRestBatcher : public Batcher {
 public:
-  TimedRestBatcher(const HttpClientConfig elastic_client_config, int time_to_wait_before_inserting, int bulk_size);
+  TimedRestBatcher(const HttpClientConfig elastic_client_config, int time_to_wait_before_inserting, int bulk_size,
+      int max_in_flight_batches, const std::string pipe_name);
 
   void addData(eBulk data);
+
+  const std::string& getPipeName() const;
+
+  void setBatchController(BatchController* controller);
   
   void shutdown();
   
   virtual ~TimedRestBatcher();
 
 protected:
-  bool mElasticConnetionFailed;
-  ptime mTimeElasticConnectionFailed;
-  Uint32 mCurrentQueueSize;
+  boost::atomic<Uint32> mCurrentQueueSize;
 
-  ParsingResponse httpPostRequest(std::string requestUrl, std::string json);
+  ParsingResponse httpPostRequest(std::string requestUrl, const std::string& json);
+  ParsingResponse httpPostRequest(std::string requestUrl, const HttpBufferChain& body);
   ParsingResponse httpDeleteRequest(std::string requestUrl);
 
-  virtual void process(std::vector<eBulk>* data) = 0;
+  /*
+   * send posts a batch to elastic and returns whether it succeeded, up to
+   * mMaxInFlight batches are sent concurrently. acknowledge is then called
+   * for every batch in the order the batches were created, so that logs are
+   * removed in order.
+   */
+  virtual bool send(std::vector<eBulk>* data) = 0;
+  virtual void acknowledge(std::vector<eBulk>* data, bool sent, ptime start_time) = 0;
 
   virtual ParsingResponse parseResponse(std::string response) = 0;
 
+  /*
+   * called on shutdown once every batch was acknowledged.
+   */
+  virtual void drained() {
+  }
+
+  /*
+   * maps the failed items of a bulk response back to the events of the
+   * batch, returns false if the response has no per item results or their
+   * number does not match the actions sent, then the whole batch has to be
+   * treated as failed.
+   */
+  bool setBulkItemStatus(std::vector<eBulk>* data, const ParsingResponse& response);
+
+  /*
+   * returns whether any request is currently retrying a failed connection to
+   * elastic, and since when the oldest of them is failing.
+   */
+  bool getElasticConnectionFailure(ptime& failedSince);
+
 private:
   ConcurrentQueue<eBulk> mQueue;
   std::vector<eBulk>* mToProcess;
   int mToProcessLength;
   boost::mutex mLock;
   bool mShutdown;
+  // guarded by mLock, updated by every sender thread
+  int mFailingRequests;
+  ptime mTimeElasticConnectionFailed;
   HttpClient mHttpClient;
   int mToProcessEvents;
 
+  const std::string mPipeName;
+  MemoryGauge* mQueueGauge;
+  MemoryGauge* mPendingGauge;
+
+  const int mMaxInFlight;
+  ConcurrentQueue<eBatch*> mSendQueue;
+  std::vector<boost::thread*> mSenders;
+  std::map<Uint64, eBatch*> mSentBatches;
+  boost::mutex mAckLock;
+  boost::condition_variable mAckCond;
+  Uint64 mNextBatchIndex;
+  Uint64 mNextToAcknowledge;
+  int mInFlight;
+  bool mAcknowledging;
+  boost::atomic<bool> mFlushRequested;
+  BatchController* mBatchController;
+
   virtual void run();
   virtual void processBatch();
+  virtual void timerExpired();
+  void dispatch(std::vector<eBulk>* data);
+  void sender();
+  void acknowledgeInOrder(eBatch* batch);
+  void waitForInFlightBatches();
+  void observe(std::vector<eBulk>* data, ptime start_time);
+  void released(std::vector<eBulk>* data);
 
   enum HttpVerb{
     POST,
     DELETE
   };
 
-  ParsingResponse handleHttpRequestWithRetry(HttpVerb verb, std::string requestUrl, std::string json);
+  ParsingResponse handleHttpRequestWithRetry(HttpVerb verb, std::string requestUrl, const HttpBufferChain& body);
+  void elasticConnectionFailed(ptime failedAt);
+  void elasticConnectionRecovered();
 
 };
 #endif //TIMEDRESTBATCHER_H
\ No newline at end of file
@@ -56,6 +56,7 @@ typedef std::vector<Int64> LVec;
 #define VERBOSE 0
 #define WAIT_UNTIL_READY 30
 #define DEFAULT_MAX_CAPACITY 10000
+#define NDB_MAX_TRANSACTIONS 64
 
 struct TableUnitConf {
   int mWaitTime;
@@ -101,5 +102,49 @@ struct TableUnitConf {
   }
 };
 
+/*
+ * consecutive barriers of a table tailer are merged into one group until it
+ * holds mMaxRows rows or mMaxBytes bytes, or its oldest row waited mMaxHoldMS
+ * miliseconds. A zero threshold is ignored, grouping is disabled without a
+ * hold time so that every barrier is released on its own.
+ */
+struct EpochGroupConf {
+  int mMaxRows;
+  int mMaxBytes;
+  int mMaxHoldMS;
+
+  EpochGroupConf() {
+    mMaxRows = 0;
+    mMaxBytes = 0;
+    mMaxHoldMS = 0;
+  }
+
+  IVec getVector() {
+    IVec d;
+    d.push_back(mMaxRows);
+    d.push_back(mMaxBytes);
+    d.push_back(mMaxHoldMS);
+    return d;
+  }
+
+  void update(std::vector<int> v) {
+    if (v.size() == 3) {
+      mMaxRows = v[0];
+      mMaxBytes = v[1];
+      mMaxHoldMS = v[2];
+    }
+  }
+
+  std::string getString() {
+    std::stringstream str;
+    str << mMaxRows << " " << mMaxBytes << " " << mMaxHoldMS;
+    return str.str();
+  }
+
+  bool isEnabled() const {
+    return mMaxHoldMS > 0;
+  }
+};
+
 #endif /* COMMON_H */
 
@@ -35,6 +35,9 @@
 #include <boost/algorithm/string.hpp>
 #include <random>
 #include <chrono>
+#include <ctime>
+#include <map>
+#include <memory>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -42,6 +45,44 @@ namespace net = boost::asio;
 using tcp = net::ip::tcp;
 namespace ssl = net::ssl;
 
+typedef std::vector<net::const_buffer> HttpBufferChain;
+
+/*
+ * A request body made of buffers owned by the caller, written with gather
+ * i/o without copying them into one string first. The buffers must outlive
+ * the request.
+ */
+struct BufferChainBody{
+  typedef HttpBufferChain value_type;
+
+  static std::uint64_t size(value_type const& body){
+    return net::buffer_size(body);
+  }
+
+  class writer{
+  public:
+    typedef HttpBufferChain const_buffers_type;
+
+    template<bool isRequest, class Fields>
+    writer(http::header<isRequest, Fields> const&, value_type const& body)
+    : mBody(body){
+    }
+
+    void init(beast::error_code& ec){
+      ec = {};
+    }
+
+    boost::optional<std::pair<const_buffers_type, bool> > get(
+        beast::error_code& ec){
+      ec = {};
+      return {{mBody, false}};
+    }
+
+  private:
+    value_type const& mBody;
+  };
+};
+
 struct HttpResponse{
   bool mSuccess;
   unsigned int mCode;
@@ -117,12 +158,194 @@ private:
   }
 };
 
+#define HTTP_MAX_IDLE_CONNECTIONS_PER_ENDPOINT 8
+#define HTTP_CONNECTION_MAX_IDLE_SECONDS 60
+#define HTTP_IO_TIMEOUT_SECONDS 60
+#define HTTP_SHUTDOWN_TIMEOUT_SECONDS 5
+
+/*
+ * Thrown when the server closed the connection before the request was
+ * processed, either while the request was written or before any byte of the
+ * response arrived. Only then it is safe to send the request again.
+ */
+class HttpConnectionClosed : public beast::system_error{
+public:
+  HttpConnectionClosed(beast::error_code ec) : beast::system_error(ec){
+  }
+};
+
+/*
+ * A persistent http/1.1 connection to one elastic endpoint, either plain or
+ * over tls. Every network operation runs as an async operation on the
+ * connection's own io context with an expiry on the stream, so a hung peer
+ * fails the calling thread with a timeout instead of blocking it forever.
+ */
+class HttpClientConnection{
+public:
+  HttpClientConnection(tcp::endpoint& endpoint)
+  : mEndpoint(endpoint), mLastUsed(0){
+    mStream.reset(new beast::tcp_stream(mIOContext));
+    mStream->expires_after(std::chrono::seconds(HTTP_IO_TIMEOUT_SECONDS));
+    throwOnError(run([this](auto handler){
+      mStream->async_connect(mEndpoint, handler);
+    }));
+  }
+
+  HttpClientConnection(ssl::context& ctx, tcp::endpoint& endpoint,
+      SSL_SESSION* session)
+  : mEndpoint(endpoint), mLastUsed(0){
+    mSSLStream.reset(new beast::ssl_stream<beast::tcp_stream>(mIOContext, ctx));
+
+    // Set SNI Hostname (many hosts need this to handshake successfully)
+    if(! SSL_set_tlsext_host_name(mSSLStream->native_handle(), endpoint
+    .address().to_string().c_str()))
+    {
+      beast::error_code ec{-1, net::error::get_ssl_category()};
+      throw beast::system_error{ec};
+    }
+
+    if(session != nullptr){
+      SSL_set_session(mSSLStream->native_handle(), session);
+    }
+
+    beast::tcp_stream& lowest = beast::get_lowest_layer(*mSSLStream);
+    lowest.expires_after(std::chrono::seconds(HTTP_IO_TIMEOUT_SECONDS));
+    throwOnError(run([this, &lowest](auto handler){
+      lowest.async_connect(mEndpoint, handler);
+    }));
+    lowest.expires_after(std::chrono::seconds(HTTP_IO_TIMEOUT_SECONDS));
+    throwOnError(run([this](auto handler){
+      mSSLStream->async_handshake(ssl::stream_base::client, handler);
+    }));
+
+    LOG_DEBUG("tls connection to " << endpoint.address().to_string() <<
+    (SSL_session_reused(mSSLStream->native_handle()) ? " resumed session" :
+    " full handshake"));
+  }
+
+  template<class Body>
+  http::response<http::dynamic_body> send(http::request<Body>& req){
+    http::response<http::dynamic_body> response;
+    if(mSSLStream != nullptr){
+      exchange(*mSSLStream, req, response);
+    }else{
+      exchange(*mStream, req, response);
+    }
+    mLastUsed = std::time(nullptr);
+    return response;
+  }
+
+  SSL_SESSION* getSession(){
+    return mSSLStream != nullptr ? SSL_get1_session(mSSLStream->native_handle
+    ()) : nullptr;
+  }
+
+  bool isIdleFor(std::time_t seconds) const{
+    return std::time(nullptr) - mLastUsed > seconds;
+  }
+
+  tcp::endpoint& getEndpoint(){
+    return mEndpoint;
+  }
+
+  void close(){
+    beast::error_code ec;
+    if(mSSLStream != nullptr){
+      beast::tcp_stream& lowest = beast::get_lowest_layer(*mSSLStream);
+      lowest.expires_after(std::chrono::seconds(HTTP_SHUTDOWN_TIMEOUT_SECONDS));
+      run([this](auto handler){
+        mSSLStream->async_shutdown(handler);
+      });
+      lowest.socket().close(ec);
+    }else{
+      mStream->socket().shutdown(tcp::socket::shutdown_both, ec);
+      mStream->socket().close(ec);
+    }
+  }
+
+private:
+  net::io_context mIOContext;
+  tcp::endpoint mEndpoint;
+  // owned here so a constructor that fails to connect still closes them
+  std::unique_ptr<beast::tcp_stream> mStream;
+  std::unique_ptr<beast::ssl_stream<beast::tcp_stream> > mSSLStream;
+  beast::flat_buffer mBuffer;
+  std::time_t mLastUsed;
+
+  template<class Stream, class Body>
+  void exchange(Stream& stream, http::request<Body>& req,
+      http::response<http::dynamic_body>& response){
+    beast::tcp_stream& lowest = beast::get_lowest_layer(stream);
+    lowest.expires_after(std::chrono::seconds(HTTP_IO_TIMEOUT_SECONDS));
+    beast::error_code ec = run([&stream, &req](auto handler){
+      http::async_write(stream, req, handler);
+    });
+    if(ec){
+      // the server cannot have the whole request
+      throw HttpConnectionClosed(ec);
+    }
+
+    http::response_parser<http::dynamic_body> parser;
+    lowest.expires_after(std::chrono::seconds(HTTP_IO_TIMEOUT_SECONDS));
+    ec = run([this, &stream, &parser](auto handler){
+      http::async_read(stream, mBuffer, parser, handler);
+    });
+    if(ec && !parser.got_some() && isClosedByPeer(ec)){
+      throw HttpConnectionClosed(ec);
+    }
+    throwOnError(ec);
+    response = parser.release();
+  }
+
+  bool isClosedByPeer(beast::error_code ec){
+    return ec == http::error::end_of_stream || ec == net::error::eof
+    || ec == net::error::connection_reset || ec == ssl::error::stream_truncated;
+  }
+
+  /*
+   * Starts one async operation and runs the io context until it completes.
+   * The stream expiry cancels the operation with a timeout error.
+   */
+  template<class Initiate>
+  beast::error_code run(Initiate initiate){
+    beast::error_code result = net::error::would_block;
+    initiate([&result](beast::error_code ec, auto&&...){
+      result = ec;
+    });
+    mIOContext.restart();
+    mIOContext.run();
+    return result;
+  }
+
+  void throwOnError(beast::error_code ec){
+    if(ec){
+      throw beast::system_error{ec};
+    }
+  }
+};
+
+typedef std::map<tcp::endpoint, std::vector<HttpClientConnection*> > HttpConnectionPool;
+typedef std::map<tcp::endpoint, SSL_SESSION*> TLSSessions;
+
+/*
+ * Keeps a pool of idle keep-alive connections per endpoint. The ssl context
+ * is created once and the last tls session of every endpoint is reused for
+ * new connections to it. A pooled connection that turns out to be closed by
+ * the server before it got the request is dropped and the request is retried
+ * once on a fresh connection before failing over to another endpoint.
+ */
 class HttpClient{
 public:
-  HttpClient(const HttpClientConfig config){
+  HttpClient(const HttpClientConfig config) : mSSLContext(nullptr){
     mEndpoints = config.getElasticEndpoints();
     mConfig = config;
     mRoundRobinIndex = 0;
+    if(mConfig.mSSLEnabled){
+      // The SSL context is required, and holds certificates
+      mSSLContext = new ssl::context(ssl::context::tlsv12_client);
+      load_ca_certificates(*mSSLContext);
+      mSSLContext->set_verify_mode(ssl::verify_peer);
+    }
   }
 
   HttpResponse get(std::string target){
@@ -130,44 +353,81 @@ public:
   }
 
   HttpResponse post(std::string target, std::string data){
-    return request(http::verb::post, target, data);
+    return request<http::string_body>(http::verb::post, target, data);
+  }
+
+  HttpResponse post(std::string target, const HttpBufferChain& data){
+    return request<BufferChainBody>(http::verb::post, target, data);
   }
 
   HttpResponse delete_(std::string target){
     return request(http::verb::delete_, target);
   }
+
+  ~HttpClient(){
+    for(auto& entry : mPool){
+      for(HttpClientConnection* conn : entry.second){
+        conn->close();
+        delete conn;
+      }
+    }
+    for(auto& entry : mSessions){
+      SSL_SESSION_free(entry.second);
+    }
+    delete mSSLContext;
+  }
+
 private:
   std::vector<tcp::endpoint> mEndpoints;
   HttpClientConfig mConfig;
   unsigned long mRoundRobinIndex;
 
-  tcp::endpoint& getEndpoint(){
+  ssl::context* mSSLContext;
+  HttpConnectionPool mPool;
+  TLSSessions mSessions;
+  boost::mutex mLock;
+
+  tcp::endpoint getEndpoint(){
+    boost::mutex::scoped_lock lock(mLock);
     return mEndpoints[mRoundRobinIndex];
   }
 
-  tcp::endpoint& getAnotherEndpoint(){
-    if(mRoundRobinIndex == (mEndpoints.size() - 1)){
-      mRoundRobinIndex = 0;
-    } else{
-      mRoundRobinIndex++;
+  tcp::endpoint getAnotherEndpoint(tcp::endpoint& failed){
+    std::vector<HttpClientConnection*> stale;
+    tcp::endpoint next;
+    {
+      boost::mutex::scoped_lock lock(mLock);
+      // connections to a failed endpoint are most likely dead as well
+      HttpConnectionPool::iterator it = mPool.find(failed);
+      if(it != mPool.end()){
+        stale.swap(it->second);
+      }
+      if(mRoundRobinIndex == (mEndpoints.size() - 1)){
+        mRoundRobinIndex = 0;
+      } else{
+        mRoundRobinIndex++;
+      }
+      next = mEndpoints[mRoundRobinIndex];
     }
-    return mEndpoints[mRoundRobinIndex];
+    closeConnections(stale);
+    return next;
   }
 
   HttpResponse request(http::verb verb, std::string
   target){
-    return request(verb, target, "");
+    return request<http::string_body>(verb, target, "");
   }
 
+  template<class Body>
   HttpResponse request(http::verb verb, std::string
-  target, std::string data){
+  target, typename Body::value_type const& data){
     tcp::endpoint endpoint = getEndpoint();
     unsigned long count = 1;
     HttpResponse response;
     do{
-      response = request(endpoint, verb, target, data);
+      response = request<Body>(endpoint, verb, target, data);
       if(!response.mSuccess){
-        endpoint = getAnotherEndpoint();
+        endpoint = getAnotherEndpoint(endpoint);
         if(count++ == mEndpoints.size()){
           break;
         }
@@ -176,143 +436,149 @@ private:
     return response;
   }
 
+  template<class Body>
   HttpResponse request(tcp::endpoint& endpoint, http::verb verb, std::string
-  target, std::string data){
+  target, typename Body::value_type const& data){
     LOG_INFO(verb << " "<< endpoint.address().to_string() << target);
-    if(mConfig.mSSLEnabled){
-      return request_with_ssl(endpoint, verb, target, data);
-    }else{
-      return request_no_ssl(endpoint, verb, target, data);
-    }
-  }
 
-  HttpResponse request_no_ssl(tcp::endpoint& endpoint, http::verb verb,
-      std::string target, std::string data){
+    http::request<Body> req{verb, target, 11};
+    req.set(http::field::host, endpoint.address().to_string());
+    req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    req.set(http::field::content_type, "application/json");
+    req.keep_alive(true);
 
-    std::string responseBody;
-    bool succeed = true;
-    unsigned int code = 0;
-
-    try
-    {
-      net::io_context ioc;
-      beast::tcp_stream stream(ioc);
-
-      stream.connect(endpoint);
-
-      http::request<http::string_body> req{verb, target, 11};
-      req.set(http::field::host, endpoint.address().to_string());
-      req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-      req.set(http::field::content_type, "application/json");
-
-      if(mConfig.isValidUserAndPass()) {
-        req.set(http::field::authorization, mConfig.getAuthorization());
-      }
-
-      if(data.length() != 0){
-        req.body() = data;
-        req.set(http::field::content_length, data.length());
-        req.prepare_payload();
-      }
-
-      http::write(stream, req);
-
-      beast::flat_buffer buffer;
-
-      http::response<http::dynamic_body> response;
+    if(mConfig.isValidUserAndPass()) {
+      req.set(http::field::authorization, mConfig.getAuthorization());
+    }
 
-      http::read(stream, buffer, response);
+    if(Body::size(data) != 0){
+      req.body() = data;
+      req.prepare_payload();
+    }
 
-      responseBody = beast::buffers_to_string(response.body().data());
-      code = response.result_int();
+    bool pooled = true;
+    while(true){
+      HttpClientConnection* conn = nullptr;
+      try
+      {
+        conn = acquire(endpoint, pooled);
+        http::response<http::dynamic_body> response = conn->send(req);
 
-      beast::error_code ec;
-      stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+        std::string responseBody = beast::buffers_to_string(response.body().data());
+        unsigned int code = response.result_int();
 
-      if(ec && ec != beast::errc::not_connected){
-        LOG_ERROR("Error in http connection with error code "<< ec);
-        succeed = false;
+        if(response.keep_alive()){
+          release(conn);
+        }else{
+          conn->close();
+          delete conn;
+        }
+        return {true, code, responseBody};
+      }catch(HttpConnectionClosed const& e)
+      {
+        delete conn;
+        if(pooled){
+          // the server closed the idle connection before reading the
+          // request, retry on a new one
+          LOG_DEBUG("Stale http connection to " << endpoint.address()
+          .to_string() << " : " << e.what());
+          pooled = false;
+          continue;
+        }
+        LOG_ERROR("Error in http connection : " << e.what());
+        return {false, 0, ""};
+      }catch(std::exception const& e)
+      {
+        // a timeout or a failure after the request reached the server, the
+        // request may have been applied so it is not sent again here
+        delete conn;
+        LOG_ERROR("Error in http connection : " << e.what());
+        return {false, 0, ""};
       }
-    }catch(std::exception const& e)
-    {
-      LOG_ERROR("Error in http connection : " << e.what());
-      succeed = false;
     }
-
-    return {succeed, code, responseBody};
   }
 
-  HttpResponse request_with_ssl(tcp::endpoint& endpoint, http::verb verb, std::string
-  target, std::string data){
-
-    std::string responseBody;
-    bool succeed = true;
-    unsigned int code = 0;
-
-    try
+  HttpClientConnection* acquire(tcp::endpoint& endpoint, bool& pooled){
+    SSL_SESSION* session = nullptr;
+    std::vector<HttpClientConnection*> expired;
     {
-      net::io_context ioc;
-
-      // The SSL context is required, and holds certificates
-      ssl::context ctx(ssl::context::tlsv12_client);
-      load_ca_certificates(ctx);
-      ctx.set_verify_mode(ssl::verify_peer);
-
-      beast::ssl_stream<beast::tcp_stream> stream(ioc, ctx);
-
-      // Set SNI Hostname (many hosts need this to handshake successfully)
-      if(! SSL_set_tlsext_host_name(stream.native_handle(), endpoint.address
-      ().to_string().c_str()))
-      {
-        beast::error_code ec{-1, net::error::get_ssl_category()};
-        throw beast::system_error{ec};
+      boost::mutex::scoped_lock lock(mLock);
+      std::vector<HttpClientConnection*>& idle = mPool[endpoint];
+      HttpClientConnection* live = nullptr;
+      while(pooled && !idle.empty()){
+        HttpClientConnection* conn = idle.back();
+        idle.pop_back();
+        if(!conn->isIdleFor(HTTP_CONNECTION_MAX_IDLE_SECONDS)){
+          live = conn;
+          break;
+        }
+        expired.push_back(conn);
       }
-
-      beast::get_lowest_layer(stream).connect(endpoint);
-      stream.handshake(ssl::stream_base::client);
-
-      http::request<http::string_body> req{verb, target, 11};
-      req.set(http::field::host, endpoint.address().to_string());
-      req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-      req.set(http::field::content_type, "application/json");
-
-      if(mConfig.isValidUserAndPass()) {
-        req.set(http::field::authorization, mConfig.getAuthorization());
+      if(live != nullptr){
+        lock.unlock();
+        closeConnections(expired);
+        return live;
       }
-
-      if(data.length() != 0){
-        req.body() = data;
-        req.set(http::field::content_length, data.length());
-        req.prepare_payload();
+      pooled = false;
+      if(mSSLContext != nullptr){
+        TLSSessions::iterator it = mSessions.find(endpoint);
+        if(it != mSessions.end()){
+          session = it->second;
+          SSL_SESSION_up_ref(session);
+        }
       }
+    }
+    closeConnections(expired);
 
-      http::write(stream, req);
-
-      beast::flat_buffer buffer;
-
-      http::response<http::dynamic_body> response;
-
-      http::read(stream, buffer, response);
-
-      responseBody = beast::buffers_to_string(response.body().data());
-      code = response.result_int();
-
-      beast::error_code ec;
-      stream.shutdown(ec);
+    if(mSSLContext == nullptr){
+      return new HttpClientConnection(endpoint);
+    }
 
-      if(ec && ec != beast::errc::not_connected){
-        LOG_ERROR("Error in http connection with error code "<< ec);
-        succeed = false;
+    HttpClientConnection* conn;
+    try{
+      conn = new HttpClientConnection(*mSSLContext, endpoint, session);
+    }catch(...){
+      if(session != nullptr) SSL_SESSION_free(session);
+      throw;
+    }
+    if(session != nullptr) SSL_SESSION_free(session);
+
+    SSL_SESSION* newSession = conn->getSession();
+    if(newSession != nullptr){
+      boost::mutex::scoped_lock lock(mLock);
+      SSL_SESSION*& stored = mSessions[endpoint];
+      if(stored != nullptr){
+        SSL_SESSION_free(stored);
       }
-    }catch(std::exception const& e)
-    {
-      LOG_ERROR("Error in http connection : " << e.what());
-      succeed = false;
+      stored = newSession;
     }
+    return conn;
+  }
 
-    return {succeed, code, responseBody};
+  void release(HttpClientConnection* conn){
+    {
+      boost::mutex::scoped_lock lock(mLock);
+      std::vector<HttpClientConnection*>& idle = mPool[conn->getEndpoint()];
+      if(idle.size() < HTTP_MAX_IDLE_CONNECTIONS_PER_ENDPOINT){
+        idle.push_back(conn);
+        return;
+      }
+    }
+    conn->close();
+    delete conn;
   }
 
+  /*
+   * Closing may wait on the peer for the tls shutdown, so it is always done
+   * after the connections were taken out of the pool and mLock is released.
+   */
+  static void closeConnections(std::vector<HttpClientConnection*>& conns){
+    for(HttpClientConnection* conn : conns){
+      conn->close();
+      delete conn;
+    }
+    conns.clear();
+  }
 
   void load_ca_certificates(ssl::context& ctx){
     std::ifstream ifs(mConfig.mCAPath.c_str());
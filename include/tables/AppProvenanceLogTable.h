@@ -20,6 +20,9 @@
 #include "ConcurrentPriorityQueue.h"
 #include "ConcurrentQueue.h"
 
+typedef TableKey<KeyColumn<0, std::string>, KeyColumn<1, std::string>,
+    KeyColumn<2, Int64> > AppProvenanceKey;
+
 struct AppProvenancePK {
   std::string mId;
   std::string mState;
@@ -31,6 +34,10 @@ struct AppProvenancePK {
     mTimestamp = timestamp;
   }
 
+  AppProvenanceKey getKey() const {
+    return AppProvenanceKey(mId, mState, mTimestamp);
+  }
+
   std::string to_string() const {
     std::stringstream  out;
     out << mId << "-" << mState << "-" << mTimestamp;
@@ -49,11 +56,17 @@ struct AppProvenanceRow {
   Int64 mFinishTime;
 
   ptime mEventCreationTime;
+  Uint64 mEpoch;
 
   AppProvenancePK getPK() {
     return AppProvenancePK(mId, mState, mTimestamp);
   }
 
+  Uint64 getSize() const {
+    return sizeof(AppProvenanceRow) + mId.size() + mState.size()
+        + mName.size() + mUser.size();
+  }
+
   std::string to_string() {
     std::stringstream  stream;
     stream << "-------------------------" << std::endl;
@@ -95,27 +108,35 @@ struct AppProvenanceRowComparator {
     if (res == 0) {
       res = r1.mState.compare(r2.mState);
       if(res == 0) {
-        return r1.mTimestamp > r2.mTimestamp;
+        return r1.mTimestamp < r2.mTimestamp;
       } else {
-        return res > 0;
+        return res < 0;
       }
     } else {
-      return res > 0;
+      return res < 0;
     }
   }
 };
 
 typedef ConcurrentQueue<AppProvenanceRow> AppCPRq;
-typedef boost::heap::priority_queue<AppProvenanceRow, boost::heap::compare<AppProvenanceRowComparator> > AppPRpq;
 typedef std::vector <boost::optional<AppProvenancePK> > AppPKeys;
 typedef std::vector <AppProvenanceRow> AppPq;
 
+template<>
+struct WatchRowKey<AppProvenanceRow> {
+  typedef AppProvenanceKey Type;
+
+  static Type get(DBWatchTable<AppProvenanceRow>*, AppProvenanceRow row) {
+    return row.getPK().getKey();
+  }
+};
+
 class AppProvenanceLogTable : public DBWatchTable<AppProvenanceRow> {
 public:
   struct AppProvLogHandler : public LogHandler{
     AppProvenancePK mPK;
 
-    AppProvLogHandler(AppProvenancePK pk) : mPK(pk) {}
+    AppProvLogHandler(AppProvenancePK pk, Uint64 epoch) : LogHandler(epoch), mPK(pk) {}
     void removeLog(Ndb* connection) const override {
       AppProvenanceLogTable().removeLog(connection, mPK);
     }
@@ -142,9 +163,10 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_INSERT);
   }
 
-  AppProvenanceRow getRow(NdbRecAttr* value[]) {
+  AppProvenanceRow getRow(const RowValues& value) {
     AppProvenanceRow row;
     row.mEventCreationTime = Utils::getCurrentTime();
+    row.mEpoch = 0;
     row.mId = get_string(value[0]);
     row.mState = get_string(value[1]);
     row.mTimestamp = value[2]->int64_value();
@@ -157,22 +179,37 @@ public:
     return row;
   }
 
-  void removeLogs(Ndb* connection, std::vector<const LogHandler*>&logrh) {
-    try{
-      removeLogsOneTransaction(connection, logrh);
-    }catch(NdbTupleDidNotExist& e){
-      removeLogsMultiTransactions(connection, logrh);
+  /*
+   * removes the app provenance logs in one transaction, returns the number
+   * of log rows that were already deleted.
+   */
+  int removeLogs(Ndb* connection, std::vector<const LogHandler*>&logrh) {
+    bool started = false;
+    for (auto log : logrh) {
+      if (log == nullptr) {
+        continue;
+      }
+      if (log->getType() != LogType::PROVAPPLOG) {
+        continue;
+      }
+
+      const AppProvLogHandler *applog = static_cast<const AppProvLogHandler *>(log);
+      if (!started) {
+        start(connection);
+        started = true;
+      }
+
+      AppProvenancePK pk = applog->mPK;
+      doDelete(pk.getKey());
+      LOG_DEBUG("Delete log row: " + pk.to_string());
     }
+    return started ? endIgnoreMissing() : 0;
   }
 
   void removeLog(Ndb* connection, AppProvenancePK pk) {
     try{
       start(connection);
-      AnyMap a;
-      a[0] = pk.mId;
-      a[1] = pk.mState;
-      a[2] = pk.mTimestamp;
-      doDelete(a);
+      doDelete(pk.getKey());
       LOG_DEBUG("Delete log row: " + pk.to_string());
       end();
     } catch(NdbTupleDidNotExist& e){
@@ -185,45 +222,33 @@ public:
   }
 
   LogHandler* getLogRemovalHandler(AppProvenanceRow row) override {
-    return new AppProvLogHandler(row.getPK());
+    return new AppProvLogHandler(row.getPK(), row.mEpoch);
   }
 
-private:
-  void removeLogsOneTransaction(Ndb* connection, std::vector<const LogHandler*>&logrh) {
-    start(connection);
-    for (auto log : logrh) {
-      if (log == nullptr) {
-        continue;
-      }
-      if (log->getType() != LogType::PROVAPPLOG) {
-        continue;
-      }
-
-      const AppProvLogHandler *applog = static_cast<const AppProvLogHandler *>(log);
-
-      AppProvenancePK pk = applog->mPK;
-      AnyMap a;
-      a[0] = pk.mId;
-      a[1] = pk.mState;
-      a[2] = pk.mTimestamp;
-      doDelete(a);
-      LOG_DEBUG("Delete log row: " + pk.to_string());
-    }
-    end();
+  void writeRow(EventRecordWriter& writer, AppProvenanceRow row) override {
+    writer.putString(row.mId);
+    writer.putString(row.mState);
+    writer.putInt(row.mTimestamp);
+    writer.putString(row.mName);
+    writer.putString(row.mUser);
+    writer.putInt(row.mSubmitTime);
+    writer.putInt(row.mStartTime);
+    writer.putInt(row.mFinishTime);
   }
 
-  void removeLogsMultiTransactions(Ndb* connection, std::vector<const LogHandler*>&logrh) {
-    for (auto log : logrh) {
-      if (log == nullptr) {
-        continue;
-      }
-      if (log->getType() != LogType::PROVAPPLOG) {
-        continue;
-      }
-
-      const AppProvLogHandler *applog = static_cast<const AppProvLogHandler *>(log);
-      removeLog(connection, applog->mPK);
-    }
+  AppProvenanceRow readRow(EventRecordReader& reader) override {
+    AppProvenanceRow row;
+    row.mEventCreationTime = Utils::getCurrentTime();
+    row.mEpoch = 0;
+    row.mId = reader.getString();
+    row.mState = reader.getString();
+    row.mTimestamp = reader.getInt();
+    row.mName = reader.getString();
+    row.mUser = reader.getString();
+    row.mSubmitTime = reader.getInt();
+    row.mStartTime = reader.getInt();
+    row.mFinishTime = reader.getInt();
+    return row;
   }
 };
 
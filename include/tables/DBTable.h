@@ -23,14 +23,38 @@
 #include <boost/any.hpp>
 #include "boost/optional.hpp"
 #include "DBTableBase.h"
+#include "TableKey.h"
+
+// NDB numbers the ranges of a multi-range scan from 0 to MaxRangeNo
+#define MAX_RANGES_PER_SCAN static_cast<size_t>(NdbIndexScanOperation::MaxRangeNo)
 
-typedef NdbRecAttr** Row;
-typedef std::vector<Row> Rows;
-typedef boost::unordered_map<int, Row> UIRowMap;
 typedef boost::any Any;
 typedef boost::unordered_map<int, Any> AnyMap;
 typedef std::vector<AnyMap> AnyVec;
 
+/*
+ * A primary key batch read prepared on the NDB asynchronous api, it is
+ * completed once DBTableBase::waitForAsyncTransactions polled it. The rows
+ * are read into mRowBuffer with the table NdbRecord, or into mRows for
+ * tables that can't be read with one.
+ */
+struct AsyncRead {
+  NdbTransaction* mTransaction;
+  std::vector<char> mRowBuffer;
+  std::vector<RowValues> mRows;
+  int mResult;
+  bool mCompleted;
+
+  AsyncRead() : mTransaction(nullptr), mResult(0), mCompleted(false) {
+  }
+
+  static void callback(int result, NdbTransaction* transaction, void* arg) {
+    AsyncRead* read = static_cast<AsyncRead*>(arg);
+    read->mResult = result;
+    read->mCompleted = true;
+  }
+};
+
 template<typename TableRow>
 class DBTable : public DBTableBase {
 public:
@@ -42,46 +66,129 @@ public:
   TableRow currRow();
   Uint64 currEpoch();
 
-  virtual TableRow getRow(NdbRecAttr* values[]) = 0;
+  virtual TableRow getRow(const RowValues& values) = 0;
 
   virtual ~DBTable();
 
 private:
   bool mReadEpoch;
-  const NdbDictionary::Dictionary* mDatabase;
   const NdbDictionary::Table* mTable;
   const NdbDictionary::Index* mIndex;
 
   NdbTransaction* mCurrentTransaction;
   NdbOperation* mCurrentOperation;
-  NdbRecAttr** mCurrentRow;
+  RowValues mCurrentRow;
 
   const NdbDictionary::Table* mCompanionTable;
 
+  /*
+   * the columns are resolved once per version of the dictionary table, and
+   * primary key reads go through an NdbRecord of the columns laid out back
+   * to back followed by their null bits.
+   */
+  const NdbDictionary::Table* mColumnsTable;
+  int mColumnsVersion;
+  std::vector<const NdbDictionary::Column*> mTableColumns;
+  bool mHasBlobs;
+  NdbDictionary::Dictionary* mRecordDatabase;
+  NdbRecord* mRecord;
+  std::vector<Uint32> mRecordOffsets;
+  Uint32 mRecordNullOffset;
+  Uint32 mRecordLength;
+  RowValues mRecordRow;
+
+  /*
+   * binds the key values either with equal() on the resolved column ids of
+   * an operation, or at the column offsets of an NdbRecord row.
+   */
+  struct OperationKeyBinder {
+    DBTable* mTable;
+    NdbOperation* mOperation;
+
+    template<typename T>
+    void bind(unsigned int col, T value) {
+      mOperation->equal(mTable->getAttrId(col), value);
+    }
+
+    void bind(unsigned int col, const std::string& value) {
+      const NdbDictionary::Column* column = mTable->mTableColumns[col];
+      mOperation->equal(mTable->getAttrId(col), mTable->get_ndb_varchar(value,
+          column->getArrayType()).c_str());
+    }
+  };
+
+  struct RecordKeyBinder {
+    DBTable* mTable;
+    char* mRow;
+
+    template<typename T>
+    void bind(unsigned int col, T value) {
+      memcpy(mRow + mTable->mRecordOffsets[col], &value, sizeof(value));
+    }
+
+    void bind(unsigned int col, const std::string& value) {
+      const NdbDictionary::Column* column = mTable->mTableColumns[col];
+      std::string key = mTable->get_ndb_varchar(value, column->getArrayType());
+      memcpy(mRow + mTable->mRecordOffsets[col], key.data(), std::min(key.size(),
+          static_cast<size_t>(column->getSizeInBytes())));
+    }
+  };
+
   void close();
+  void resolveColumns();
+  Uint32 getAttrId(unsigned int col);
+  bool useRecord(Ndb* connection);
+  template<typename Key>
+  void readRecord(NdbTransaction* transaction, Key& pk, char* row);
+  const RowValues& bindRecord(const char* row);
+  template<typename Key>
+  TableRow readRow(Ndb* connection, Key& pk);
+  template<typename Keys>
+  std::vector<TableRow> readRows(Ndb* connection, Keys& pks);
+  template<typename Keys>
+  bool prepareRows(Ndb* connection, Keys& pks, AsyncRead* read);
+  void bindKey(RecordKeyBinder& binder, AnyMap& any);
+  template<typename... Columns>
+  void bindKey(RecordKeyBinder& binder, const TableKey<Columns...>& key);
+  void applyKey(NdbOperation* operation, AnyMap& any);
+  template<typename... Columns>
+  void applyKey(NdbOperation* operation, const TableKey<Columns...>& key);
   void applyConditionOnOperation(NdbOperation* operation, AnyMap& any);
+  void applyBoundOnOperation(NdbIndexScanOperation* operation, AnyMap& any);
   void applyConditionOnOperationOnCompanion(NdbOperation* operation, AnyMap& any);
   
 protected:
   DBTableBase* mCompanionTableBase;
 
-  NdbRecAttr** getColumnValues(NdbOperation* op);
+  void getColumnValues(NdbOperation* op, RowValues& values);
   void start(Ndb* connection);
   void start(Ndb* connection, boost::optional<Int64> partitionId);
   void end();
+  int endIgnoreMissing();
 
   TableRow doRead(Ndb* connection, Any any);
   TableRow doRead(Ndb* connection, AnyMap& any);
   std::vector<TableRow> doRead(Ndb* connection, AnyVec& pks);
+  bool prepareRead(Ndb* connection, AnyVec& pks, AsyncRead* read);
+  std::vector<TableRow> completeRead(AsyncRead* read);
+  template<typename... Columns>
+  TableRow doRead(Ndb* connection, const TableKey<Columns...>& pk);
+  template<typename... Columns>
+  std::vector<TableRow> doRead(Ndb* connection, const std::vector<TableKey<Columns...> >& pks);
+  template<typename... Columns>
+  bool prepareRead(Ndb* connection, const std::vector<TableKey<Columns...> >& pks, AsyncRead* read);
   boost::unordered_map<int, TableRow> doRead(Ndb* connection, UISet& ids);
   boost::unordered_map<Int64, TableRow> doRead(Ndb* connection, ULSet& ids);
   
   std::vector<TableRow> doRead(Ndb* connection, std::string index, AnyMap& anys);
   std::vector<TableRow> doRead(Ndb* connection, std::string index, AnyMap& anys, boost::optional<Int64> partitionId);
+  std::vector<std::vector<TableRow> > doReadRanges(Ndb* connection, std::string index, AnyVec& ranges);
   bool rowsExists(Ndb* connection, std::string index, AnyMap& anys);
 
   void doDelete(Any any);
   void doDelete(AnyMap& any);
+  template<typename... Columns>
+  void doDelete(const TableKey<Columns...>& pk);
   void doDeleteOnCompanion(AnyMap& any);
   int deleteByIndex(Ndb* connection, std::string index, AnyMap& anys);
   int deleteByIndex(Ndb* connection, std::string index, AnyMap& anys, boost::optional<Int64> partitionId);
@@ -93,20 +200,22 @@ protected:
   int getColumnIdInDB(const char* colName);
   
   virtual void applyConditionOnGetAll(NdbScanFilter& filter);
-  void convert(UISet& ids, AnyVec& resultAny, IVec& resultVec);
-  void convert(ULSet& ids, AnyVec& resultAny, LVec& resultVec);
   Int64 getRandomPartitionId();
 };
 
 template<typename TableRow>
 DBTable<TableRow>::DBTable(const std::string table)
-: DBTableBase(table), mReadEpoch(false), mCompanionTableBase(nullptr) {
+: DBTableBase(table), mReadEpoch(false), mTable(nullptr), mColumnsTable(nullptr), mColumnsVersion(0), mHasBlobs(false),
+mRecordDatabase(nullptr), mRecord(nullptr),
+mRecordNullOffset(0), mRecordLength(0), mCompanionTableBase(nullptr) {
 
 }
 
 template<typename TableRow>
 DBTable<TableRow>::DBTable(const std::string table, DBTableBase* companionTableBase)
-    : DBTableBase(table), mReadEpoch(false), mCompanionTableBase(companionTableBase) {
+    : DBTableBase(table), mReadEpoch(false), mTable(nullptr), mColumnsTable(nullptr), mColumnsVersion(0), mHasBlobs(false),
+    mRecordDatabase(nullptr), mRecord(nullptr),
+    mRecordNullOffset(0), mRecordLength(0), mCompanionTableBase(companionTableBase) {
 }
 
 template<typename TableRow>
@@ -114,18 +223,147 @@ void DBTable<TableRow>::setReadEpoch(bool readEpoch) {
   mReadEpoch = readEpoch;
   LOG_DEBUG(getName() << " -- ReadEpoch : " << mReadEpoch);
 }
+
 template<typename TableRow>
-NdbRecAttr** DBTable<TableRow>::getColumnValues(NdbOperation* op) {
-  int numCols = mReadEpoch ? getNoColumns() + 1 : getNoColumns();
-  NdbRecAttr** values = new NdbRecAttr*[numCols];
+void DBTable<TableRow>::getColumnValues(NdbOperation* op, RowValues& values) {
+  resolveColumns();
+  values.resize(mReadEpoch ? getNoColumns() + 1 : getNoColumns());
   for (strvec_size_type i = 0; i < getNoColumns(); i++) {
-    values[i] = getNdbOperationValue(op, getColumn(i).c_str());
+    values.set(i, getNdbOperationValue(op, mTableColumns[i]));
   }
   if (mReadEpoch) {
-    values[getNoColumns()] = getNdbOperationValue(op,
-        NdbDictionary::Column::ROW_GCI64);
+    values.set(getNoColumns(), getNdbOperationValue(op,
+        NdbDictionary::Column::ROW_GCI64));
+  }
+}
+
+template<typename TableRow>
+void DBTable<TableRow>::resolveColumns() {
+  if (mColumnsTable == mTable && mColumnsVersion == mTable->getObjectVersion()) {
+    return;
+  }
+  if (mRecord != nullptr) {
+    mRecordDatabase->releaseRecord(mRecord);
+    mRecord = nullptr;
+  }
+  mTableColumns.clear();
+  mHasBlobs = false;
+  for (strvec_size_type i = 0; i < getNoColumns(); i++) {
+    const NdbDictionary::Column* column = mTable->getColumn(getColumn(i).c_str());
+    if (!column) {
+      LOG_FATAL(getName() << " -- column " << getColumn(i) << " doesn't exist");
+    }
+    if (column->getType() == NdbDictionary::Column::Blob
+        || column->getType() == NdbDictionary::Column::Text) {
+      mHasBlobs = true;
+    }
+    mTableColumns.push_back(column);
+  }
+  mColumnsTable = mTable;
+  mColumnsVersion = mTable->getObjectVersion();
+}
+
+template<typename TableRow>
+bool DBTable<TableRow>::useRecord(Ndb* connection) {
+  resolveColumns();
+  if (mHasBlobs || mReadEpoch) {
+    return false;
+  }
+  if (mRecord != nullptr) {
+    return true;
+  }
+
+  strvec_size_type numCols = getNoColumns();
+  std::vector<NdbDictionary::RecordSpecification> specs(numCols);
+  mRecordOffsets.resize(numCols);
+  Uint32 offset = 0;
+  for (strvec_size_type i = 0; i < numCols; i++) {
+    specs[i].column = mTableColumns[i];
+    specs[i].offset = offset;
+    specs[i].column_flags = 0;
+    mRecordOffsets[i] = offset;
+    offset += mTableColumns[i]->getSizeInBytes();
+  }
+  mRecordNullOffset = offset;
+  for (strvec_size_type i = 0; i < numCols; i++) {
+    specs[i].nullbit_byte_offset = mRecordNullOffset + i / 8;
+    specs[i].nullbit_bit_in_byte = i % 8;
+  }
+  mRecordLength = mRecordNullOffset + (numCols + 7) / 8;
+
+  mRecordDatabase = connection->getDictionary();
+  mRecord = mRecordDatabase->createRecord(mTable, &specs[0], numCols,
+      sizeof(specs[0]));
+  if (!mRecord) LOG_NDB_API_FATAL(getName(), mRecordDatabase->getNdbError());
+  mRecordRow.resize(numCols);
+  LOG_DEBUG(getName() << " -- created record of " << mRecordLength << " bytes");
+  return true;
+}
+
+template<typename TableRow>
+Uint32 DBTable<TableRow>::getAttrId(unsigned int col) {
+  return static_cast<Uint32>(mTableColumns[col]->getAttrId());
+}
+
+template<typename TableRow>
+template<typename Key>
+void DBTable<TableRow>::readRecord(NdbTransaction* transaction, Key& pk, char* row) {
+  // the key is taken from the result row, it is sent before the row is read
+  memset(row, 0, mRecordLength);
+  RecordKeyBinder binder = {this, row};
+  bindKey(binder, pk);
+  const NdbOperation* op = transaction->readTuple(mRecord, row, mRecord, row,
+      NdbOperation::LM_CommittedRead);
+  if (!op) LOG_NDB_API_FATAL(getName(), transaction->getNdbError());
+}
+
+template<typename TableRow>
+void DBTable<TableRow>::bindKey(RecordKeyBinder& binder, AnyMap& any) {
+  for (AnyMap::iterator it = any.begin(); it != any.end(); ++it) {
+    unsigned int col = it->first;
+    Any& a = it->second;
+    if (a.type() == typeid (int)) {
+      binder.bind(col, boost::any_cast<int>(a));
+    } else if (a.type() == typeid (Int64)) {
+      binder.bind(col, boost::any_cast<Int64>(a));
+    } else if (a.type() == typeid (Int8)) {
+      binder.bind(col, boost::any_cast<Int8>(a));
+    } else if (a.type() == typeid (Int16)) {
+      binder.bind(col, boost::any_cast<Int16>(a));
+    } else if (a.type() == typeid (std::string)) {
+      binder.bind(col, boost::any_cast<std::string>(a));
+    } else {
+      LOG_ERROR(getName() << " -- apply where unknown type" << a.type().name());
+    }
   }
-  return values;
+}
+
+template<typename TableRow>
+template<typename... Columns>
+void DBTable<TableRow>::bindKey(RecordKeyBinder& binder, const TableKey<Columns...>& key) {
+  key.bind(binder);
+}
+
+template<typename TableRow>
+void DBTable<TableRow>::applyKey(NdbOperation* operation, AnyMap& any) {
+  applyConditionOnOperation(operation, any);
+}
+
+template<typename TableRow>
+template<typename... Columns>
+void DBTable<TableRow>::applyKey(NdbOperation* operation, const TableKey<Columns...>& key) {
+  resolveColumns();
+  OperationKeyBinder binder = {this, operation};
+  key.bind(binder);
+}
+
+template<typename TableRow>
+const RowValues& DBTable<TableRow>::bindRecord(const char* row) {
+  for (strvec_size_type i = 0; i < getNoColumns(); i++) {
+    bool null = (row[mRecordNullOffset + i / 8] >> (i % 8)) & 1;
+    mRecordRow.set(i, mTableColumns[i], row + mRecordOffsets[i], null);
+  }
+  return mRecordRow;
 }
 
 template<typename TableRow>
@@ -137,7 +375,7 @@ void DBTable<TableRow>::getAll(Ndb* connection) {
   mCurrentOperation = operation;
   NdbScanFilter filter(mCurrentOperation);
   applyConditionOnGetAll(filter);
-  mCurrentRow = getColumnValues(mCurrentOperation);
+  getColumnValues(mCurrentOperation, mCurrentRow);
   executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
 }
 
@@ -145,11 +383,11 @@ template<typename TableRow>
 void DBTable<TableRow>::getAll(Ndb* connection, std::string index) {
   start(connection);
   LOG_DEBUG(getName() << " -- GetAll with index : " << index);
-  mIndex = getIndex(mDatabase, index);
+  mIndex = getIndex(connection, index);
   NdbIndexScanOperation* operation = getNdbIndexScanOperation(mCurrentTransaction, mIndex);
   operation->readTuples(NdbOperation::LM_CommittedRead, NdbScanOperation::SF_OrderBy);
   mCurrentOperation = operation;
-  mCurrentRow = getColumnValues(mCurrentOperation);
+  getColumnValues(mCurrentOperation, mCurrentRow);
   executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
 }
 
@@ -160,10 +398,9 @@ void DBTable<TableRow>::start(Ndb* connection) {
 
 template<typename TableRow>
 void DBTable<TableRow>::start(Ndb* connection, boost::optional<Int64> partitionId) {
-  mDatabase = getDatabase(connection);
-  mTable = getTable(mDatabase);
+  mTable = getTable(connection);
   if(mCompanionTableBase != nullptr){
-    mCompanionTable = getTable(mDatabase, mCompanionTableBase->getName());
+    mCompanionTable = getTable(connection, mCompanionTableBase->getName());
   }
   if(partitionId){
     Int64 partId = partitionId.get();
@@ -193,6 +430,33 @@ void DBTable<TableRow>::end() {
   }
 }
 
+/*
+ * commits the transaction without aborting on the operations on rows that
+ * do not exist, returns the number of those operations.
+ */
+template<typename TableRow>
+int DBTable<TableRow>::endIgnoreMissing() {
+  int res = mCurrentTransaction->execute(NdbTransaction::Commit,
+      NdbOperation::AO_IgnoreError);
+  int missing = 0;
+  const NdbOperation* op = NULL;
+  while ((op = mCurrentTransaction->getNextCompletedOperation(op)) != NULL) {
+    const NdbError& error = op->getNdbError();
+    if (error.code == 626) {
+      missing++;
+    } else if (error.code != 0) {
+      LOG_NDB_API_FATAL(getName(), error);
+    }
+  }
+  // a missing row also fails the transaction with 626, any other error is a
+  // failure of the whole transaction and nothing was removed
+  if (res == -1 && mCurrentTransaction->getNdbError().code != 626) {
+    checkTransactionError(mCurrentTransaction);
+  }
+  close();
+  return missing;
+}
+
 template<typename TableRow>
 void DBTable<TableRow>::close() {
   mCurrentTransaction->close();
@@ -244,12 +508,32 @@ TableRow DBTable<TableRow>::doRead(Ndb* connection, Any any){
 
 template<typename TableRow>
 TableRow DBTable<TableRow>::doRead(Ndb* connection, AnyMap& any) {
+  return readRow(connection, any);
+}
+
+template<typename TableRow>
+template<typename... Columns>
+TableRow DBTable<TableRow>::doRead(Ndb* connection, const TableKey<Columns...>& pk) {
+  return readRow(connection, pk);
+}
+
+template<typename TableRow>
+template<typename Key>
+TableRow DBTable<TableRow>::readRow(Ndb* connection, Key& pk) {
   start(connection);
   LOG_DEBUG(getName() << " -- doRead ");
+  if (useRecord(connection)) {
+    std::vector<char> row(mRecordLength);
+    readRecord(mCurrentTransaction, pk, row.data());
+    executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
+    TableRow result = getRow(bindRecord(row.data()));
+    close();
+    return result;
+  }
   mCurrentOperation = getNdbOperation(mCurrentTransaction, mTable);
   mCurrentOperation->readTuple(NdbOperation::LM_CommittedRead);
-  applyConditionOnOperation(mCurrentOperation, any);
-  mCurrentRow = getColumnValues(mCurrentOperation);
+  applyKey(mCurrentOperation, pk);
+  getColumnValues(mCurrentOperation, mCurrentRow);
   executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
   TableRow row = getRow(mCurrentRow);
   close();
@@ -265,12 +549,12 @@ template<typename TableRow>
 std::vector<TableRow> DBTable<TableRow>::doRead(Ndb* connection, std::string index, AnyMap& any, boost::optional<Int64> partitionId){
   start(connection, partitionId);
   LOG_DEBUG(getName() << " -- doRead with index : " << index);
-  mIndex = getIndex(mDatabase, index);
+  mIndex = getIndex(connection, index);
   NdbIndexScanOperation* operation = getNdbIndexScanOperation(mCurrentTransaction, mIndex);
   operation->readTuples(NdbOperation::LM_CommittedRead);
   mCurrentOperation = operation;
   applyConditionOnOperation(operation, any);
-  mCurrentRow = getColumnValues(mCurrentOperation);
+  getColumnValues(mCurrentOperation, mCurrentRow);
   executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
   std::vector<TableRow> results;
   while (operation->nextResult(true) == 0){
@@ -281,6 +565,41 @@ std::vector<TableRow> DBTable<TableRow>::doRead(Ndb* connection, std::string ind
   return results;
 }
 
+/*
+ * Reads all the equality ranges with multi-range index scans of at most
+ * MAX_RANGES_PER_SCAN ranges each, the rows of ranges[i] are returned in
+ * results[i].
+ */
+template<typename TableRow>
+std::vector<std::vector<TableRow> > DBTable<TableRow>::doReadRanges(Ndb* connection,
+    std::string index, AnyVec& ranges){
+  std::vector<std::vector<TableRow> > results(ranges.size());
+  for(size_t first = 0; first < ranges.size(); first += MAX_RANGES_PER_SCAN){
+    size_t last = std::min(ranges.size(), first + MAX_RANGES_PER_SCAN);
+    start(connection);
+    LOG_DEBUG(getName() << " -- doRead with index : " << index << " for "
+        << (last - first) << " ranges");
+    mIndex = getIndex(connection, index);
+    NdbIndexScanOperation* operation = getNdbIndexScanOperation(mCurrentTransaction, mIndex);
+    operation->readTuples(NdbOperation::LM_CommittedRead,
+        NdbScanOperation::SF_MultiRange | NdbScanOperation::SF_ReadRangeNo);
+    mCurrentOperation = operation;
+    for(size_t i = first; i < last; i++){
+      applyBoundOnOperation(operation, ranges[i]);
+      if(operation->end_of_bound(i - first) == -1){
+        LOG_NDB_API_FATAL(getName(), operation->getNdbError());
+      }
+    }
+    getColumnValues(mCurrentOperation, mCurrentRow);
+    executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
+    while (operation->nextResult(true) == 0){
+      results[first + operation->get_range_no()].push_back(getRow(mCurrentRow));
+    }
+    close();
+  }
+  return results;
+}
+
 template<typename TableRow>
 int DBTable<TableRow>::deleteByIndex(Ndb* connection, std::string index, AnyMap& any) {
   return deleteByIndex(connection, index, any, boost::none);
@@ -290,7 +609,7 @@ template<typename TableRow>
 int DBTable<TableRow>::deleteByIndex(Ndb* connection, std::string index, AnyMap& any, boost::optional<Int64> partitionId) {
   start(connection, partitionId);
   LOG_INFO(getName() << " -- deleteByIndex with index : " << index);
-  mIndex = getIndex(mDatabase, index);
+  mIndex = getIndex(connection, index);
   NdbIndexScanOperation* operation = getNdbIndexScanOperation(mCurrentTransaction, mIndex);
   operation->readTuples(NdbOperation::LM_Exclusive);
   mCurrentOperation = operation;
@@ -319,12 +638,12 @@ bool DBTable<TableRow>::rowsExists(Ndb* connection, std::string index,
     AnyMap& any){
   start(connection);
   LOG_DEBUG(getName() << " -- hasResults with index : " << index);
-  mIndex = getIndex(mDatabase, index);
+  mIndex = getIndex(connection, index);
   NdbIndexScanOperation* operation = getNdbIndexScanOperation(mCurrentTransaction, mIndex);
   operation->readTuples(NdbOperation::LM_CommittedRead);
   mCurrentOperation = operation;
   applyConditionOnOperation(operation, any);
-  mCurrentRow = getColumnValues(mCurrentOperation);
+  getColumnValues(mCurrentOperation, mCurrentRow);
   executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
   bool hasMoreRows = operation->nextResult(true) == 0;
   close();
@@ -346,6 +665,15 @@ void DBTable<TableRow>::doDelete(AnyMap& any) {
   applyConditionOnOperation(mCurrentOperation, any);
 }
 
+template<typename TableRow>
+template<typename... Columns>
+void DBTable<TableRow>::doDelete(const TableKey<Columns...>& pk) {
+  LOG_DEBUG(getName() << " -- doDelete ");
+  mCurrentOperation = getNdbOperation(mCurrentTransaction, mTable);
+  mCurrentOperation->deleteTuple();
+  applyKey(mCurrentOperation, pk);
+}
+
 template<typename TableRow>
 void DBTable<TableRow>::doDeleteOnCompanion(AnyMap& any) {
   LOG_DEBUG(getName() << " -- doDelete companion");
@@ -357,10 +685,14 @@ void DBTable<TableRow>::doDeleteOnCompanion(AnyMap& any) {
 
 template<typename TableRow>
 boost::unordered_map<int, TableRow> DBTable<TableRow>::doRead(Ndb* connection, UISet& ids){
-  AnyVec anyVec;
+  typedef TableKey<KeyColumn<0, int> > IdKey;
+  std::vector<IdKey> pks;
   IVec idsVec;
-  convert(ids, anyVec, idsVec);
-  std::vector<TableRow> rows = doRead(connection, anyVec);
+  for(UISet::iterator it=ids.begin(); it != ids.end(); ++it){
+    pks.push_back(IdKey(*it));
+    idsVec.push_back(*it);
+  }
+  std::vector<TableRow> rows = doRead(connection, pks);
   boost::unordered_map<int, TableRow> results;
   int i=0;
   for(typename std::vector<TableRow>::iterator it = rows.begin(); it!=rows.end(); ++it, i++){
@@ -371,10 +703,14 @@ boost::unordered_map<int, TableRow> DBTable<TableRow>::doRead(Ndb* connection, U
 
 template<typename TableRow>
 boost::unordered_map<Int64, TableRow> DBTable<TableRow>::doRead(Ndb* connection, ULSet& ids){
-  AnyVec anyVec;
+  typedef TableKey<KeyColumn<0, Int64> > IdKey;
+  std::vector<IdKey> pks;
   LVec idsVec;
-  convert(ids, anyVec, idsVec);
-  std::vector<TableRow> rows = doRead(connection, anyVec);
+  for(ULSet::iterator it=ids.begin(); it != ids.end(); ++it){
+    pks.push_back(IdKey(*it));
+    idsVec.push_back(*it);
+  }
+  std::vector<TableRow> rows = doRead(connection, pks);
   boost::unordered_map<Int64, TableRow> results;
   int i=0;
   for(typename std::vector<TableRow>::iterator it = rows.begin(); it!=rows.end(); ++it, i++){
@@ -385,34 +721,149 @@ boost::unordered_map<Int64, TableRow> DBTable<TableRow>::doRead(Ndb* connection,
 
 template<typename TableRow>
 std::vector<TableRow> DBTable<TableRow>::doRead(Ndb* connection, AnyVec& pks){
+  return readRows(connection, pks);
+}
+
+template<typename TableRow>
+template<typename... Columns>
+std::vector<TableRow> DBTable<TableRow>::doRead(Ndb* connection,
+    const std::vector<TableKey<Columns...> >& pks){
+  return readRows(connection, pks);
+}
+
+template<typename TableRow>
+template<typename Keys>
+std::vector<TableRow> DBTable<TableRow>::readRows(Ndb* connection, Keys& pks){
   start(connection);
   LOG_DEBUG(getName() << " -- doRead : " << pks.size() << " rows");
-  Rows rows;
-  for(AnyVec::iterator it=pks.begin(); it != pks.end(); ++it){
-    AnyMap pk = *it;
+  std::vector<TableRow> results;
+  if(useRecord(connection)){
+    std::vector<char> rows(mRecordLength * pks.size());
+    char* row = rows.data();
+    for(auto& pk : pks){
+      readRecord(mCurrentTransaction, pk, row);
+      row += mRecordLength;
+    }
+    executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
+    row = rows.data();
+    for(size_t i = 0; i < pks.size(); i++, row += mRecordLength){
+      results.push_back(getRow(bindRecord(row)));
+    }
+    close();
+    return results;
+  }
+
+  std::vector<RowValues> rows(pks.size());
+  for(size_t i = 0; i < pks.size(); i++){
     NdbOperation* op = getNdbOperation(mCurrentTransaction, mTable);
     op->readTuple(NdbOperation::LM_CommittedRead);
-    applyConditionOnOperation(op, pk);
-    rows.push_back(getColumnValues(op));
+    applyKey(op, pks[i]);
+    getColumnValues(op, rows[i]);
   }
   executeTransaction(mCurrentTransaction, NdbTransaction::Commit);
-  
-  std::vector<TableRow> results;
-  for(Rows::iterator it=rows.begin(); it != rows.end(); ++it){
+
+  for(std::vector<RowValues>::iterator it=rows.begin(); it != rows.end(); ++it){
     results.push_back(getRow(*it));
   }
   close();
   return results;
 }
 
+template<typename TableRow>
+bool DBTable<TableRow>::prepareRead(Ndb* connection, AnyVec& pks, AsyncRead* read){
+  return prepareRows(connection, pks, read);
+}
+
+template<typename TableRow>
+template<typename... Columns>
+bool DBTable<TableRow>::prepareRead(Ndb* connection,
+    const std::vector<TableKey<Columns...> >& pks, AsyncRead* read){
+  return prepareRows(connection, pks, read);
+}
+
+template<typename TableRow>
+template<typename Keys>
+bool DBTable<TableRow>::prepareRows(Ndb* connection, Keys& pks, AsyncRead* read){
+  if(pks.empty()){
+    return false;
+  }
+  mTable = getTable(connection);
+  LOG_DEBUG(getName() << " -- prepare async read : " << pks.size() << " rows");
+  read->mTransaction = startNdbTransaction(connection);
+  if(useRecord(connection)){
+    read->mRowBuffer.resize(mRecordLength * pks.size());
+    char* row = read->mRowBuffer.data();
+    for(auto& pk : pks){
+      readRecord(read->mTransaction, pk, row);
+      row += mRecordLength;
+    }
+  }else{
+    read->mRows.resize(pks.size());
+    for(size_t i = 0; i < pks.size(); i++){
+      NdbOperation* op = getNdbOperation(read->mTransaction, mTable);
+      op->readTuple(NdbOperation::LM_CommittedRead);
+      applyKey(op, pks[i]);
+      getColumnValues(op, read->mRows[i]);
+    }
+  }
+  read->mTransaction->executeAsynchPrepare(NdbTransaction::Commit,
+      &AsyncRead::callback, read);
+  return true;
+}
+
+template<typename TableRow>
+std::vector<TableRow> DBTable<TableRow>::completeRead(AsyncRead* read){
+  std::vector<TableRow> results;
+  if(read->mTransaction == nullptr){
+    return results;
+  }
+  if(!read->mCompleted){
+    LOG_FATAL(getName() << " -- async read was not polled before completing it");
+  }
+  if(read->mResult == -1){
+    try{
+      checkTransactionError(read->mTransaction);
+    }catch(NdbTupleDidNotExist& e){
+      read->mTransaction->close();
+      read->mTransaction = nullptr;
+      throw e;
+    }
+  }
+  if(!read->mRowBuffer.empty()){
+    const char* row = read->mRowBuffer.data();
+    const char* end = row + read->mRowBuffer.size();
+    for(; row < end; row += mRecordLength){
+      results.push_back(getRow(bindRecord(row)));
+    }
+    read->mRowBuffer.clear();
+  }
+  for(std::vector<RowValues>::iterator it=read->mRows.begin(); it != read->mRows.end(); ++it){
+    results.push_back(getRow(*it));
+  }
+  read->mRows.clear();
+  read->mTransaction->close();
+  read->mTransaction = nullptr;
+  LOG_DEBUG(getName() << " -- completed async read : " << results.size() << " rows");
+  return results;
+}
+
 template<typename TableRow>
 int DBTable<TableRow>::getColumnIdInDB(int colIndex) {
-  return getColumnIdInDB(getColumn(colIndex).c_str());
+  if(mTable != NULL){
+    resolveColumns();
+    return mTableColumns[colIndex]->getColumnNo();
+  }
+  return DONT_EXIST_INT();
 }
 
 template<typename TableRow>
 int DBTable<TableRow>::getColumnIdInDB(const char* colName) {
   if(mTable != NULL){
+    for (strvec_size_type i = 0; i < getNoColumns(); i++) {
+      if (getColumn(i) == colName) {
+        return getColumnIdInDB(i);
+      }
+    }
     int id = mTable->getColumn(colName)->getColumnNo();
     LOG_DEBUG(getName() << " -- Got id [" << id << "] for Column [" << colName << "]");
     return id;
@@ -461,6 +912,35 @@ void DBTable<TableRow>::applyConditionOnOperation(NdbOperation* operation, AnyMa
   LOG_DEBUG(getName() << " -- apply conditions on operation " << std::endl << log.str());
 }
 
+template<typename TableRow>
+void DBTable<TableRow>::applyBoundOnOperation(NdbIndexScanOperation* operation, AnyMap& any) {
+  for (AnyMap::iterator it = any.begin(); it != any.end(); ++it) {
+    std::string colName = getColumn(it->first);
+    Any& a = it->second;
+    int res = 0;
+    if (a.type() == typeid (int)) {
+      int pk = boost::any_cast<int>(a);
+      res = operation->setBound(colName.c_str(), NdbIndexScanOperation::BoundEQ, &pk);
+    } else if(a.type() == typeid(Int64)){
+      Int64 pk = boost::any_cast<Int64>(a);
+      res = operation->setBound(colName.c_str(), NdbIndexScanOperation::BoundEQ, &pk);
+    } else if(a.type() == typeid(Int8)){
+      Int8 pk = boost::any_cast<Int8>(a);
+      res = operation->setBound(colName.c_str(), NdbIndexScanOperation::BoundEQ, &pk);
+    } else if(a.type() == typeid(Int16)){
+      Int16 pk = boost::any_cast<Int16>(a);
+      res = operation->setBound(colName.c_str(), NdbIndexScanOperation::BoundEQ, &pk);
+    } else if (a.type() == typeid (std::string)) {
+      std::string pk = get_ndb_varchar(boost::any_cast<std::string>(a),
+          mTable->getColumn(colName.c_str())->getArrayType());
+      res = operation->setBound(colName.c_str(), NdbIndexScanOperation::BoundEQ, pk.data());
+    }else{
+      LOG_ERROR(getName() << " -- apply bound unknown type" << a.type().name());
+    }
+    if (res == -1) LOG_NDB_API_FATAL(getName(), operation->getNdbError());
+  }
+}
+
 template<typename TableRow>
 void DBTable<TableRow>::applyConditionOnOperationOnCompanion(NdbOperation* operation, AnyMap& any) {
   std::stringstream log;
@@ -497,28 +977,6 @@ void DBTable<TableRow>::applyConditionOnOperationOnCompanion(NdbOperation* opera
   LOG_DEBUG(getName()  << " : " << mCompanionTableBase->getName() << " -- apply conditions on operation " << std::endl << log.str());
 }
 
-template<typename TableRow>
-void DBTable<TableRow>::convert(UISet& ids, AnyVec& resultAny, IVec& resultVec){
-  for(UISet::iterator it=ids.begin(); it != ids.end(); ++it){
-    int id = *it;
-    AnyMap a;
-    a[0]=id;
-    resultAny.push_back(a);
-    resultVec.push_back(id);
-  }
-}
-
-template<typename TableRow>
-void DBTable<TableRow>::convert(ULSet& ids, AnyVec& resultAny, LVec& resultVec){
-  for(ULSet::iterator it=ids.begin(); it != ids.end(); ++it){
-    Int64 id = *it;
-    AnyMap a;
-    a[0]=id;
-    resultAny.push_back(a);
-    resultVec.push_back(id);
-  }
-}
-
 template<typename TableRow>
 Int64 DBTable<TableRow>:: getRandomPartitionId(){
   std::srand(std::time(nullptr));
@@ -528,7 +986,9 @@ Int64 DBTable<TableRow>:: getRandomPartitionId(){
 
 template<typename TableRow>
 DBTable<TableRow>::~DBTable() {
-
+  if (mRecord != nullptr) {
+    mRecordDatabase->releaseRecord(mRecord);
+  }
 }
 #endif /* TABLE_H */
 
@@ -20,6 +20,7 @@
 #ifndef DBTABLEBASE_H
 #define DBTABLEBASE_H
 #include "Utils.h"
+#include "DictionaryCache.h"
 
 inline static int DONT_EXIST_INT() {
   return -1;
@@ -31,12 +32,154 @@ inline const static std::string DONT_EXIST_STR() {
 
 typedef typename std::vector<std::string>::size_type strvec_size_type;
 
+#define ASYNC_POLL_TIMEOUT 3000
+
+/*
+ * A column value of a row, either read through an NdbRecAttr or decoded by
+ * offset from a row buffer that was read with the table NdbRecord.
+ */
+class RowValue {
+public:
+  RowValue() : mAttr(nullptr), mColumn(nullptr), mData(nullptr), mNull(false) {
+  }
+
+  void set(const NdbRecAttr* attr) {
+    mAttr = attr;
+  }
+
+  void set(const NdbDictionary::Column* column, const char* data, bool null) {
+    mAttr = nullptr;
+    mColumn = column;
+    mData = data;
+    mNull = null;
+  }
+
+  bool isNULL() const {
+    return mAttr != nullptr ? mAttr->isNULL() == 1 : mNull;
+  }
+
+  Int8 int8_value() const {
+    return mAttr != nullptr ? mAttr->int8_value() : get<Int8>();
+  }
+
+  short short_value() const {
+    return mAttr != nullptr ? mAttr->short_value() : get<short>();
+  }
+
+  Int32 int32_value() const {
+    return mAttr != nullptr ? mAttr->int32_value() : get<Int32>();
+  }
+
+  Int64 int64_value() const {
+    return mAttr != nullptr ? mAttr->int64_value() : get<Int64>();
+  }
+
+  Uint64 u_64_value() const {
+    return mAttr != nullptr ? mAttr->u_64_value() : get<Uint64>();
+  }
+
+  const char* aRef() const {
+    return mAttr != nullptr ? mAttr->aRef() : mData;
+  }
+
+  Uint32 get_size_in_bytes() const {
+    if (mAttr != nullptr) {
+      return mAttr->get_size_in_bytes();
+    }
+    return mNull ? 0 : mColumn->getSizeInBytes();
+  }
+
+  const NdbDictionary::Column* getColumn() const {
+    return mAttr != nullptr ? mAttr->getColumn() : mColumn;
+  }
+
+  NdbDictionary::Column::Type getType() const {
+    return getColumn()->getType();
+  }
+
+private:
+  const NdbRecAttr* mAttr;
+  const NdbDictionary::Column* mColumn;
+  const char* mData;
+  bool mNull;
+
+  template<typename T>
+  T get() const {
+    T value = 0;
+    if (!mNull) {
+      memcpy(&value, mData, sizeof(T));
+    }
+    return value;
+  }
+};
+
+/*
+ * The column values of a row in the order of the table columns, the values
+ * are bound once and read through values[i]->.
+ */
+class RowValues {
+public:
+  RowValues() {
+  }
+
+  explicit RowValues(size_t columns) : mValues(columns) {
+  }
+
+  void resize(size_t columns) {
+    mValues.resize(columns);
+  }
+
+  size_t size() const {
+    return mValues.size();
+  }
+
+  void set(size_t i, const NdbRecAttr* attr) {
+    mValues[i].set(attr);
+  }
+
+  void set(size_t i, const NdbDictionary::Column* column, const char* data,
+      bool null) {
+    mValues[i].set(column, data, null);
+  }
+
+  const RowValue* operator[](size_t i) const {
+    return &mValues[i];
+  }
+
+private:
+  std::vector<RowValue> mValues;
+};
+
 struct NdbTupleDidNotExist : public std::exception {
   const char * what () const throw () {
     return "Tuple did not exist";
   }
 };
 
+/*
+ * a scan that failed on a temporary or node recovery error, the rows read so
+ * far are incomplete and the scan has to be started over.
+ */
+struct NdbScanInterrupted : public std::exception {
+  const char * what () const throw () {
+    return "Scan interrupted by a temporary error";
+  }
+};
+
+/*
+ * blocks until the data nodes are reachable again, the cluster connection
+ * reconnects on its own so that the Ndb objects and caches stay valid.
+ */
+inline void waitForCluster(Ndb* connection, const std::string& who) {
+  int attempts = 0;
+  while (connection->get_ndb_cluster_connection().wait_until_ready(
+      WAIT_UNTIL_READY, WAIT_UNTIL_READY) < 0) {
+    attempts++;
+    LOG_WARN(who << " waiting for the cluster to be ready, attempt "
+        << attempts);
+  }
+}
+
 class DBTableBase {
 public:
   DBTableBase(const std::string table) : mTableName(table) {
@@ -47,6 +190,21 @@ public:
     return mTableName;
   }
 
+  /*
+   * sends all the transactions prepared with executeAsynchPrepare on the
+   * connection and polls until the given number of them completed.
+   */
+  static void waitForAsyncTransactions(Ndb* connection, int transactions) {
+    int completed = 0;
+    while (completed < transactions) {
+      int res = connection->sendPollNdb(ASYNC_POLL_TIMEOUT, transactions - completed);
+      if (res < 0) {
+        LOG_NDB_API_FATAL("sendPollNdb", connection->getNdbError());
+      }
+      completed += res;
+    }
+  }
+
   const std::string getColumn(unsigned int index) const {
     if (index < mColumns.size()) {
       return mColumns[index];
@@ -100,6 +258,27 @@ protected:
     return table;
   }
 
+  const NdbDictionary::Table* getTable(Ndb* connection) {
+    return getTable(connection, getName());
+  }
+
+  const NdbDictionary::Table* getTable(Ndb* connection, const std::string& name) {
+    const NdbDictionary::Table* table = DictionaryCache::getInstance().getTable(
+        connection, name);
+    if (!table) LOG_NDB_API_FATAL(getName(), connection->getDictionary()->getNdbError());
+    return table;
+  }
+
+  const NdbDictionary::Index* getIndex(Ndb* connection, const std::string& index_name) {
+    const NdbDictionary::Index* index = DictionaryCache::getInstance().getIndex(
+        connection, index_name, getName());
+    if (!index) {
+      LOG_ERROR(getName() << " get index:" << index_name << " error");
+      LOG_NDB_API_FATAL(getName(), connection->getDictionary()->getNdbError());
+    }
+    return index;
+  }
+
   const NdbDictionary::Index* getIndex(const NdbDictionary::Dictionary* database, const std::string& index_name) {
     return getIndex(database, index_name, getName());
   }
@@ -144,32 +323,61 @@ protected:
   }
 
   NdbTransaction* startNdbTransaction(Ndb* connection) {
-    NdbTransaction* ts = connection->startTransaction();
-    if (!ts) LOG_NDB_API_FATAL(getName(), connection->getNdbError());
+    NdbTransaction* ts;
+    while ((ts = connection->startTransaction()) == NULL) {
+      waitOnTemporaryError(connection);
+    }
     return ts;
   }
 
   NdbTransaction* startNdbTransaction(Ndb* connection, const NdbDictionary::Table* table, const Ndb::Key_part_ptr* keyData) {
-    NdbTransaction* ts = connection->startTransaction(table, keyData);
-    if (!ts) LOG_NDB_API_FATAL(getName(), connection->getNdbError());
+    NdbTransaction* ts;
+    while ((ts = connection->startTransaction(table, keyData)) == NULL) {
+      waitOnTemporaryError(connection);
+    }
     return ts;
   }
 
+  /*
+   * transactions can not be started while the data nodes restart, the
+   * caller is paused until the cluster is back instead of exiting.
+   */
+  void waitOnTemporaryError(Ndb* connection) {
+    const NdbError& error = connection->getNdbError();
+    if (error.status != NdbError::TemporaryError &&
+        error.classification != NdbError::NodeRecoveryError) {
+      LOG_NDB_API_FATAL(getName(), error);
+    }
+    LOG_NDB_API_ERROR(getName(), error);
+    waitForCluster(connection, getName());
+    boost::this_thread::sleep(boost::posix_time::seconds(DELAY_BETWEEN_RETRIES));
+  }
+
+  bool isTemporaryError(const NdbError& error) {
+    return error.status == NdbError::TemporaryError ||
+        error.classification == NdbError::NodeRecoveryError;
+  }
+
   void executeTransaction(NdbTransaction* transaction, NdbTransaction::ExecType exec_type) {
     if (transaction->execute(exec_type) == -1) {
-      const NdbError& error = transaction->getNdbError();
-      LOG_ERROR(mTableName << ": transaction got error code: " << error.code << " msg: " << error.message);
-      if(error.classification == NdbError::NoDataFound && error.code == 626){
-        throw NdbTupleDidNotExist();
-      }else{
-        LOG_NDB_API_FATAL(getName(), transaction->getNdbError());
-      }
+      checkTransactionError(transaction);
+    }
+  }
+
+  void checkTransactionError(NdbTransaction* transaction) {
+    const NdbError& error = transaction->getNdbError();
+    LOG_ERROR(mTableName << ": transaction got error code: " << error.code << " msg: " << error.message);
+    if(error.classification == NdbError::NoDataFound && error.code == 626){
+      throw NdbTupleDidNotExist();
+    }else{
+      LOG_NDB_API_FATAL(getName(), transaction->getNdbError());
     }
   }
 
-  std::string get_ndb_varchar(std::string str, NdbDictionary::Column::ArrayType array_type) {
-    std::stringstream data;
+  std::string get_ndb_varchar(const std::string& str, NdbDictionary::Column::ArrayType array_type) {
+    std::string data;
     int len = str.length();
+    data.reserve(len + 2);
 
     switch (array_type) {
       case NdbDictionary::Column::ArrayTypeFixed:
@@ -177,14 +385,15 @@ protected:
          No prefix length is stored in aRef. Data starts from aRef's first byte
          data might be padded with blank or null bytes to fill the whole column
          */
-        data << str;
+        data.append(str);
         break;
       case NdbDictionary::Column::ArrayTypeShortVar:
         /*
          First byte of aRef has the length of data stored
          Data starts from second byte of aRef
          */
-        data << ((char) len) << str;
+        data.push_back((char) len);
+        data.append(str);
         break;
       case NdbDictionary::Column::ArrayTypeMediumVar:
         /*
@@ -193,10 +402,12 @@ protected:
          */
         int m = len / 256;
         int l = len % 256;
-        data << ((char) l) << ((char) m) << str;
+        data.push_back((char) l);
+        data.push_back((char) m);
+        data.append(str);
         break;
     }
-    return data.str();
+    return data;
   }
 
   /*
@@ -205,7 +416,7 @@ protected:
    */
 
   /* extracts the length and the start byte of the data stored */
-  int get_byte_array(const NdbRecAttr* attr,
+  int get_byte_array(const RowValue* attr,
           const char*& first_byte,
           size_t& bytes) {
     const NdbDictionary::Column::ArrayType array_type =
@@ -213,6 +424,12 @@ protected:
     const size_t attr_bytes = attr->get_size_in_bytes();
     const char* aRef = attr->aRef();
 
+    if (attr->isNULL()) {
+      first_byte = aRef;
+      bytes = 0;
+      return 0;
+    }
+
     switch (array_type) {
       case NdbDictionary::Column::ArrayTypeFixed:
         /*
@@ -260,10 +477,10 @@ protected:
   }
 
   /*
-   Extracts the string from given NdbRecAttr
+   Extracts the string from given column value
    Uses get_byte_array internally
    */
-  std::string get_string(const NdbRecAttr* attr) {
+  std::string get_string(const RowValue* attr) {
     size_t attr_bytes;
     const char* data_start_ptr = NULL;
 
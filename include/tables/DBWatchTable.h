@@ -20,6 +20,8 @@
 #ifndef DBWATCHTABLE_H
 #define DBWATCHTABLE_H
 #include "DBTable.h"
+#include "EventRecorder.h"
+#include <functional>
 
 #define PRIMARY_INDEX "PRIMARY"
 
@@ -27,11 +29,14 @@ typedef std::vector<NdbDictionary::Event::TableEvent> TEventVec;
 typedef typename TEventVec::size_type evtvec_size_type;
 
 template<typename TableRow>
-struct EpochsRowsMap{
-  std::vector<Uint64>* mEpochs;
-  boost::unordered_map<Uint64,std::queue<TableRow>* >* mRowsByEpoch;
+struct EpochRow{
+  Uint64 mEpoch;
+  TableRow mRow;
 };
 
+template<typename TableRow>
+using EpochRowConsumer = std::function<void(EpochRow<TableRow>&)>;
+
 enum LogType{
   FSLOG,
   PROVAPPLOG,
@@ -40,9 +45,13 @@ enum LogType{
 };
 
 struct LogHandler{
+  LogHandler(Uint64 epoch = 0) : mEpoch(epoch) {}
   virtual void removeLog(Ndb* connection) const= 0;
   virtual LogType getType() const = 0;
   virtual std::string getDescription() const = 0;
+
+  // epoch the log row was committed in, 0 if unknown
+  const Uint64 mEpoch;
 };
 
 template<typename TableRow>
@@ -52,10 +61,14 @@ public:
   DBWatchTable(const std::string table, DBTableBase* companionTable);
   evtvec_size_type getNoEvents() const;
   NdbDictionary::Event::TableEvent getEvent(evtvec_size_type index) const;
-  EpochsRowsMap<TableRow> getAllForRecovery(Ndb* connection);
+  Uint32 getNoRecoveryScanners(Ndb* connection, Uint32 max_scanners);
+  int readForRecovery(Ndb* connection, Uint32 scanner, Uint32 scanners,
+      Uint64 after_epoch, EpochRowConsumer<TableRow> consume);
   virtual ~DBWatchTable();
   virtual std::string getPKStr(TableRow row);
   virtual LogHandler* getLogRemovalHandler(TableRow row);
+  virtual void writeRow(EventRecordWriter& writer, TableRow row);
+  virtual TableRow readRow(EventRecordReader& reader);
 
 private:
   TEventVec mWatchEvents;
@@ -65,6 +78,22 @@ protected:
   void addWatchEvent(NdbDictionary::Event::TableEvent event);
   void addRecoveryIndex(const std::string recovery);
 
+private:
+  int scanForRecovery(Ndb* connection, boost::optional<Uint32> fragment,
+      Uint64 after_epoch, EpochRowConsumer<TableRow>& consume);
+};
+
+/*
+ * key of a log row used to match the rows read by the recovery with the
+ * events received meanwhile, tables with a typed primary key specialize it.
+ */
+template<typename TableRow>
+struct WatchRowKey {
+  typedef std::string Type;
+
+  static Type get(DBWatchTable<TableRow>* table, TableRow row) {
+    return table->getPKStr(row);
+  }
 };
 
 template<typename TableRow>
@@ -103,52 +132,105 @@ template<typename TableRow>
 DBWatchTable<TableRow>::~DBWatchTable() {
 }
 
+/*
+ * the fragments of the table are split among the scanners, a table with a
+ * recovery index is read by a single scanner in the index order.
+ */
 template<typename TableRow>
-EpochsRowsMap<TableRow> DBWatchTable<TableRow>::getAllForRecovery(Ndb* connection) {
-  typedef boost::unordered_map<Uint64, std::queue<TableRow>* > EpochRows;
-  typedef typename EpochRows::iterator EpochRowIterator;
-
-  ptime start = Utils::getCurrentTime();
-
-  this->setReadEpoch(true);
-
-  EpochRows* rowsByEpoch = new EpochRows();
-  std::vector<Uint64>* epochs = new std::vector<Uint64>();
-
-  if(mRecoveryIndex != ""){
-    LOG_DEBUG("Read all for " << this->getName() << " recovery sorted by " <<
-    mRecoveryIndex);
-    this->getAll(connection, mRecoveryIndex);
-  }else{
-    LOG_DEBUG("Read all for " << this->getName() << " recovery");
-    this->getAll(connection);
+Uint32 DBWatchTable<TableRow>::getNoRecoveryScanners(Ndb* connection,
+    Uint32 max_scanners) {
+  if (mRecoveryIndex != "") {
+    return 1;
   }
+  Uint32 fragments = this->getTable(connection)->getFragmentCount();
+  return std::max(1u, std::min(fragments, max_scanners));
+}
 
-  while (this->next()) {
-    TableRow row = this->currRow();
-    Uint64 epoch = this->currEpoch();
-
-    EpochRowIterator curr = rowsByEpoch->find(epoch);
-    std::queue<TableRow>* currRows;
-    if (curr == rowsByEpoch->end()) {
-      currRows = new std::queue<TableRow>();
-      rowsByEpoch->emplace(epoch, currRows);
-      epochs->push_back(epoch);
-    } else {
-      currRows = curr->second;
+/*
+ * hands every row committed after after_epoch of the fragments assigned to
+ * the scanner to consume in scan order, returns the number of rows skipped.
+ * Only local scan state is used so that the scanners can run concurrently
+ * each with its own connection. Throws NdbScanInterrupted if a scan fails on
+ * a temporary error, the rows consumed so far are then incomplete.
+ */
+template<typename TableRow>
+int DBWatchTable<TableRow>::readForRecovery(Ndb* connection, Uint32 scanner,
+    Uint32 scanners, Uint64 after_epoch, EpochRowConsumer<TableRow> consume) {
+  int skipped = 0;
+  if (mRecoveryIndex != "") {
+    skipped += scanForRecovery(connection, boost::none, after_epoch, consume);
+  } else {
+    Uint32 fragments = this->getTable(connection)->getFragmentCount();
+    for (Uint32 fragment = scanner; fragment < fragments; fragment += scanners) {
+      skipped += scanForRecovery(connection, fragment, after_epoch, consume);
     }
-    currRows->push(row);
   }
+  return skipped;
+}
 
-  this->setReadEpoch(false);
-
-  std::sort(epochs->begin(), epochs->end());
+template<typename TableRow>
+int DBWatchTable<TableRow>::scanForRecovery(Ndb* connection,
+    boost::optional<Uint32> fragment, Uint64 after_epoch,
+    EpochRowConsumer<TableRow>& consume) {
+  NdbTransaction* transaction = this->startNdbTransaction(connection);
+  NdbScanOperation* operation;
+  if (fragment) {
+    LOG_DEBUG("Read fragment " << fragment.get() << " of " << this->getName()
+    << " for recovery");
+    operation = this->getNdbScanOperation(transaction,
+        this->getTable(connection));
+    operation->readTuples(NdbOperation::LM_CommittedRead);
+    operation->setPartitionId(fragment.get());
+  } else {
+    LOG_DEBUG("Read all for " << this->getName() << " recovery sorted by "
+    << mRecoveryIndex);
+    NdbIndexScanOperation* indexOperation = this->getNdbIndexScanOperation(
+        transaction, this->getIndex(connection, mRecoveryIndex));
+    indexOperation->readTuples(NdbOperation::LM_CommittedRead,
+        NdbScanOperation::SF_OrderBy);
+    operation = indexOperation;
+  }
 
-  LOG_DEBUG("ePipe done reading/sorting for " << this->getName()
-  << " recovery in " << Utils::getTimeDiffInMilliseconds(start, Utils::getCurrentTime()) << " msec");
+  strvec_size_type numCols = this->getNoColumns();
+  RowValues values(numCols + 1);
+  for (strvec_size_type i = 0; i < numCols; i++) {
+    values.set(i, this->getNdbOperationValue(operation, this->getColumn(i)));
+  }
+  values.set(numCols, this->getNdbOperationValue(operation,
+      NdbDictionary::Column::ROW_GCI64));
+  if (transaction->execute(NdbTransaction::Commit) == -1) {
+    if (!this->isTemporaryError(transaction->getNdbError())) {
+      this->checkTransactionError(transaction);
+    }
+    LOG_NDB_API_ERROR(this->getName(), transaction->getNdbError());
+    transaction->close();
+    throw NdbScanInterrupted();
+  }
 
-  EpochsRowsMap<TableRow> map {epochs, rowsByEpoch};
-  return map;
+  int skipped = 0;
+  int check;
+  while ((check = operation->nextResult(true)) == 0) {
+    Uint64 epoch = values[numCols]->u_64_value();
+    if (epoch <= after_epoch) {
+      skipped++;
+      continue;
+    }
+    EpochRow<TableRow> row = {epoch, this->getRow(values)};
+    consume(row);
+  }
+  if (check == -1) {
+    // a partial read would drop log rows from the recovery
+    NdbError error = operation->getNdbError();
+    LOG_NDB_API_ERROR(this->getName(), error);
+    transaction->close();
+    if (!this->isTemporaryError(error)) {
+      LOG_NDB_API_FATAL(this->getName(), error);
+    }
+    throw NdbScanInterrupted();
+  }
+  operation->close();
+  transaction->close();
+  return skipped;
 }
 
 template<typename TableRow>
@@ -160,5 +242,16 @@ template<typename TableRow>
 LogHandler* DBWatchTable<TableRow>::getLogRemovalHandler(TableRow row) {
   return nullptr;
 }
+
+template<typename TableRow>
+void DBWatchTable<TableRow>::writeRow(EventRecordWriter& writer, TableRow row) {
+  LOG_FATAL("recording events is not supported for " << this->getName());
+}
+
+template<typename TableRow>
+TableRow DBWatchTable<TableRow>::readRow(EventRecordReader& reader) {
+  LOG_FATAL("replaying events is not supported for " << this->getName());
+  return TableRow();
+}
 #endif /* DBWATCHTABLE_H */
 
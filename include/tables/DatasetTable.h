@@ -131,7 +131,7 @@ public:
     DatasetProjectSCache::getInstance(lru_cap, "DatasetProject");
   }
 
-  DatasetRow getRow(NdbRecAttr* values[]) {
+  DatasetRow getRow(const RowValues& values) {
     DatasetRow row;
     row.mId = values[0]->int32_value();
     row.mInodeId = values[1]->int64_value();
@@ -189,13 +189,21 @@ public:
       return;
     }
 
+    AnyVec ranges;
+    LVec datasetIds;
     for (ULSet::iterator it = dataset_inode_ids.begin(); it != dataset_inode_ids.end(); ++it) {
-      Int64 dataset_inode_id = *it;
       AnyMap args;
       //DatasetInodeId
-      args[1] = dataset_inode_id;
-      
-      DatasetVec datasets = doRead(connection, getColumn(1), args);
+      args[1] = *it;
+      ranges.push_back(args);
+      datasetIds.push_back(*it);
+    }
+
+    std::vector<DatasetVec> datasetsByRange = doReadRanges(connection, getColumn(1), ranges);
+
+    for (size_t i = 0; i < datasetIds.size(); i++) {
+      Int64 dataset_inode_id = datasetIds[i];
+      DatasetVec& datasets = datasetsByRange[i];
 
       UISet projectIds;
       for (DatasetVec::iterator it = datasets.begin(); it != datasets.end(); ++it) {
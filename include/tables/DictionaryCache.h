@@ -0,0 +1,148 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+#ifndef DICTIONARYCACHE_H
+#define DICTIONARYCACHE_H
+
+#include "Utils.h"
+#include <boost/atomic.hpp>
+
+typedef boost::unordered_map<std::string, const NdbDictionary::Index*> IndexHandles;
+
+/*
+ * The table and index handles resolved by one Ndb connection. It is kept in
+ * the custom data of the Ndb object, so only the thread using the connection
+ * touches it.
+ */
+struct ConnectionDictionary {
+  Uint64 mVersion;
+  boost::unordered_map<std::string, const NdbDictionary::Table*> mTables;
+  boost::unordered_map<std::string, IndexHandles> mIndexes;
+};
+
+/*
+ * Per connection cache of the dictionary handles. A schema change of a table
+ * bumps the cache version, each connection then drops and invalidates its
+ * handles of the changed tables on its next lookup and reloads them from
+ * NDB, so the steady state never goes to the dictionary.
+ */
+class DictionaryCache {
+public:
+
+  static DictionaryCache& getInstance() {
+    static DictionaryCache instance;
+    return instance;
+  }
+
+  const NdbDictionary::Table* getTable(Ndb* connection, const std::string& table) {
+    ConnectionDictionary* dict = getConnectionDictionary(connection);
+    boost::unordered_map<std::string, const NdbDictionary::Table*>::iterator it =
+        dict->mTables.find(table);
+    if (it != dict->mTables.end()) {
+      return it->second;
+    }
+    const NdbDictionary::Table* handle = connection->getDictionary()->getTable(
+        table.c_str());
+    if (handle != nullptr) {
+      dict->mTables[table] = handle;
+    }
+    return handle;
+  }
+
+  const NdbDictionary::Index* getIndex(Ndb* connection, const std::string& index,
+      const std::string& table) {
+    ConnectionDictionary* dict = getConnectionDictionary(connection);
+    IndexHandles& indexes = dict->mIndexes[table];
+    IndexHandles::iterator it = indexes.find(index);
+    if (it != indexes.end()) {
+      return it->second;
+    }
+    const NdbDictionary::Index* handle = connection->getDictionary()->getIndex(
+        index.c_str(), table.c_str());
+    if (handle != nullptr) {
+      indexes[index] = handle;
+    }
+    return handle;
+  }
+
+  /*
+   * drops the handles of a connection that is about to be deleted.
+   */
+  void release(Ndb* connection) {
+    delete static_cast<ConnectionDictionary*>(connection->getCustomData());
+    connection->setCustomData(nullptr);
+  }
+
+  void invalidate(const std::string& table) {
+    boost::mutex::scoped_lock lock(mLock);
+    Uint64 version = ++mVersion;
+    mInvalidated[table] = version;
+    LOG_INFO("invalidate the dictionary handles of " << table << " at version "
+        << version);
+  }
+
+private:
+  DictionaryCache() : mVersion(0) {
+  }
+
+  DictionaryCache(DictionaryCache const&);
+  void operator=(DictionaryCache const&);
+
+  boost::atomic<Uint64> mVersion;
+  boost::mutex mLock;
+  boost::unordered_map<std::string, Uint64> mInvalidated;
+
+  ConnectionDictionary* getConnectionDictionary(Ndb* connection) {
+    ConnectionDictionary* dict = static_cast<ConnectionDictionary*>(
+        connection->getCustomData());
+    if (dict == nullptr) {
+      dict = new ConnectionDictionary();
+      dict->mVersion = mVersion;
+      connection->setCustomData(dict);
+    } else if (dict->mVersion != mVersion) {
+      refresh(connection, dict);
+    }
+    return dict;
+  }
+
+  void refresh(Ndb* connection, ConnectionDictionary* dict) {
+    NdbDictionary::Dictionary* database = connection->getDictionary();
+    boost::mutex::scoped_lock lock(mLock);
+    for (boost::unordered_map<std::string, Uint64>::iterator it =
+        mInvalidated.begin(); it != mInvalidated.end(); ++it) {
+      if (it->second <= dict->mVersion) {
+        continue;
+      }
+      const std::string& table = it->first;
+      IndexHandles& indexes = dict->mIndexes[table];
+      for (IndexHandles::iterator idx = indexes.begin(); idx != indexes.end();
+          ++idx) {
+        database->invalidateIndex(idx->first.c_str(), table.c_str());
+      }
+      dict->mIndexes.erase(table);
+      if (dict->mTables.erase(table) > 0) {
+        database->invalidateTable(table.c_str());
+      }
+    }
+    dict->mVersion = mVersion;
+  }
+};
+
+#endif /* DICTIONARYCACHE_H */
@@ -23,10 +23,15 @@
 
 #include "ConcurrentPriorityQueue.h"
 #include "ConcurrentQueue.h"
+#include "RadixSort.h"
 #include "XAttrTable.h"
 #include "FileProvenanceXAttrBufferTable.h"
 #include "FileProvenanceConstantsRaw.h"
 
+typedef TableKey<KeyColumn<0, Int64>, KeyColumn<1, std::string>, KeyColumn<2, int>,
+    KeyColumn<3, Int64>, KeyColumn<4, std::string>, KeyColumn<5, int>,
+    KeyColumn<6, std::string> > FileProvenanceKey;
+
 struct FileProvenancePK {
   Int64 mInodeId;
   std::string mOperation;
@@ -57,16 +62,9 @@ struct FileProvenancePK {
     return out.str();
   }
 
-  AnyMap getMap() {
-    AnyMap a;
-    a[0] = mInodeId;
-    a[1] = mOperation;
-    a[2] = mLogicalTime;
-    a[3] = mTimestamp;
-    a[4] = mAppId;
-    a[5] = mUserId;
-    a[6] = mTieBreaker;
-    return a;
+  FileProvenanceKey getKey() const {
+    return FileProvenanceKey(mInodeId, mOperation, mLogicalTime, mTimestamp,
+        mAppId, mUserId, mTieBreaker);
   }
 };
 
@@ -97,6 +95,7 @@ struct FileProvenanceRow {
   Int16 mXAttrNumParts;
 
   ptime mEventCreationTime;
+  Uint64 mEpoch;
 
   FileProvenancePK getPK() {
     return FileProvenancePK(mInodeId, mOperation, mLogicalTime, mTimestamp, mAppId, mUserId, mTieBreaker);
@@ -106,6 +105,13 @@ struct FileProvenanceRow {
     return FPXAttrBufferPK(mInodeId, FileProvenanceConstantsRaw::XATTRS_USER_NAMESPACE, mXAttrName, mLogicalTime, mXAttrNumParts);
   }
 
+  Uint64 getSize() const {
+    return sizeof(FileProvenanceRow) + mOperation.size() + mAppId.size()
+        + mTieBreaker.size() + mInodeName.size() + mProjectName.size()
+        + mDatasetName.size() + mP1Name.size() + mP2Name.size()
+        + mParentName.size() + mUserName.size() + mXAttrName.size();
+  }
+
   std::string to_string() {
     std::stringstream stream;
     stream << "-------------------------" << std::endl;
@@ -163,50 +169,42 @@ struct FileProvenanceRowHash {
   }
 };
 
-struct FileProvenanceRowComparator {
+#define FILE_PROVENANCE_SORT_WORDS 4
 
-  bool operator()(const FileProvenanceRow &r1, const FileProvenanceRow &r2) const {
-    if (r1.mInodeId == r2.mInodeId) {
-      return r1.mLogicalTime > r2.mLogicalTime;
-    }
-    if(r1.mDatasetId == r2.mDatasetId) {
-      if(r1.mDatasetLogicalTime == r2.mDatasetLogicalTime) {
-        //if both operations work on a dataset and have the same logical time
-        //delete dataset should be last operation processed in epoch for this dataset logical time
-        if(isDeleteDataset(r1)) {
-          return true;
-        }
-        if(isDeleteDataset(r2)) {
-          return false;
-        }
-        //dataset xattr attach should be first operation processed in epoch for this dataset logical time
-        if(isDatasetProvCore(r1)) {
-          return false;
-        }
-        if(isDatasetProvCore(r2)) {
-          return true;
-        }
-      } else {
-        return r1.mDatasetLogicalTime > r2.mDatasetLogicalTime;
-      }
-    }
-    return r1.mInodeId > r2.mInodeId;
+/*
+ * rank of an operation among the operations of a dataset with the same
+ * dataset logical time, the prov core xattr of the dataset is attached first
+ * and the dataset delete is processed last.
+ */
+inline Uint64 getDatasetOpRank(const FileProvenanceRow& row) {
+  if (row.mInodeId != row.mDatasetId) {
+    return 1;
   }
-
-  bool isDeleteDataset(const FileProvenanceRow &r) const {
-    return r.mInodeId == r.mDatasetId
-     && FileProvenanceConstantsRaw::findOp(r.mOperation) == FileProvenanceConstantsRaw::Operation::OP_DELETE;
+  FileProvenanceConstantsRaw::Operation op = FileProvenanceConstantsRaw::findOp(row.mOperation);
+  if (op == FileProvenanceConstantsRaw::Operation::OP_DELETE) {
+    return 2;
   }
-  bool isDatasetProvCore(const FileProvenanceRow &r) const {
-    return r.mInodeId == r.mDatasetId
-    && (FileProvenanceConstantsRaw::findOp(r.mOperation) == FileProvenanceConstantsRaw::Operation::OP_XATTR_ADD
-    || FileProvenanceConstantsRaw::findOp(r.mOperation) == FileProvenanceConstantsRaw::Operation::OP_XATTR_UPDATE)
-    && r.mXAttrName == FileProvenanceConstantsRaw::XATTR_PROV_CORE;
+  if ((op == FileProvenanceConstantsRaw::Operation::OP_XATTR_ADD
+      || op == FileProvenanceConstantsRaw::Operation::OP_XATTR_UPDATE)
+      && row.mXAttrName == FileProvenanceConstantsRaw::XATTR_PROV_CORE) {
+    return 0;
   }
-};
+  return 1;
+}
+
+/*
+ * the operations of an epoch are ordered per dataset by the dataset logical
+ * time, the rank of the operation, the inode and its logical time.
+ */
+inline void getSortKey(const FileProvenanceRow& row, Uint64* words) {
+  words[0] = getRadixOrdered(row.mDatasetId);
+  words[1] = static_cast<Uint64>(getRadixOrdered(row.mDatasetLogicalTime)) << 32
+      | getDatasetOpRank(row);
+  words[2] = getRadixOrdered(row.mInodeId);
+  words[3] = getRadixOrdered(row.mLogicalTime);
+}
 
 typedef ConcurrentQueue<FileProvenanceRow> CPRq;
-typedef boost::heap::priority_queue<FileProvenanceRow, boost::heap::compare<FileProvenanceRowComparator> > PRpq;
 typedef std::vector <boost::optional<FileProvenancePK> > PKeys;
 typedef std::vector <FileProvenanceRow> Pq;
 
@@ -250,14 +248,23 @@ private:
 
 typedef CacheSingleton<FProvCache> FileProvCache;
 
+template<>
+struct WatchRowKey<FileProvenanceRow> {
+  typedef FileProvenanceKey Type;
+
+  static Type get(DBWatchTable<FileProvenanceRow>*, FileProvenanceRow row) {
+    return row.getPK().getKey();
+  }
+};
+
 class FileProvenanceLogTable : public DBWatchTable<FileProvenanceRow> {
 public:
   struct FileProvLogHandler : public LogHandler{
     FileProvenancePK mPK;
     boost::optional<FPXAttrBufferPK> mBufferPK;
 
-    FileProvLogHandler(FileProvenancePK pk, boost::optional<FPXAttrBufferPK> bufferPK) :
-    mPK(pk), mBufferPK(bufferPK) {}
+    FileProvLogHandler(FileProvenancePK pk, boost::optional<FPXAttrBufferPK> bufferPK,
+        Uint64 epoch) : LogHandler(epoch), mPK(pk), mBufferPK(bufferPK) {}
 
     void removeLog(Ndb* connection) const override {
       LOG_ERROR("do not use - logic error");
@@ -304,9 +311,10 @@ public:
     FileProvCache::getInstance(file_lru_cap, "FileProv");
   }
 
-  FileProvenanceRow getRow(NdbRecAttr* value[]) {
+  FileProvenanceRow getRow(const RowValues& value) {
     FileProvenanceRow row;
     row.mEventCreationTime = Utils::getCurrentTime();
+    row.mEpoch = 0;
     row.mInodeId = value[0]->int64_value();
     row.mOperation = get_string(value[1]);
     row.mLogicalTime = value[2]->int32_value();
@@ -333,12 +341,24 @@ public:
     return row;
   }
 
-  void cleanLogs(Ndb* connection, std::vector<const LogHandler*>& logrh) {
-    try{
-      cleanLogsOneTransaction(connection, logrh);
-    } catch (NdbTupleDidNotExist &e){
-      cleanLogsMultiTransaction(connection, logrh);
+  /*
+   * removes the file provenance logs and their xattr buffer rows in one
+   * transaction, returns the number of rows that were already deleted.
+   */
+  int cleanLogs(Ndb* connection, std::vector<const LogHandler*>& logrh) {
+    bool started = false;
+    for (auto log : logrh) {
+      if (log != nullptr && log->getType() == LogType::PROVFILELOG) {
+        const FileProvLogHandler *fplog = static_cast<const FileProvLogHandler *>(log);
+        if (!started) {
+          start(connection);
+          started = true;
+        }
+        _doDeleteOnCompanion(fplog);
+        _doDelete(fplog);
+      }
     }
+    return started ? endIgnoreMissing() : 0;
   }
 
   void cleanLog(Ndb* connection, const LogHandler* log) {
@@ -360,8 +380,65 @@ public:
     return row.getPK().to_string();
   }
 
-  LogHandler* getLogHandler(FileProvenancePK pk, boost::optional<FPXAttrBufferPK> bufferPK) {
-    return new FileProvLogHandler(pk, bufferPK);
+  void writeRow(EventRecordWriter& writer, FileProvenanceRow row) override {
+    writer.putInt(row.mInodeId);
+    writer.putString(row.mOperation);
+    writer.putInt(row.mLogicalTime);
+    writer.putInt(row.mTimestamp);
+    writer.putString(row.mAppId);
+    writer.putInt(row.mUserId);
+    writer.putString(row.mTieBreaker);
+    writer.putInt(row.mPartitionId);
+    writer.putInt(row.mProjectId);
+    writer.putInt(row.mDatasetId);
+    writer.putInt(row.mParentId);
+    writer.putString(row.mInodeName);
+    writer.putString(row.mProjectName);
+    writer.putString(row.mDatasetName);
+    writer.putString(row.mP1Name);
+    writer.putString(row.mP2Name);
+    writer.putString(row.mParentName);
+    writer.putString(row.mUserName);
+    writer.putString(row.mXAttrName);
+    writer.putInt(row.mLogicalTimeBatch);
+    writer.putInt(row.mTimestampBatch);
+    writer.putInt(row.mDatasetLogicalTime);
+    writer.putInt(row.mXAttrNumParts);
+  }
+
+  FileProvenanceRow readRow(EventRecordReader& reader) override {
+    FileProvenanceRow row;
+    row.mEventCreationTime = Utils::getCurrentTime();
+    row.mEpoch = 0;
+    row.mInodeId = reader.getInt();
+    row.mOperation = reader.getString();
+    row.mLogicalTime = reader.getInt();
+    row.mTimestamp = reader.getInt();
+    row.mAppId = reader.getString();
+    row.mUserId = reader.getInt();
+    row.mTieBreaker = reader.getString();
+    row.mPartitionId = reader.getInt();
+    row.mProjectId = reader.getInt();
+    row.mDatasetId = reader.getInt();
+    row.mParentId = reader.getInt();
+    row.mInodeName = reader.getString();
+    row.mProjectName = reader.getString();
+    row.mDatasetName = reader.getString();
+    row.mP1Name = reader.getString();
+    row.mP2Name = reader.getString();
+    row.mParentName = reader.getString();
+    row.mUserName = reader.getString();
+    row.mXAttrName = reader.getString();
+    row.mLogicalTimeBatch = reader.getInt();
+    row.mTimestampBatch = reader.getInt();
+    row.mDatasetLogicalTime = reader.getInt();
+    row.mXAttrNumParts = reader.getInt();
+    return row;
+  }
+
+  LogHandler* getLogHandler(FileProvenancePK pk, boost::optional<FPXAttrBufferPK> bufferPK,
+      Uint64 epoch) {
+    return new FileProvLogHandler(pk, bufferPK, epoch);
   }
 
   boost::optional<FPXAttrBufferRow> getCompanionRow(Ndb* connection, FPXAttrBufferPK key) {
@@ -375,28 +452,6 @@ public:
   }
 
 private:
-  void cleanLogsOneTransaction(Ndb* connection, std::vector<const LogHandler*>&logrh) {
-    start(connection);
-    for (auto log : logrh) {
-      if (log != nullptr && log->getType() == LogType::PROVFILELOG) {
-        const FileProvLogHandler *fplog = static_cast<const FileProvLogHandler *>(log);
-        _doDeleteOnCompanion(fplog);
-        _doDelete(fplog);
-      }
-    }
-    end();
-  }
-
-  void cleanLogsMultiTransaction(Ndb* connection, std::vector<const LogHandler*>&logrh) {
-    for (auto log : logrh) {
-      if (log != nullptr && log->getType() == LogType::PROVFILELOG) {
-        const FileProvLogHandler *fplog = static_cast<const FileProvLogHandler *>(log);
-        doDeleteOnCompanionTransaction(connection, fplog);
-        doDeleteTransaction(connection, fplog);
-      }
-    }
-  }
-
   void doDeleteOnCompanionTransaction(Ndb* connection, const FileProvLogHandler *fplog){
     try{
       start(connection);
@@ -430,9 +485,8 @@ private:
 
   void _doDelete(const FileProvLogHandler *fplog){
     FileProvenancePK fPK = fplog->mPK;
-    AnyMap fileProvPK = fPK.getMap();
     LOG_DEBUG("Delete file provenance row: " << fPK.to_string());
-    doDelete(fileProvPK);
+    doDelete(fPK.getKey());
   }
 };
 #endif /* FILEPROVENANCELOGTABLE_H */
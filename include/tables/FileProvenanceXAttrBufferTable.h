@@ -298,7 +298,7 @@ public:
     FProvCoreCache::getInstance(lru_cap, "FileProvCore");
   }
 
-  FPXAttrBufferRowPart getRow(NdbRecAttr* values[]) {
+  FPXAttrBufferRowPart getRow(const RowValues& values) {
     FPXAttrBufferRowPart row;
     row.mInodeId = values[0]->int64_value();
     row.mNamespace = values[1]->int8_value();
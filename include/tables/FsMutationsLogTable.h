@@ -23,6 +23,7 @@
 #include "DBWatchTable.h"
 #include "ConcurrentPriorityQueue.h"
 #include "ConcurrentQueue.h"
+#include "RadixSort.h"
 
 enum FsOpType {
   FsAdd = 0,
@@ -62,6 +63,8 @@ inline static const char *FsOpTypeToStr(FsOpType optype) {
   }
 }
 
+typedef TableKey<KeyColumn<0, Int64>, KeyColumn<1, Int64>, KeyColumn<2, int> > FsMutationLogKey;
+
 struct FsMutationPK {
   Int64 mDatasetINodeId;
   Int64 mInodeId;
@@ -72,6 +75,10 @@ struct FsMutationPK {
     mInodeId = inodeId;
     mLogicalTime = logicalTime;
   }
+
+  FsMutationLogKey getKey() const {
+    return FsMutationLogKey(mDatasetINodeId, mInodeId, mLogicalTime);
+  }
 };
 
 struct FsMutationRow {
@@ -88,6 +95,7 @@ struct FsMutationRow {
   std::string mInodeName;
 
   ptime mEventCreationTime;
+  Uint64 mEpoch;
 
   FsMutationPK getPK() {
     return FsMutationPK(mDatasetINodeId, mInodeId, mLogicalTime);
@@ -99,6 +107,10 @@ struct FsMutationRow {
     return stream.str();
   }
 
+  Uint64 getSize() const {
+    return sizeof(FsMutationRow) + mPk3.size() + mInodeName.size();
+  }
+
   std::string to_string() {
     std::stringstream stream;
     stream << "-------------------------" << std::endl;
@@ -185,33 +197,78 @@ struct FsMutationRowHash {
   }
 };
 
-struct FsMutationRowComparator {
-
-  bool operator()(const FsMutationRow &r1, const FsMutationRow &r2) const {
-    if (r1.mInodeId == r2.mInodeId) {
-      return r1.mLogicalTime > r2.mLogicalTime;
-    } else {
-      return r1.mInodeId > r2.mInodeId;
+/*
+ * identifies the document a mutation applies to, the inode itself, one of
+ * its xattrs or all of its xattrs. Mutations with the same key within a batch
+ * can be coalesced into the latest one since the reads return the current
+ * state anyway.
+ */
+struct FsMutationKey {
+  Int64 mDatasetINodeId;
+  Int64 mInodeId;
+  bool mXAttr;
+  Int64 mNamespace;
+  std::string mName;
+
+  FsMutationKey(FsMutationRow& row) : mDatasetINodeId(row.mDatasetINodeId),
+  mInodeId(row.mInodeId), mXAttr(row.isXAttrOperation()), mNamespace(-1) {
+    if (mXAttr && row.mOperation != XAttrAddAll) {
+      mNamespace = row.mPk2;
+      mName = row.mPk3;
     }
   }
+
+  bool operator==(const FsMutationKey& other) const {
+    return mDatasetINodeId == other.mDatasetINodeId && mInodeId == other
+    .mInodeId && mXAttr == other.mXAttr && mNamespace == other.mNamespace &&
+    mName == other.mName;
+  }
 };
 
+inline std::size_t hash_value(const FsMutationKey& key) {
+  std::size_t seed = 0;
+  boost::hash_combine(seed, key.mDatasetINodeId);
+  boost::hash_combine(seed, key.mInodeId);
+  boost::hash_combine(seed, key.mXAttr);
+  boost::hash_combine(seed, key.mNamespace);
+  boost::hash_combine(seed, key.mName);
+  return seed;
+}
+
+#define FS_MUTATION_SORT_WORDS 2
+
+/*
+ * the mutations of an epoch are ordered by inode and then by logical time
+ */
+inline void getSortKey(const FsMutationRow& row, Uint64* words) {
+  words[0] = getRadixOrdered(row.mInodeId);
+  words[1] = getRadixOrdered(row.mLogicalTime);
+}
+
 //typedef ConcurrentPriorityQueue<FsMutationRow, FsMutationRowComparator> CFSpq;
 typedef std::vector<FsMutationRow> Fmq;
 typedef ConcurrentQueue<FsMutationRow> CFSq;
-typedef boost::heap::priority_queue<FsMutationRow, boost::heap::compare<FsMutationRowComparator> > FSpq;
 typedef std::vector<FsMutationPK> FPK;
 
 typedef std::vector<FsMutationRow> FSv;
 typedef boost::unordered_map<Uint64, FSv* > FsMutationRowsByGCI;
 typedef boost::tuple<std::vector<Uint64>*, FsMutationRowsByGCI* > FsMutationRowsGCITuple;
 
+template<>
+struct WatchRowKey<FsMutationRow> {
+  typedef FsMutationLogKey Type;
+
+  static Type get(DBWatchTable<FsMutationRow>*, FsMutationRow row) {
+    return row.getPK().getKey();
+  }
+};
+
 class FsMutationsLogTable : public DBWatchTable<FsMutationRow> {
 public:
   struct FSLogHandler : public LogHandler{
     FsMutationPK mPK;
 
-    FSLogHandler(FsMutationPK pk) : mPK(pk) {}
+    FSLogHandler(FsMutationPK pk, Uint64 epoch) : LogHandler(epoch), mPK(pk) {}
     void removeLog(Ndb* connection) const override {
       FsMutationsLogTable().removeLog(connection, mPK);
     }
@@ -241,9 +298,10 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_INSERT);
   }
 
-  FsMutationRow getRow(NdbRecAttr* value[]) {
+  FsMutationRow getRow(const RowValues& value) {
     FsMutationRow row;
     row.mEventCreationTime = Utils::getCurrentTime();
+    row.mEpoch = 0;
     row.mDatasetINodeId = value[0]->int64_value();
     row.mInodeId = value[1]->int64_value();
     row.mLogicalTime = value[2]->int32_value();
@@ -257,22 +315,39 @@ public:
     return row;
   }
 
-  void removeLogs(Ndb* connection, std::vector<const LogHandler*>& logrh) {
-    try{
-      removeLogsOneTransaction(connection, logrh);
-    }catch(NdbTupleDidNotExist& e){
-      removeLogsMultiTransactions(connection, logrh);
+  /*
+   * removes the fs logs in one transaction, returns the number of log rows
+   * that were already deleted.
+   */
+  int removeLogs(Ndb* connection, std::vector<const LogHandler*>& logrh) {
+    bool started = false;
+    for (auto log : logrh) {
+      if(log == nullptr){
+        continue;
+      }
+      if(log->getType() != LogType::FSLOG){
+        continue;
+      }
+
+      const FSLogHandler* fslog = static_cast<const FSLogHandler*>
+          (log);
+      if(!started){
+        start(connection);
+        started = true;
+      }
+
+      FsMutationPK pk = fslog->mPK;
+      doDelete(pk.getKey());
+      LOG_DEBUG("Delete log row: Dataset[" << pk.mDatasetINodeId << "], INode["
+              << pk.mInodeId << "], Timestamp[" << pk.mLogicalTime << "]");
     }
+    return started ? endIgnoreMissing() : 0;
   }
 
   void removeLog(Ndb* connection, FsMutationPK pk) {
     try{
       start(connection);
-      AnyMap a;
-      a[0] = pk.mDatasetINodeId;
-      a[1] = pk.mInodeId;
-      a[2] = pk.mLogicalTime;
-      doDelete(a);
+      doDelete(pk.getKey());
       LOG_DEBUG("Delete log row: Dataset[" << pk.mDatasetINodeId << "], INode["
                                            << pk.mInodeId << "], Timestamp[" << pk.mLogicalTime << "]");
       end();
@@ -287,49 +362,37 @@ public:
   }
 
   LogHandler* getLogRemovalHandler(FsMutationRow row) override {
-    return new FSLogHandler(row.getPK());
+    return new FSLogHandler(row.getPK(), row.mEpoch);
   }
-private:
 
-  void removeLogsOneTransaction(Ndb* connection, std::vector<const LogHandler*>& logrh) {
-    start(connection);
-    for (auto log : logrh) {
-      if(log == nullptr){
-        continue;
-      }
-      if(log->getType() != LogType::FSLOG){
-        continue;
-      }
-
-      const FSLogHandler* fslog = static_cast<const FSLogHandler*>
-          (log);
-
-      FsMutationPK pk = fslog->mPK;
-      AnyMap a;
-      a[0] = pk.mDatasetINodeId;
-      a[1] = pk.mInodeId;
-      a[2] = pk.mLogicalTime;
-      doDelete(a);
-      LOG_DEBUG("Delete log row: Dataset[" << pk.mDatasetINodeId << "], INode["
-              << pk.mInodeId << "], Timestamp[" << pk.mLogicalTime << "]");
-    }
-    end();
+  void writeRow(EventRecordWriter& writer, FsMutationRow row) override {
+    writer.putInt(row.mDatasetINodeId);
+    writer.putInt(row.mInodeId);
+    writer.putInt(row.mLogicalTime);
+    writer.putInt(row.mPk1);
+    writer.putInt(row.mPk2);
+    writer.putString(row.mPk3);
+    writer.putInt(row.mOperation);
+    writer.putInt(row.mInodePartitionId);
+    writer.putInt(row.mInodeParentId);
+    writer.putString(row.mInodeName);
   }
 
-  void removeLogsMultiTransactions(Ndb* connection, std::vector<const LogHandler*>& logrh) {
-    for (auto log : logrh) {
-      if(log == nullptr){
-        continue;
-      }
-      if(log->getType() != LogType::FSLOG){
-        continue;
-      }
-
-      const FSLogHandler* fslog = static_cast<const FSLogHandler*>
-          (log);
-
-      removeLog(connection, fslog->mPK);
-    }
+  FsMutationRow readRow(EventRecordReader& reader) override {
+    FsMutationRow row;
+    row.mEventCreationTime = Utils::getCurrentTime();
+    row.mEpoch = 0;
+    row.mDatasetINodeId = reader.getInt();
+    row.mInodeId = reader.getInt();
+    row.mLogicalTime = reader.getInt();
+    row.mPk1 = reader.getInt();
+    row.mPk2 = reader.getInt();
+    row.mPk3 = reader.getString();
+    row.mOperation = static_cast<FsOpType> (reader.getInt());
+    row.mInodePartitionId = reader.getInt();
+    row.mInodeParentId = reader.getInt();
+    row.mInodeName = reader.getString();
+    return row;
   }
 };
 
@@ -49,7 +49,7 @@ public:
     GroupsCache::getInstance(lru_cap, "Group");
   }
 
-  GroupRow getRow(NdbRecAttr* values[]) {
+  GroupRow getRow(const RowValues& values) {
     GroupRow row;
     row.mId = values[0]->int32_value();
     row.mName = get_string(values[1]);
@@ -80,6 +80,15 @@ struct HopsworksOpRow {
   }
 };
 
+template<>
+struct WatchRowKey<HopsworksOpRow> {
+  typedef int Type;
+
+  static Type get(DBWatchTable<HopsworksOpRow>*, HopsworksOpRow row) {
+    return row.mId;
+  }
+};
+
 class HopsworksOpsLogTable : public DBWatchTable<HopsworksOpRow> {
 public:
   struct HopsworksLogHandler : public LogHandler{
@@ -112,7 +121,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_INSERT);
   }
 
-  HopsworksOpRow getRow(NdbRecAttr* value[]) {
+  HopsworksOpRow getRow(const RowValues& value) {
     HopsworksOpRow row;
     row.mId = value[0]->int32_value();
     //op_id is the dataset_id or project_id depending on the operation type
@@ -125,12 +134,30 @@ public:
     return row;
   }
 
-  void removeLogs(Ndb* connection, std::vector<const LogHandler*>& logrh) {
-    try{
-      removeLogsOneTransaction(connection, logrh);
-    }catch(NdbTupleDidNotExist& e){
-      removeLogsMultiTransactions(connection, logrh);
+  /*
+   * removes the hopsworks logs in one transaction, returns the number of log
+   * rows that were already deleted.
+   */
+  int removeLogs(Ndb* connection, std::vector<const LogHandler*>& logrh) {
+    bool started = false;
+    for (auto log : logrh){
+      if (log == nullptr){
+        continue;
+      }
+      if (log->getType() != LogType::HOPSWORKSLOG){
+        continue;
+      }
+
+      const HopsworksLogHandler *hopsworksLogHandler = static_cast<const HopsworksLogHandler *>(log);
+      if (!started){
+        start(connection);
+        started = true;
+      }
+
+      doDelete(hopsworksLogHandler->mPK);
+      LOG_DEBUG("Delete log row " << hopsworksLogHandler->mPK);
     }
+    return started ? endIgnoreMissing() : 0;
   }
 
   void removeLog(Ndb* conn, int pk) {
@@ -152,39 +179,27 @@ public:
     return new HopsworksLogHandler(row.mId);
   }
 
-private:
-  void removeLogsOneTransaction(Ndb *connection, std::vector<const LogHandler *> &logrh){
-    start(connection);
-    for (auto log : logrh){
-      if (log == nullptr){
-        continue;
-      }
-      if (log->getType() != LogType::HOPSWORKSLOG){
-        continue;
-      }
-
-      const HopsworksLogHandler *hopsworksLogHandler = static_cast<const HopsworksLogHandler *>(log);
-
-      doDelete(hopsworksLogHandler->mPK);
-      LOG_DEBUG("Delete log row " << hopsworksLogHandler->mPK);
-    }
-    end();
+  void writeRow(EventRecordWriter& writer, HopsworksOpRow row) override {
+    writer.putInt(row.mId);
+    writer.putInt(row.mOpId);
+    writer.putInt(row.mOpOn);
+    writer.putInt(row.mOpType);
+    writer.putInt(row.mProjectId);
+    writer.putInt(row.mDatasetINodeId);
+    writer.putInt(row.mInodeId);
   }
 
-  void removeLogsMultiTransactions(Ndb *connection, std::vector<const LogHandler *>& logrh){
-    for (auto log : logrh){
-      if (log == nullptr){
-        continue;
-      }
-      if (log->getType() != LogType::HOPSWORKSLOG){
-        continue;
-      }
-
-      const HopsworksLogHandler *hopsworksLogHandler = static_cast<const HopsworksLogHandler *>(log);
-      removeLog(connection, hopsworksLogHandler->mPK);
-    }
+  HopsworksOpRow readRow(EventRecordReader& reader) override {
+    HopsworksOpRow row;
+    row.mId = reader.getInt();
+    row.mOpId = reader.getInt();
+    row.mOpOn = static_cast<OpsLogOn> (reader.getInt());
+    row.mOpType = static_cast<HopsworksOpType> (reader.getInt());
+    row.mProjectId = reader.getInt();
+    row.mDatasetINodeId = reader.getInt();
+    row.mInodeId = reader.getInt();
+    return row;
   }
-
 };
 
 #endif /* HOPSWORKSOPSLOGTABLE_H */
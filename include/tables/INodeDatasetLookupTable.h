@@ -37,7 +37,7 @@ public:
     addColumn("dataset_id");
   }
 
-  INodeDatasetLookupRow getRow(NdbRecAttr* values[]) {
+  INodeDatasetLookupRow getRow(const RowValues& values) {
     INodeDatasetLookupRow row;
     row.mInodeId = values[0]->int64_value();
     row.mDatasetINodeId = values[1]->int64_value();
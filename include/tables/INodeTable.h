@@ -200,6 +200,13 @@ struct INodeRow {
     return out.str();
   }
   
+  /*
+   * number of bulk actions written by to_delete_change_dataset_json
+   */
+  static Uint32 delete_change_dataset_items(FsMutationRow row){
+    return row.mOperation == FsDelete || row.mOperation == FsChangeDataset ? 1 : 0;
+  }
+
   static std::string to_delete_change_dataset_json(std::string index, FsMutationRow row){
     if(row.mOperation == FsDelete){
       return to_delete_json(index, row.mInodeId);
@@ -212,6 +219,8 @@ struct INodeRow {
 
 typedef boost::unordered_map<Int64, INodeRow> INodeMap;
 typedef std::vector<INodeRow> INodeVec;
+typedef TableKey<KeyColumn<0, Int64>, KeyColumn<1, std::string>, KeyColumn<2, Int64> > INodePK;
+typedef std::vector<INodePK> INodePKs;
 
 class INodeTable : public DBTable<INodeRow> {
 public:
@@ -231,7 +240,7 @@ public:
     addColumn("num_sys_xattrs");
   }
 
-  INodeRow getRow(NdbRecAttr* values[]) {
+  INodeRow getRow(const RowValues& values) {
     INodeRow row;
     row.mParentId = values[0]->int64_value();
     row.mName = get_string(values[1]);
@@ -262,6 +271,28 @@ public:
     return results;
   }
 
+  /*
+   * the children of many directories with one multi-range scan, the result
+   * i holds the children of parentIds[i] whose partition id is their parent
+   */
+  std::vector<INodeVec> getByParentIds(Ndb* connection, LVec& parentIds){
+    AnyVec ranges;
+    for(LVec::iterator it = parentIds.begin(); it != parentIds.end(); ++it){
+      AnyMap key;
+      key[0] = *it;
+      key[2] = *it;
+      ranges.push_back(key);
+    }
+    std::vector<INodeVec> inodesByParent = doReadRanges(connection, "c1", ranges);
+    for(auto& inodes : inodesByParent){
+      for(INodeVec::iterator it = inodes.begin(); it != inodes.end(); ++it){
+        it->mUserName = mUsersTable.get(connection, it->mUserId).mName;
+        it->mGroupName = mGroupsTable.get(connection, it->mGroupId).mName;
+      }
+    }
+    return inodesByParent;
+  }
+
   // This method should be avoid as much as possible since it triggers an index scan
   INodeRow getByInodeId(Ndb* connection, Int64 inodeId) {
     AnyMap key;
@@ -284,21 +315,54 @@ public:
   }
   
   INodeRow get(Ndb* connection, Int64 parentId, std::string name, Int64 partitionId) {
-    AnyMap a;
-    a[0] = parentId;
-    a[1] = name;
-    a[2] = partitionId;
-    return DBTable<INodeRow>::doRead(connection, a);
+    return DBTable<INodeRow>::doRead(connection, INodePK(parentId, name, partitionId));
   }
 
-  INodeVec get(Ndb* connection, AnyVec& pks){
+  INodeVec get(Ndb* connection, const INodePKs& pks){
     INodeVec inodes = doRead(connection, pks);
     return inodes;
   }
 
+  bool prepareGet(Ndb* connection, const INodePKs& pks, AsyncRead* read){
+    return prepareRead(connection, pks, read);
+  }
+
+  INodeVec completeGet(AsyncRead* read){
+    return completeRead(read);
+  }
+
   INodeMap get(Ndb* connection, Fmq* data_batch) {
-    AnyVec anyVec;
-    boost::unordered_map<Int64, FsMutationRow> mutationsByInode;
+    FsMutationsByINode mutationsByInode;
+    INodePKs pks = getPKs(data_batch, mutationsByInode);
+    INodeVec inodes = doRead(connection, pks);
+    return toINodeMap(connection, inodes, mutationsByInode);
+  }
+
+  bool prepareGet(Ndb* connection, Fmq* data_batch, AsyncRead* read) {
+    FsMutationsByINode mutationsByInode;
+    INodePKs pks = getPKs(data_batch, mutationsByInode);
+    return prepareRead(connection, pks, read);
+  }
+
+  INodeMap completeGet(Ndb* connection, Fmq* data_batch, AsyncRead* read) {
+    FsMutationsByINode mutationsByInode;
+    getPKs(data_batch, mutationsByInode);
+    INodeVec inodes = completeRead(read);
+    return toINodeMap(connection, inodes, mutationsByInode);
+  }
+
+  INodeRow currRow(Ndb* connection) {
+    INodeRow row = DBTable<INodeRow>::currRow();
+    row.mUserName = mUsersTable.get(connection, row.mUserId).mName;
+    row.mGroupName = mGroupsTable.get(connection, row.mGroupId).mName;
+    return row;
+  }
+
+private:
+  typedef boost::unordered_map<Int64, FsMutationRow> FsMutationsByINode;
+
+  INodePKs getPKs(Fmq* data_batch, FsMutationsByINode& mutationsByInode) {
+    INodePKs pks;
     for (Fmq::iterator it = data_batch->begin(); it != data_batch->end(); ++it) {
       FsMutationRow row = *it;
       if (!row.requiresReadingINode() || !row.isINodeOperation()) {
@@ -306,15 +370,13 @@ public:
       }
       mutationsByInode[row.mInodeId] = row;
 
-      AnyMap pk;
-      pk[0] = row.getParentId();
-      pk[1] = row.getINodeName();
-      pk[2] = row.getPartitionId();
-      anyVec.push_back(pk);
+      pks.push_back(INodePK(row.getParentId(), row.getINodeName(),
+          row.getPartitionId()));
     }
+    return pks;
+  }
 
-    INodeVec inodes = doRead(connection, anyVec);
-
+  INodeMap toINodeMap(Ndb* connection, INodeVec& inodes, FsMutationsByINode& mutationsByInode) {
     UISet user_ids, group_ids;
     for (INodeVec::iterator it = inodes.begin(); it != inodes.end(); ++it) {
       INodeRow row = *it;
@@ -339,14 +401,6 @@ public:
     return result;
   }
 
-  INodeRow currRow(Ndb* connection) {
-    INodeRow row = DBTable<INodeRow>::currRow();
-    row.mUserName = mUsersTable.get(connection, row.mUserId).mName;
-    row.mGroupName = mGroupsTable.get(connection, row.mGroupId).mName;
-    return row;
-  }
-
-private:
   UserTable mUsersTable;
   GroupTable mGroupsTable;
 
@@ -129,7 +129,7 @@ public:
     return row;
   }
 
-  ProjectRow getRow(NdbRecAttr* values[]) {
+  ProjectRow getRow(const RowValues& values) {
     ProjectRow row;
     row.mId = values[0]->int32_value();
     row.mInodeParentId = values[1]->int64_value();
@@ -0,0 +1,84 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+#ifndef TABLEKEY_H
+#define TABLEKEY_H
+
+#include <tuple>
+#include <utility>
+#include <boost/functional/hash.hpp>
+
+/*
+ * A key column of a table schema, Col is the index of the column in the
+ * table columns and T the type the key is bound with.
+ */
+template<unsigned int Col, typename T>
+struct KeyColumn {
+  static const unsigned int column = Col;
+  typedef T type;
+};
+
+/*
+ * A strongly typed key of a table, the columns and their types are part of
+ * the key type so that the values are handed to the table binder in order
+ * without any boost::any dispatching.
+ */
+template<typename... Columns>
+struct TableKey {
+  typedef std::tuple<typename Columns::type...> Values;
+
+  Values mValues;
+
+  TableKey() {
+  }
+
+  TableKey(const typename Columns::type&... values) : mValues(values...) {
+  }
+
+  template<typename Binder>
+  void bind(Binder& binder) const {
+    bindColumns(binder, std::index_sequence_for<Columns...>());
+  }
+
+  bool operator==(const TableKey& other) const {
+    return mValues == other.mValues;
+  }
+
+  friend std::size_t hash_value(const TableKey& key) {
+    std::size_t seed = 0;
+    key.hashColumns(seed, std::index_sequence_for<Columns...>());
+    return seed;
+  }
+
+private:
+  template<typename Binder, size_t... I>
+  void bindColumns(Binder& binder, std::index_sequence<I...>) const {
+    int expand[] = {0, (binder.bind(Columns::column, std::get<I>(mValues)), 0)...};
+    (void) expand;
+  }
+
+  template<size_t... I>
+  void hashColumns(std::size_t& seed, std::index_sequence<I...>) const {
+    int expand[] = {0, (boost::hash_combine(seed, std::get<I>(mValues)), 0)...};
+    (void) expand;
+  }
+};
+
+#endif /* TABLEKEY_H */
@@ -49,7 +49,7 @@ public:
     UsersCache::getInstance(lru_cap, "User");
   }
 
-  UserRow getRow(NdbRecAttr* values[]) {
+  UserRow getRow(const RowValues& values) {
     UserRow row;
     row.mId = values[0]->int32_value();
     row.mName = get_string(values[1]);
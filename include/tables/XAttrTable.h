@@ -24,6 +24,10 @@
 
 #define XATTR_FIELD_NAME "xattr"
 
+typedef TableKey<KeyColumn<0, Int64>, KeyColumn<1, Int8>, KeyColumn<2, std::string>,
+    KeyColumn<3, Int16> > XAttrPK;
+typedef std::vector<XAttrPK> XAttrPKs;
+
 struct XAttrPartKey {
   Int64 mInodeId;
   Int8 mNamespace;
@@ -41,13 +45,8 @@ struct XAttrPartKey {
     return pk.mInodeId == mInodeId && pk.mNamespace == mNamespace && pk.mName == mName && pk.mIndex == mIndex;
   }
 
-  AnyMap getAnyKey() {
-    AnyMap pk;
-    pk[0] = mInodeId;
-    pk[1] = mNamespace;
-    pk[2] = mName;
-    pk[3] = mIndex;
-    return pk;
+  XAttrPK getKey() const {
+    return XAttrPK(mInodeId, mNamespace, mName, mIndex);
   }
 };
 
@@ -118,6 +117,13 @@ struct XAttrRow {
     mValue = value;
   }
 
+  /*
+   * number of bulk actions written by to_upsert_json
+   */
+  static Uint32 upsert_items(FsOpType operation){
+    return operation == XAttrUpdate ? 2 : 1;
+  }
+
   std::string to_upsert_json(std::string index, FsOpType operation){
     std::stringstream out;
     if(operation == XAttrUpdate){
@@ -308,7 +314,7 @@ public:
     addColumn("num_parts");
   }
 
-  XAttrRowPart getRow(NdbRecAttr* values[]) {
+  XAttrRowPart getRow(const RowValues& values) {
     XAttrRowPart row;
     row.mInodeId = values[0]->int64_value();
     row.mNamespace = values[1]->int8_value();
@@ -320,29 +326,19 @@ public:
   }
 
   XAttrRow get(Ndb* connection, Int64 inodeId, Int8 ns, std::string name) {
-    AnyMap a;
-    a[0] = inodeId;
-    a[1] = ns;
-    a[2] = name;
-    a[3] = static_cast<Int16>(0);
-
-    XAttrRowPart firstPart = DBTable<XAttrRowPart>::doRead(connection, a);
+    XAttrRowPart firstPart = DBTable<XAttrRowPart>::doRead(connection,
+        XAttrPK(inodeId, ns, name, 0));
     LOG_DEBUG("XAttr get by parts " << firstPart.mNumParts);
     if(firstPart.mNumParts == 1){
       return XAttrRow(firstPart);
     }
 
-    AnyVec anyVec;
+    XAttrPKs pks;
     for(Int16 index=1; index < firstPart.mNumParts; index++){
-        AnyMap pk;
-        pk[0] = inodeId;
-        pk[1] = ns;
-        pk[2] = name;
-        pk[3] = index;
-        anyVec.push_back(pk);
+        pks.push_back(XAttrPK(inodeId, ns, name, index));
     }
     
-    XAttrPartVec restOfParts = doRead(connection, anyVec);
+    XAttrPartVec restOfParts = doRead(connection, pks);
     LOG_DEBUG("XAttr batch read the rest of parts " << restOfParts.size());
     return XAttrRow(firstPart, restOfParts);
   }
@@ -351,7 +347,7 @@ public:
     Fmq batchedMutations;
     Fmq addAllXattrs;
 
-    AnyVec anyVec;
+    XAttrPKs pks;
     XAttrPartKeyVec xattrPartKeyVec;
     for (Fmq::iterator it = data_batch->begin(); it != data_batch->end(); ++it) {
       FsMutationRow row = *it;
@@ -363,10 +359,10 @@ public:
         continue;
       }
 
-      addRetryKeys(row.mInodeId, row.getNamespace(), row.getXAttrName(), row.getNumParts(), anyVec, xattrPartKeyVec);
+      addRetryKeys(row.mInodeId, row.getNamespace(), row.getXAttrName(), row.getNumParts(), pks, xattrPartKeyVec);
       batchedMutations.push_back(row);
     }
-    std::pair<AnyVec, XAttrPartKeyVec> xAttrKeys = std::make_pair(anyVec, xattrPartKeyVec);
+    std::pair<XAttrPKs, XAttrPartKeyVec> xAttrKeys = std::make_pair(pks, xattrPartKeyVec);
     XAttrMap xattrs;
     int retry = 0;
     while(!xAttrKeys.first.empty()) {
@@ -378,9 +374,13 @@ public:
       retry++;
     }
 
+    LVec inodeIds;
     for(Fmq::iterator it = addAllXattrs.begin(); it != addAllXattrs.end(); ++it){
-      FsMutationRow mr = *it;
-      xattrs[mr.getPKStr()] = getByInodeId(connection, mr.mInodeId);
+      inodeIds.push_back(it->mInodeId);
+    }
+    std::vector<XAttrVec> xattrsByInode = getByInodeIds(connection, inodeIds);
+    for(size_t i = 0; i < addAllXattrs.size(); i++){
+      xattrs[addAllXattrs[i].getPKStr()] = xattrsByInode[i];
     }
 
     return xattrs;
@@ -393,6 +393,21 @@ public:
     return combine(xattrsParts);
   }
 
+  std::vector<XAttrVec> getByInodeIds(Ndb* connection, LVec& inodeIds){
+    AnyVec ranges;
+    for(LVec::iterator it = inodeIds.begin(); it != inodeIds.end(); ++it){
+      AnyMap args;
+      args[0] = *it;
+      ranges.push_back(args);
+    }
+    std::vector<XAttrPartVec> partsByInode = doReadRanges(connection, PRIMARY_INDEX, ranges);
+    std::vector<XAttrVec> results;
+    for(auto& parts : partsByInode){
+      results.push_back(combine(parts));
+    }
+    return results;
+  }
+
   boost::optional<XAttrRow> get(Ndb* connection, XAttrPartKey key) {
     XAttrRow row = get(connection, key.mInodeId, key.mNamespace, key.mName);
     if(readCheckExists(key, row)) {
@@ -432,7 +447,7 @@ private:
     return results;
   }
 
-  void addRetryKeys(Int64 inodeId, Int8 ns, std::string name, Int16 numParts, AnyVec& anyVec, XAttrPartKeyVec& keys) {
+  void addRetryKeys(Int64 inodeId, Int8 ns, std::string name, Int16 numParts, XAttrPKs& pks, XAttrPartKeyVec& keys) {
     LOG_DEBUG("doRead batch for XAttr [ " + name + " ] to get its " << numParts << " parts ");
     XAttrPartKey key(inodeId, ns, name, 0);
     /** There might be multiple operations using the same XAttr. No use getting it multiple times from the db. */
@@ -440,17 +455,17 @@ private:
       for (Int16 index = 0; index < numParts; index++) {
         XAttrPartKey pkey(inodeId, ns, name, index);
         keys.push_back(pkey);
-        anyVec.push_back(pkey.getAnyKey());
+        pks.push_back(pkey.getKey());
       }
     }
   }
 
   /** This handles a key batch read, so entries in partVec might have junk - filter them */
-  std::pair<AnyVec, XAttrPartKeyVec> combineBatch(XAttrPartVec& partVec, XAttrMap& xattrs, Fmq& xAttrMutations, std::pair<AnyVec, XAttrPartKeyVec> keys){
+  std::pair<XAttrPKs, XAttrPartKeyVec> combineBatch(XAttrPartVec& partVec, XAttrMap& xattrs, Fmq& xAttrMutations, std::pair<XAttrPKs, XAttrPartKeyVec> keys){
     XAttrPartMap xAttrsByName;
     convertBatch(partVec, xAttrsByName, keys.second);
     XAttrPartKeyVec retryPartKeyVec;
-    AnyVec anyVec;
+    XAttrPKs pks;
     for(auto& m : xAttrMutations) {
       XAttrPartKey key(m.mInodeId, m.getNamespace(), m.getXAttrName(), 0);
       if(std::find(std::begin(keys.second), std::end(keys.second), key) == std::end(keys.second)) {
@@ -473,10 +488,10 @@ private:
         xvec.push_back(XAttrRow(actualVec));
         xattrs[m.getPKStr()] = xvec;
       } else {
-        addRetryKeys(vec[0].mInodeId, vec[0].mNamespace, vec[0].mName, vec[0].mNumParts, anyVec, retryPartKeyVec);
+        addRetryKeys(vec[0].mInodeId, vec[0].mNamespace, vec[0].mName, vec[0].mNumParts, pks, retryPartKeyVec);
       }
     }
-    std::pair<AnyVec, XAttrPartKeyVec> retryKeys = std::make_pair(anyVec, retryPartKeyVec);
+    std::pair<XAttrPKs, XAttrPartKeyVec> retryKeys = std::make_pair(pks, retryPartKeyVec);
     return retryKeys;
   }
 
@@ -34,7 +34,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  CDSRow getRow(NdbRecAttr *value[]) {
+  CDSRow getRow(const RowValues& value) {
     CDSRow row;
     row.mCDID = value[0]->int64_value();
     return row;
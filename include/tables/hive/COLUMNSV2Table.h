@@ -33,7 +33,7 @@ public:
     addColumn("CD_ID");
   }
 
-  COLUMNSV2Row getRow(NdbRecAttr *value[]) {
+  COLUMNSV2Row getRow(const RowValues& value) {
     COLUMNSV2Row row;
     row.mCDID = value[0]->int64_value();
     return row;
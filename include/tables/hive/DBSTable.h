@@ -35,7 +35,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  DBSRow getRow(NdbRecAttr* value[]){
+  DBSRow getRow(const RowValues& value){
     DBSRow row;
     row.mDBID = value[0]->int64_value();
     return row;
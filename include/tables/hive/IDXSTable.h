@@ -35,7 +35,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  IDXSRow getRow(NdbRecAttr *value[]){
+  IDXSRow getRow(const RowValues& value){
     IDXSRow row;
     row.mINDEXID = value[0]->int64_value();
     row.mSDID = value[1]->int64_value();
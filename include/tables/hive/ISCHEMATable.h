@@ -35,7 +35,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  ISCHEMARow getRow(NdbRecAttr* value[]){
+  ISCHEMARow getRow(const RowValues& value){
     ISCHEMARow row;
     row.mSCHEMAID = value[0]->int64_value();
     return row;
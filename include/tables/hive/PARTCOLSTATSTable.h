@@ -33,7 +33,7 @@ public:
     addColumn("PART_ID");
   }
 
-  PARTCOLSTATSRow getRow(NdbRecAttr *value[]) {
+  PARTCOLSTATSRow getRow(const RowValues& value) {
     PARTCOLSTATSRow row;
     row.mPARTID = value[0]->int64_value();
     return row;
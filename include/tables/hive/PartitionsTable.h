@@ -35,7 +35,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  PartitionsRow getRow(NdbRecAttr *value[]){
+  PartitionsRow getRow(const RowValues& value){
     PartitionsRow row;
     row.mPARTID = value[0]->int64_value();
     row.mSDID = value[1]->int64_value();
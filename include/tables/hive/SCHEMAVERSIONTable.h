@@ -37,7 +37,7 @@ public:
     addColumn("CD_ID");
   }
 
-  SCHEMAVERSIONRow getRow(NdbRecAttr *value[]) {
+  SCHEMAVERSIONRow getRow(const RowValues& value) {
     SCHEMAVERSIONRow row;
     row.mSCHEMAID = value[0]->int64_value();
     row.mSERDEID = value[1]->int64_value();
@@ -33,7 +33,7 @@ public:
     addColumn("SD_ID");
   }
 
-  SDPARAMSRow getRow(NdbRecAttr *value[]) {
+  SDPARAMSRow getRow(const RowValues& value) {
     SDPARAMSRow row;
     row.mSDID = value[0]->int64_value();
     return row;
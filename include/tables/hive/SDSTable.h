@@ -39,7 +39,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  SDSRow getRow(NdbRecAttr* value[]){
+  SDSRow getRow(const RowValues& value){
     SDSRow row;
     row.mSDID = value[0]->int64_value();
     row.mCDID = value[1]->int64_value();
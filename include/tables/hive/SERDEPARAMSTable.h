@@ -33,7 +33,7 @@ public:
     addColumn("SERDE_ID");
   }
 
-  SERDEPARAMSRow getRow(NdbRecAttr *value[]) {
+  SERDEPARAMSRow getRow(const RowValues& value) {
     SERDEPARAMSRow row;
     row.mSERDEID = value[0]->int64_value();
     return row;
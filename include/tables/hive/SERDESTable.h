@@ -34,7 +34,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  SERDESRow getRow(NdbRecAttr* value[]){
+  SERDESRow getRow(const RowValues& value){
     SERDESRow row;
     row.mSERDEID = value[0]->int64_value();
     return row;
@@ -35,7 +35,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  SkewedLocRow getRow(NdbRecAttr *value[]){
+  SkewedLocRow getRow(const RowValues& value){
     SkewedLocRow row;
     row.mSDID = value[0]->int64_value();
     row.mStringListID = value[1]->int64_value();
@@ -32,7 +32,7 @@ public:
     addColumn("STRING_LIST_ID");
   }
 
-  SkewedStringsRow getRow(NdbRecAttr *value[]) {
+  SkewedStringsRow getRow(const RowValues& value) {
     SkewedStringsRow row;
     row.mStringListID = value[0]->int64_value();
     return row;
@@ -36,7 +36,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  SkewedValuesRow getRow(NdbRecAttr *value[]) {
+  SkewedValuesRow getRow(const RowValues& value) {
     SkewedValuesRow row;
     row.mSDID = value[0]->int64_value();
     row.mIntegerIDX = value[1]->int32_value();
@@ -33,7 +33,7 @@ public:
     addColumn("TBL_ID");
   }
 
-  TABCOLSTATSRow getRow(NdbRecAttr *value[]) {
+  TABCOLSTATSRow getRow(const RowValues& value) {
     TABCOLSTATSRow row;
     row.mTBLID = value[0]->int64_value();
     return row;
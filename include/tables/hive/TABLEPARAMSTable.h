@@ -33,7 +33,7 @@ public:
     addColumn("TBL_ID");
   }
 
-  TABLEPARAMSRow getRow(NdbRecAttr *value[]) {
+  TABLEPARAMSRow getRow(const RowValues& value) {
     TABLEPARAMSRow row;
     row.mTBLID = value[0]->int64_value();
     return row;
@@ -40,7 +40,7 @@ public:
     addWatchEvent(NdbDictionary::Event::TE_DELETE);
   }
 
-  TBLSRow getRow(NdbRecAttr *value[]) {
+  TBLSRow getRow(const RowValues& value) {
     TBLSRow row;
     row.mTBLID = value[0]->int64_value();
     row.mSDID = value[1]->int64_value();
@@ -17,35 +17,63 @@
 #include "AppProvenanceElastic.h"
 
 AppProvenanceElastic::AppProvenanceElastic(const HttpClientConfig elastic_client_config, std::string index,
-        int time_to_wait_before_inserting, int bulk_size, const bool stats, SConn conn) : 
+        int time_to_wait_before_inserting, int bulk_size, int max_in_flight_batches, const bool stats, SConn conn) :
 ElasticSearchBase(elastic_client_config, time_to_wait_before_inserting,
-    bulk_size, stats, new MovingCountersBulkSet("app_prov")),
+    bulk_size, max_in_flight_batches, "app_prov", stats,
+    new MovingCountersBulkSet("app_prov")),
 mIndex(index), mConn(conn) {
   mElasticBulkAddr = getElasticSearchBulkUrl(mIndex);
 }
 
-void AppProvenanceElastic::process(std::vector<eBulk>* bulks) {
+bool AppProvenanceElastic::send(std::vector<eBulk>* bulks) {
+  HttpBufferChain batch;
+  for (auto it = bulks->begin(); it != bulks->end();++it) {
+    it->appendBuffers(batch);
+  }
+  ParsingResponse response = httpPostRequest(mElasticBulkAddr, batch);
+  if (!response.mSuccess) {
+    setBulkItemStatus(bulks, response);
+  }
+  return response.mSuccess;
+}
+
+void AppProvenanceElastic::acknowledge(std::vector<eBulk>* bulks, bool sent,
+    ptime start_time) {
   std::vector<const LogHandler*> logRHandlers;
-  std::string batch;
   for (auto it = bulks->begin(); it != bulks->end();++it) {
-    eBulk bulk = *it;
-    batch += bulk.batchJSON();
+    const eBulk& bulk = *it;
     logRHandlers.insert(logRHandlers.end(), bulk.mLogHandlers.begin(), bulk.mLogHandlers.end());
     if(mStats){
       mCounters->bulkReceived(bulk);
     }
   }
 
-  ptime start_time = Utils::getCurrentTime();
-  if (httpPostRequest(mElasticBulkAddr, batch).mSuccess) {
-    AppProvenanceLogTable().removeLogs(mConn, logRHandlers);
+  if (sent) {
+    cleanLogs(logRHandlers);
     if (mStats) {
       mCounters->bulksProcessed(start_time, bulks);
     }
   }else{
-    for (auto it = bulks->begin(); it != bulks->end();++it) {
-      eBulk bulk = *it;
-      for(eEvent event : bulk.mEvents){
+    //only the events with failed items are retried, the logs of the others
+    //are removed right away
+    std::vector<const LogHandler*> ackedHandlers;
+    for (eBulk& bulk : *bulks) {
+      for(eEvent& event : bulk.mEvents){
+        if(event.getItemStatus() == eEvent::ItemStatus::ItemSucceeded){
+          ackedHandlers.push_back(event.getLogHandler());
+        }
+      }
+    }
+    cleanLogs(ackedHandlers);
+
+    for (eBulk& bulk : *bulks) {
+      for(eEvent& event : bulk.mEvents){
+        if(event.getItemStatus() == eEvent::ItemStatus::ItemSucceeded){
+          continue;
+        }
+        if(event.getItemStatus() == eEvent::ItemStatus::ItemFailed){
+          LOG_WARN("app prov - retry failed bulk item (" << event.getItemError() << ")");
+        }
         if(!bulkRequest(event)){
           LOG_FATAL("app prov - elastic failure while processing log : "
           << event.getLogHandler()->getDescription() << std::endl << event.getJSON());
@@ -60,12 +88,16 @@ void AppProvenanceElastic::process(std::vector<eBulk>* bulks) {
 
 bool AppProvenanceElastic::bulkRequest(eEvent& event) {
   if (httpPostRequest(mElasticBulkAddr, event.getJSON()).mSuccess){
-    event.getLogHandler()->removeLog(mConn);
+    cleanLog(event.getLogHandler());
     return true;
   }
   return false;
 }
 
+int AppProvenanceElastic::removeLogs(std::vector<const LogHandler*>& handlers) {
+  return AppProvenanceLogTable().removeLogs(mConn, handlers);
+}
+
 AppProvenanceElastic::~AppProvenanceElastic() {
 }
 
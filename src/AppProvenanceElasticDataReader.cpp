@@ -17,7 +17,7 @@
 #include "AppProvenanceElasticDataReader.h"
 
 AppProvenanceElasticDataReader::AppProvenanceElasticDataReader(SConn connection, const bool hopsworks)
-: NdbDataReader(connection, hopsworks) {
+: NdbDataReader(connection, hopsworks, 1) {
 }
 
 class Helper {
@@ -99,14 +99,15 @@ public:
 };
 
 void AppProvenanceElasticDataReader::processAddedandDeleted(AppPq* data_batch, eBulk& bulk) {
-  std::stringstream out;
   for (AppPq::iterator it = data_batch->begin(); it != data_batch->end(); ++it) {
     AppProvenanceRow row = *it;
     std::list<std::string> result = Helper::process_row(row);
+    //every op is one update action with its source line
+    std::stringstream out;
     for(std::string op : result) {
       out << op << std::endl;
     }
-    bulk.push(mAppLogTable.getLogRemovalHandler(row), row.mEventCreationTime, out.str());
+    bulk.push(mAppLogTable.getLogRemovalHandler(row), row.mEventCreationTime, out.str(), result.size());
   }
 }
 
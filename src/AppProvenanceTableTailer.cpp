@@ -19,48 +19,41 @@
 AppProvenanceTableTailer::AppProvenanceTableTailer(Ndb *ndb, Ndb* ndbRecovery, const int poll_maxTimeToWait, const Barrier barrier)
 : RCTableTailer(ndb, ndbRecovery, new AppProvenanceLogTable(), poll_maxTimeToWait, barrier) {
   mQueue = new AppCPRq();
-  mCurrentPriorityQueue = new AppPRpq();
 }
 
 void AppProvenanceTableTailer::handleEvent(NdbDictionary::Event::TableEvent eventType, AppProvenanceRow pre,
         AppProvenanceRow row) {
-  mLock.lock();
-  mCurrentPriorityQueue->push(row);
-  int size = mCurrentPriorityQueue->size();
-  mLock.unlock();
+  row.mEpoch = getEventEpoch();
+  mCurrentRows.push_back(row);
+  queued(row);
 
-  LOG_TRACE("app prov - push provenance log for [" << row.mId << "] to queue[" << size << "]");
+  LOG_TRACE("app prov - push provenance log for [" << row.mId << "] to queue[" << mCurrentRows.size() << "]");
 
 }
 
 void AppProvenanceTableTailer::barrierChanged() {
-  AppPRpq* pq = NULL;
-  mLock.lock();
-  if (!mCurrentPriorityQueue->empty()) {
-    pq = mCurrentPriorityQueue;
-    mCurrentPriorityQueue = new AppPRpq();
-  }
-  mLock.unlock();
-
-  if (pq != NULL) {
-    LOG_TRACE("app prov --------------------------------------NEW BARRIER (" << pq->size() << " events )------------------- ");
-    pushToQueue(pq);
+  if (mCurrentRows.empty()) {
+    return;
   }
+  AppPq rows;
+  rows.swap(mCurrentRows);
+  LOG_TRACE("app prov --------------------------------------NEW BARRIER (" << rows.size() << " events )------------------- ");
+  std::stable_sort(rows.begin(), rows.end(), AppProvenanceRowComparator());
+  addToGroup(rows);
 }
 
 AppProvenanceRow AppProvenanceTableTailer::consume() {
   AppProvenanceRow row;
   mQueue->wait_and_pop(row);
+  dequeued(row);
   LOG_TRACE("app prov - pop appid [" << row.mId << "] from queue \n" << row.to_string());
   return row;
 }
 
-void AppProvenanceTableTailer::pushToQueue(AppPRpq *curr) {
-  while (!curr->empty()) {
-    mQueue->push(curr->top());
-    curr->pop();
+void AppProvenanceTableTailer::pushToQueue(AppPq& rows) {
+  for (AppProvenanceRow& row : rows) {
+    mQueue->push(std::move(row));
   }
-  delete curr;
 }
 
 AppProvenanceTableTailer::~AppProvenanceTableTailer() {
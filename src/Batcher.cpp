@@ -20,8 +20,9 @@
 #include "Batcher.h"
 
 Batcher::Batcher(const int time_to_wait, const int batch_size)
-: mBatchSize(batch_size), mTimerProcessing(false), mTimeToWait(time_to_wait),
-mStarted(false), mFirstTimer(true), mScheduleShutdown(false), mShutdownTimer(false) {
+: mBatchSize(batch_size), mTimeToWait(time_to_wait), mStarted(false),
+mScheduleShutdown(false), mTimerStopped(false),
+mTimer(BatchScheduler::getInstance().getIOService()) {
   srand(time(NULL));
 }
 
@@ -31,7 +32,14 @@ void Batcher::start() {
     return;
   }
 
-  startTimer();
+  // spread the first deadlines of the batchers
+  int baseTime = mTimeToWait / 4;
+  int timeout = rand() % (mTimeToWait - baseTime) + baseTime;
+  LOG_TRACE("fire the first timer after " << timeout << " msec");
+  BatchScheduler::getInstance().post(boost::bind(&Batcher::startTimer, this,
+      timeout));
+  BatchScheduler::getInstance().start();
+
   mThread = boost::thread(&Batcher::run, this);
   mStarted = true;
 }
@@ -39,7 +47,10 @@ void Batcher::start() {
 void Batcher::waitToFinish() {
   if (mStarted) {
     mThread.join();
-    mTimerThread.join();
+    boost::mutex::scoped_lock lock(mTimerLock);
+    while (!mTimerStopped) {
+      mTimerStoppedCond.wait(lock);
+    }
   }
 }
 
@@ -50,45 +61,37 @@ void Batcher::shutdown(){
   }
 }
 
-void Batcher::startTimer() {
-  LOG_DEBUG("start timer");
-  mTimerThread = boost::thread(&Batcher::timerThread, this);
-}
-
-void Batcher::timerThread() {
-  while (true) {
-    if(mShutdownTimer){
-      LOG_INFO("Shutdown batcher timer");
-      break;
-    }
-    mIOService.reset();
-    int timeout = mTimeToWait;
-    if (mFirstTimer) {
-      int baseTime = mTimeToWait / 4;
-      timeout = rand() % (mTimeToWait - baseTime) + baseTime;
-      mFirstTimer = false;
-      LOG_TRACE("fire the first timer after " << timeout << " msec");
-    }
-    boost::asio::deadline_timer timer(mIOService, boost::posix_time::milliseconds(timeout));
-    timer.async_wait(boost::bind(&Batcher::timerExpired, this, boost::asio::placeholders::error));
-    mIOService.run();
+void Batcher::startTimer(int timeout) {
+  if (mTimerStopped) {
+    return;
   }
+  // replacing the expiry time cancels the pending wait
+  mTimer.expires_from_now(boost::posix_time::milliseconds(timeout));
+  mTimer.async_wait(boost::bind(&Batcher::timerHandler, this,
+      boost::asio::placeholders::error));
 }
 
 void Batcher::resetTimer() {
-  mIOService.stop();
+  BatchScheduler::getInstance().post(boost::bind(&Batcher::startTimer, this,
+      getTimeToWait()));
 }
 
-void Batcher::timerExpired(const boost::system::error_code& e) {
-  if (e) return;
-  mTimerProcessing = true;
+void Batcher::timerExpired() {
   processBatch();
-  mTimerProcessing = false;
+}
+
+void Batcher::timerHandler(const boost::system::error_code& e) {
+  if (e) return;
+  timerExpired();
   if(mScheduleShutdown){
-    mShutdownTimer = true;
+    LOG_INFO("Shutdown batcher timer");
+    boost::mutex::scoped_lock lock(mTimerLock);
+    mTimerStopped = true;
+    mTimerStoppedCond.notify_all();
+    return;
   }
+  startTimer(getTimeToWait());
 }
 
 Batcher::~Batcher() {
 }
-
@@ -28,7 +28,7 @@ mHiveMetaDatabaseName(hive_meta_database_name) {
 
 Ndb* ClusterConnectionBase::create_ndb_connection(const char* database) {
   Ndb* ndb = new Ndb(mClusterConnection, database);
-  if (ndb->init() == -1) {
+  if (ndb->init(NDB_MAX_TRANSACTIONS) == -1) {
     LOG_NDB_API_FATAL(database, ndb->getNdbError());
   }
 
@@ -21,24 +21,27 @@
 
 ElasticSearchBase::ElasticSearchBase(const HttpClientConfig
 elastic_client_config, int time_to_wait_before_inserting, int bulk_size,
-const bool statsEnabled, MovingCountersSet* const
-metricsCounters) : TimedRestBatcher(elastic_client_config,
-    time_to_wait_before_inserting, bulk_size),  mStats
-    (statsEnabled), mCounters(metricsCounters), DEFAULT_TYPE("_doc") {
+int max_in_flight_batches, const std::string pipe_name, const bool statsEnabled,
+MovingCountersSet* const metricsCounters) : TimedRestBatcher(elastic_client_config,
+    time_to_wait_before_inserting, bulk_size, max_in_flight_batches, pipe_name),  mStats
+    (statsEnabled), mCounters(metricsCounters), DEFAULT_TYPE("_doc"),
+    BULK_FILTER("?filter_path=errors,error,items.*.status,items.*.error"),
+    mLogCleaner(pipe_name, this) {
+  mLogCleaner.start();
 }
 
 std::string ElasticSearchBase::getElasticSearchBulkUrl(std::string index) {
-  std::string str = "/" + index + "/" + DEFAULT_TYPE + "/_bulk";
+  std::string str = "/" + index + "/" + DEFAULT_TYPE + "/_bulk" + BULK_FILTER;
   return str;
 }
 
 std::string ElasticSearchBase::getElasticSearchBulkUrl() {
-  std::string str = "/_bulk";
+  std::string str = "/_bulk" + BULK_FILTER;
   return str;
 }
 
 ParsingResponse ElasticSearchBase::parseResponse(std::string response) {
-  ParsingResponse pr = {false, false, ""};
+  ParsingResponse pr = {false, false, "", {}, 0};
   try {
     LOG_DEBUG("ES Response: \n" << response);
     if(response == "Open Distro Security not initialized."){
@@ -46,52 +49,28 @@ ParsingResponse ElasticSearchBase::parseResponse(std::string response) {
       LOG_DEBUG("Retry the request until Open Distro Security is initialized");
       return pr;
     }
-    rapidjson::Document d;
-    if (!d.Parse<0>(response.c_str()).HasParseError()) {
-      if (d.HasMember("errors")) {
-        const rapidjson::Value &bulkErrors = d["errors"];
-        if (bulkErrors.IsBool() && bulkErrors.GetBool()) {
-          const rapidjson::Value &items = d["items"];
-          std::stringstream errors;
-          for (rapidjson::SizeType i = 0; i < items.Size(); ++i) {
-            const rapidjson::Value &obj = items[i];
-            for (rapidjson::Value::ConstMemberIterator itr = obj.MemberBegin(); itr != obj.MemberEnd(); ++itr) {
-              const rapidjson::Value & opObj = itr->value;
-              if (opObj.HasMember("error")) {
-                const rapidjson::Value & error = opObj["error"];
-                if (error.IsObject()) {
-                  const rapidjson::Value & errorType = error["type"];
-                  const rapidjson::Value & errorReason = error["reason"];
-                  errors << errorType.GetString() << ":" << errorReason.GetString();
-                } else if (error.IsString()) {
-                  errors << error.GetString();
-                }
-                errors << ", ";
-              }
-            }
-          }
-          std::string errorsStr = errors.str();
-          LOG_ERROR("ES got errors: " << errorsStr);
-          pr.errorMsg = errorsStr;
-          return pr;
-        }
-      } else if (d.HasMember("error")) {
-        const rapidjson::Value &error = d["error"];
-        if (error.IsObject()) {
-          const rapidjson::Value & errorType = error["type"];
-          const rapidjson::Value & errorReason = error["reason"];
-          LOG_ERROR(" ES got error: " << errorType.GetString() << ":" << errorReason.GetString());
-          std::stringstream errorS;
-          errorS << errorType.GetString() << ":" << errorReason.GetString();
-          pr.errorMsg = errorS.str();
-        } else if (error.IsString()) {
-          LOG_ERROR(" ES got error: " << error.GetString());
-          pr.errorMsg = error.GetString();
-        }
-        return pr;
+    BulkResponseHandler handler;
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(response.c_str());
+    if (reader.Parse(ss, handler).IsError()) {
+      LOG_ERROR(" ES got json error (" << reader.GetParseErrorCode()
+          << ") while parsing (" << response << ")");
+      return pr;
+    }
+    if (handler.hasErrors()) {
+      pr.mItemErrors.swap(handler.getItemErrors());
+      pr.mItems = handler.getItems();
+      std::stringstream errors;
+      for (BulkItemError& error : pr.mItemErrors) {
+        errors << error.mError << ", ";
       }
-    } else {
-      LOG_ERROR(" ES got json error (" << d.GetParseError() << ") while parsing (" << response << ")");
+      pr.errorMsg = errors.str();
+      LOG_ERROR("ES got errors for " << pr.mItemErrors.size() << " items: "
+          << pr.errorMsg);
+      return pr;
+    } else if (handler.hasError()) {
+      pr.errorMsg = handler.getError();
+      LOG_ERROR(" ES got error: " << pr.errorMsg);
       return pr;
     }
 
@@ -103,11 +82,29 @@ ParsingResponse ElasticSearchBase::parseResponse(std::string response) {
   return pr;
 }
 
+void ElasticSearchBase::cleanLogs(std::vector<const LogHandler*>& handlers) {
+  mLogCleaner.add(handlers);
+}
+
+void ElasticSearchBase::cleanLog(const LogHandler* handler) {
+  mLogCleaner.add(handler);
+}
+
+void ElasticSearchBase::drained() {
+  mLogCleaner.shutdown();
+}
+
 ElasticSearchBase::~ElasticSearchBase() {
 
 }
 
+void ElasticSearchBase::setCheckpoint(EpochCheckpoint* checkpoint) {
+  mLogCleaner.setCheckpoint(checkpoint);
+}
+
 std::string ElasticSearchBase::getMetrics(){
-  return mCounters->getMetrics(mCurrentQueueSize,
-      mElasticConnetionFailed, mTimeElasticConnectionFailed);
+  ptime failedSince;
+  bool failed = getElasticConnectionFailure(failedSince);
+  return mCounters->getMetrics(mCurrentQueueSize, failed, failedSince)
+      + mLogCleaner.getMetrics();
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+#include "EpochCheckpoint.h"
+#include <fstream>
+
+EpochCheckpoint::EpochCheckpoint(const std::string dir, const std::string table,
+    const LogType type) : mTable(table), mFile(dir + "/" + table + ".checkpoint"),
+    mType(type), mReleasedEpoch(0), mEpoch(0), mPersistedEpoch(0) {
+}
+
+Uint64 EpochCheckpoint::load() {
+  std::ifstream in(mFile.c_str());
+  Uint64 epoch = 0;
+  if (!in || !(in >> epoch)) {
+    LOG_INFO("no epoch checkpoint for " << mTable << " at " << mFile);
+    return 0;
+  }
+  LOG_INFO(mTable << " rows up to epoch " << epoch << " were already removed"
+      << " according to " << mFile);
+  boost::mutex::scoped_lock lock(mLock);
+  mReleasedEpoch = std::max(mReleasedEpoch, epoch);
+  mEpoch = std::max(mEpoch, epoch);
+  mPersistedEpoch = mEpoch;
+  return epoch;
+}
+
+void EpochCheckpoint::released(const std::map<Uint64, Uint64>& rows) {
+  if (rows.empty()) {
+    return;
+  }
+  boost::mutex::scoped_lock lock(mLock);
+  for (const std::pair<const Uint64, Uint64>& epoch : rows) {
+    mOutstanding[epoch.first] += epoch.second;
+  }
+  mReleasedEpoch = std::max(mReleasedEpoch, rows.rbegin()->first);
+}
+
+void EpochCheckpoint::removed(const std::vector<const LogHandler*>& handlers) {
+  boost::mutex::scoped_lock lock(mLock);
+  for (const LogHandler* handler : handlers) {
+    if (handler->getType() != mType) {
+      continue;
+    }
+    std::map<Uint64, Uint64>::iterator it = mOutstanding.find(handler->mEpoch);
+    if (it == mOutstanding.end()) {
+      continue;
+    }
+    if (--it->second == 0) {
+      mOutstanding.erase(it);
+    }
+  }
+  advance();
+}
+
+void EpochCheckpoint::advance() {
+  Uint64 epoch = mReleasedEpoch;
+  if (!mOutstanding.empty()) {
+    epoch = std::min(epoch, mOutstanding.begin()->first - 1);
+  }
+  mEpoch = std::max(mEpoch, epoch);
+}
+
+void EpochCheckpoint::persist(bool force) {
+  boost::mutex::scoped_lock lock(mLock);
+  if (mEpoch == mPersistedEpoch) {
+    return;
+  }
+  ptime now = Utils::getCurrentTime();
+  if (!force && !mLastPersist.is_not_a_date_time() &&
+      Utils::getTimeDiffInMilliseconds(mLastPersist, now) <
+      EPOCH_CHECKPOINT_INTERVAL_MS) {
+    return;
+  }
+  Uint64 epoch = mEpoch;
+  mLastPersist = now;
+  lock.unlock();
+
+  // write a temporary file and rename it so that a crash never leaves a
+  // partial checkpoint behind
+  std::string tmp = mFile + ".tmp";
+  FILE* file = fopen(tmp.c_str(), "w");
+  if (file == NULL) {
+    LOG_ERROR("failed to open " << tmp << " to checkpoint " << mTable);
+    return;
+  }
+  bool written = fprintf(file, "%llu\n", static_cast<unsigned long long>(epoch)) > 0
+      && fflush(file) == 0 && fsync(fileno(file)) == 0;
+  if (fclose(file) != 0 || !written || rename(tmp.c_str(), mFile.c_str()) != 0) {
+    LOG_ERROR("failed to checkpoint epoch " << epoch << " of " << mTable
+        << " to " << mFile);
+    return;
+  }
+
+  lock.lock();
+  mPersistedEpoch = std::max(mPersistedEpoch, epoch);
+  LOG_DEBUG(mTable << " checkpointed epoch " << epoch);
+}
+
+std::string EpochCheckpoint::getMetrics() {
+  boost::mutex::scoped_lock lock(mLock);
+  Uint64 outstanding = 0;
+  for (const std::pair<const Uint64, Uint64>& epoch : mOutstanding) {
+    outstanding += epoch.second;
+  }
+  std::stringstream out;
+  std::string labels = "{table=\"" + mTable + "\"} ";
+  out << "epipe_checkpoint_epoch" << labels << mEpoch << std::endl;
+  out << "epipe_checkpoint_persisted_epoch" << labels << mPersistedEpoch
+      << std::endl;
+  out << "epipe_checkpoint_outstanding_rows" << labels << outstanding
+      << std::endl;
+  return out.str();
+}
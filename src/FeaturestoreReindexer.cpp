@@ -31,7 +31,7 @@ FeaturestoreReindexer::FeaturestoreReindexer(const char* connection_string, cons
         int elastic_batch_size, int elastic_issue_time, int lru_cap)
         : ClusterConnectionBase(connection_string, database_name, meta_database_name, hive_meta_database_name),
         mFeaturestoreIndex(featurestore_index), mLRUCap(lru_cap) {
-  mElasticSearch = new ProjectsElasticSearch(elastic_client_config, elastic_issue_time, elastic_batch_size, false, MConn());
+  mElasticSearch = new ProjectsElasticSearch(elastic_client_config, elastic_issue_time, elastic_batch_size, 1, false, MConn());
 }
 void FeaturestoreReindexer::run() {
   ptime start = Utils::getCurrentTime();
@@ -73,7 +73,7 @@ void FeaturestoreReindexer::run() {
           LOG_INFO("featurestore type:" << docType << " name:" << nameParts.get().first << " version:" << std::to_string(nameParts.get().second));
           std::string featurestoreDoc = FSMutationsJSONBuilder::featurestoreDoc(mFeaturestoreIndex, docType, inode.mId,
                   nameParts.get().first, nameParts.get().second, dataset.mProjectId, projectName, dataset.mInodeId);
-          bulk.push(Utils::getCurrentTime(), featurestoreDoc);
+          bulk.push(Utils::getCurrentTime(), featurestoreDoc, 1);
           featurestoreDocs++;
 
           if (inode.has_xattrs()) {
@@ -82,7 +82,8 @@ void FeaturestoreReindexer::run() {
               XAttrRow xAttrRow = *xit;
               LOG_INFO("xattr:" << xAttrRow.mName);
               if (xAttrRow.mInodeId == inode.mId) {
-                bulk.push(Utils::getCurrentTime(), xAttrRow.to_upsert_json(mFeaturestoreIndex, FsOpType::XAttrUpdate));
+                bulk.push(Utils::getCurrentTime(), xAttrRow.to_upsert_json(mFeaturestoreIndex, FsOpType::XAttrUpdate),
+                    XAttrRow::upsert_items(FsOpType::XAttrUpdate));
               } else {
                 LOG_WARN("XAttrs doesn't exists for [" << inode.mId << "] - " << xAttrRow.to_string());
                 nonExistentXAttrs++;
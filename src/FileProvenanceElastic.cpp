@@ -18,79 +18,99 @@
 #include "FileProvenanceElastic.h"
 
 FileProvenanceElastic::FileProvenanceElastic(const HttpClientConfig elastic_client_config, int time_to_wait_before_inserting,
-    int bulk_size, const bool stats, SConn conn, int file_lru_cap, int xattr_lru_cap)
-    : ElasticSearchBase(elastic_client_config, time_to_wait_before_inserting, bulk_size, stats, new MovingCountersBulkSet("file_prov")),
+    int bulk_size, int max_in_flight_batches, const bool stats, SConn conn, int file_lru_cap, int xattr_lru_cap)
+    : ElasticSearchBase(elastic_client_config, time_to_wait_before_inserting, bulk_size, max_in_flight_batches, "file_prov",
+    stats, new MovingCountersBulkSet("file_prov")),
     mConn(conn), mFileProvTable(file_lru_cap, xattr_lru_cap) {}
 
-void FileProvenanceElastic::intProcessOneByOne(eBulk bulk) {
-  std::deque<eEvent>::iterator itE, endE;
+void FileProvenanceElastic::intProcessOneByOne(eBulk& bulk) {
   std::string mElasticBulkAddr = getElasticSearchBulkUrl();
-  for(auto event : bulk.mEvents) {
+  for(eEvent& event : bulk.mEvents) {
+    if (event.getItemStatus() == eEvent::ItemStatus::ItemSucceeded) {
+      continue;
+    }
     if (event.getJSON() != FileProvenanceConstants::ELASTIC_NOP && event.getJSON() != FileProvenanceConstants::ELASTIC_NOP2) {
       LOG_DEBUG("val:" << event.getJSON());
-      if (event.getJSON() != FileProvenanceConstants::ELASTIC_NOP) {
+      std::string errorMsg = event.getItemError();
+      //a missing document fails again on retry
+      bool success = boost::starts_with(errorMsg, "document_missing_exception:");
+      if (!success) {
         ParsingResponse pr = httpPostRequest(mElasticBulkAddr, event.getJSON());
-        if (!pr.mSuccess) {
-          if (boost::starts_with(pr.errorMsg, "document_missing_exception:")) {
-            LOG_INFO("file prov - elastic document missing - skipped op" << event.getLogHandler()->getDescription() << std::endl << event.getJSON());
-          } else {
-            LOG_ERROR("file prov - elastic error while processing: " << event.getLogHandler()->getDescription() << std::endl << event.getJSON());
-            LOG_FATAL("file prov - elastic - cannot recover");
-          }
+        success = pr.mSuccess;
+        errorMsg = pr.errorMsg;
+      }
+      if (!success) {
+        if (boost::starts_with(errorMsg, "document_missing_exception:")) {
+          LOG_INFO("file prov - elastic document missing - skipped op" << event.getLogHandler()->getDescription() << std::endl << event.getJSON());
+        } else {
+          LOG_ERROR("file prov - elastic error while processing: " << event.getLogHandler()->getDescription() << std::endl << event.getJSON());
+          LOG_FATAL("file prov - elastic - cannot recover");
         }
       }
-      mFileProvTable.cleanLog(mConn, event.getLogHandler());
+      cleanLog(event.getLogHandler());
     }
   }
 }
 
-bool FileProvenanceElastic::intProcessBatch(std::string val, std::vector<eBulk>* bulks, std::vector<const LogHandler*> cleanupHandlers, ptime start_time) {
-  if (!val.empty()) {
-    LOG_DEBUG("file prov - elastic bulk write size:" << val.length() << " val:" << val);
-    std::string mElasticBulkAddr = getElasticSearchBulkUrl();
-    if (httpPostRequest(mElasticBulkAddr, val).mSuccess) {
-      //bulk success
-      mFileProvTable.cleanLogs(mConn, cleanupHandlers);
-      if (mStats && !bulks->empty()) {
-        mCounters->bulksProcessed(start_time, bulks);
+bool FileProvenanceElastic::send(std::vector<eBulk>* bulks) {
+  LOG_DEBUG("file prov - elastic writting batch to index consists of events:" << bulks->size());
+  HttpBufferChain val;
+  for(eBulk& bulk : *bulks) {
+    for(eEvent& event : bulk.mEvents) {
+      if (event.getJSON() != FileProvenanceConstants::ELASTIC_NOP
+      && event.getJSON() != FileProvenanceConstants::ELASTIC_NOP2) {
+        val.push_back(net::buffer(event.getJSON()));
       }
-      return true;
-    } else {
-      return false;
     }
-  } else {
+  }
+  if (val.empty()) {
     //maybe this was only nops for this index
     LOG_TRACE("file prov - elastic bulk has only nop events");
-    mFileProvTable.cleanLogs(mConn, cleanupHandlers);
-    if (mStats && !bulks->empty()) {
-      mCounters->bulksProcessed(start_time, bulks);
-    }
     return true;
   }
+  LOG_DEBUG("file prov - elastic bulk write size:" << net::buffer_size(val));
+  std::string mElasticBulkAddr = getElasticSearchBulkUrl();
+  ParsingResponse response = httpPostRequest(mElasticBulkAddr, val);
+  if (!response.mSuccess) {
+    setBulkItemStatus(bulks, response);
+  }
+  return response.mSuccess;
 }
 
-void FileProvenanceElastic::process(std::vector<eBulk>* bulks) {
-  LOG_DEBUG("file prov - elastic writting batch to index consists of events:" << bulks->size());
-  ptime start_time = Utils::getCurrentTime();
-  std::string val = "";
+void FileProvenanceElastic::acknowledge(std::vector<eBulk>* bulks, bool sent, ptime start_time) {
   std::vector<const LogHandler*> cleanupHandlers;
-
-  for(auto bulk : *bulks) {
+  for(const eBulk& bulk : *bulks) {
     if(mStats){
       mCounters->bulkReceived(bulk);
     }
-    for(auto event : bulk.mEvents) {
-      if (event.getJSON() != FileProvenanceConstants::ELASTIC_NOP
-      && event.getJSON() != FileProvenanceConstants::ELASTIC_NOP2) {
-        val += event.getJSON();
-      }
+    for(const eEvent& event : bulk.mEvents) {
       cleanupHandlers.push_back(event.getLogHandler());
     }
   }
-  if(!intProcessBatch(val, bulks, cleanupHandlers, start_time)) {
-    LOG_INFO("file prov - elastic batch write failed - trying one by one");
-    //bulk failed - process one by one and stop and failing one
-    for(auto bulk : *bulks) {
+  if(sent) {
+    //bulk success
+    cleanLogs(cleanupHandlers);
+    if (mStats && !bulks->empty()) {
+      mCounters->bulksProcessed(start_time, bulks);
+    }
+  } else {
+    //the logs of the events without failed items are cleaned right away
+    std::vector<const LogHandler*> ackedHandlers;
+    for(eBulk& bulk : *bulks) {
+      for(eEvent& event : bulk.mEvents) {
+        if(event.getItemStatus() == eEvent::ItemStatus::ItemSucceeded) {
+          ackedHandlers.push_back(event.getLogHandler());
+        }
+      }
+    }
+    if(!ackedHandlers.empty()) {
+      LOG_INFO("file prov - elastic batch write has failed items - retrying them one by one");
+      cleanLogs(ackedHandlers);
+    } else {
+      LOG_INFO("file prov - elastic batch write failed - trying one by one");
+    }
+    //process the failed events one by one and stop at a failing one
+    for(eBulk& bulk : *bulks) {
       intProcessOneByOne(bulk);
       if (mStats) {
         mCounters->bulkProcessed(start_time, bulk);
@@ -99,5 +119,9 @@ void FileProvenanceElastic::process(std::vector<eBulk>* bulks) {
   }
 }
 
+int FileProvenanceElastic::removeLogs(std::vector<const LogHandler*>& handlers) {
+  return mFileProvTable.cleanLogs(mConn, handlers);
+}
+
 FileProvenanceElastic::~FileProvenanceElastic() {
 }
\ No newline at end of file
@@ -17,425 +17,178 @@
 #include "FileProvenanceElasticDataReader.h"
 
 FileProvenanceElasticDataReader::FileProvenanceElasticDataReader(SConn hopsConn, const bool hopsworks,
-        int file_lru_cap, int xattr_lru_cap, int inodes_lru_cap)
-: NdbDataReader(hopsConn, hopsworks), mFileLogTable(file_lru_cap, xattr_lru_cap), inodesTable(inodes_lru_cap) {
+        int file_lru_cap, int xattr_lru_cap, int inodes_lru_cap, const int max_batches_in_flight)
+: NdbDataReader(hopsConn, hopsworks, max_batches_in_flight), mFileLogTable(file_lru_cap, xattr_lru_cap), inodesTable(inodes_lru_cap) {
 }
 
 class ElasticHelper {
 public:
 
-  static std::string aliveState(std::string id, std::string index, FileProvenanceRow row, std::string mlId, FileProvenanceConstants::MLType mlType) {
-    rapidjson::Document op;
-    op.SetObject();
-    rapidjson::Document::AllocatorType& opAlloc = op.GetAllocator();
-
-    rapidjson::Value opVal(rapidjson::kObjectType);
-    opVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), opAlloc), opAlloc);
-    opVal.AddMember("_type", rapidjson::Value().SetString("_doc", opAlloc), opAlloc);
-    opVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), opAlloc), opAlloc);
-    op.AddMember("update", opVal, opAlloc);
-
-    rapidjson::Document data;
-    data.SetObject();
-    rapidjson::Document::AllocatorType& dataAlloc = data.GetAllocator();
-
-    rapidjson::Value dataVal(rapidjson::kObjectType);
-
-    dataVal.AddMember("inode_id",         rapidjson::Value().SetInt64(row.mInodeId), dataAlloc);
-    dataVal.AddMember("create_timestamp", rapidjson::Value().SetInt64(row.mTimestamp), dataAlloc);
-    dataVal.AddMember("app_id",           rapidjson::Value().SetString(row.mAppId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("user_id",          rapidjson::Value().SetInt(row.mUserId), dataAlloc);
-    dataVal.AddMember("project_i_id",     rapidjson::Value().SetInt64(row.mProjectId), dataAlloc);
-    dataVal.AddMember("dataset_i_id",     rapidjson::Value().SetInt64(row.mDatasetId), dataAlloc);
-    dataVal.AddMember("parent_i_id",      rapidjson::Value().SetInt64(row.mParentId), dataAlloc);
-    dataVal.AddMember("inode_name",       rapidjson::Value().SetString(row.mInodeName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("project_name",     rapidjson::Value().SetString(row.mProjectName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_id",            rapidjson::Value().SetString(mlId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_type",          rapidjson::Value().SetString(FileProvenanceConstants::MLTypeToStr(mlType).c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("entry_type",       rapidjson::Value().SetString("state", dataAlloc), dataAlloc);
-    dataVal.AddMember("partition_id",     rapidjson::Value().SetInt64(row.mPartitionId), dataAlloc);
-    dataVal.AddMember("r_create_timestamp",    rapidjson::Value().SetString(readable_timestamp(row.mTimestamp).c_str(), dataAlloc), dataAlloc);
-    
-    data.AddMember("doc", dataVal, dataAlloc);
-    data.AddMember("doc_as_upsert", rapidjson::Value().SetBool(true), dataAlloc);
-
-    rapidjson::StringBuffer opBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> opWriter(opBuffer);
-    op.Accept(opWriter);
-
-    rapidjson::StringBuffer dataBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> dataWriter(dataBuffer);
-    data.Accept(dataWriter);
-    
-    std::stringstream out;
-    out << opBuffer.GetString() << std::endl << dataBuffer.GetString();
-    LOG_TRACE("file prov - elastic - add view" << out.str());
-    return out.str();
+  static void aliveState(ElasticBulkWriter& out, const std::string& id, const std::string& index, FileProvenanceRow& row,
+          const std::string& mlId, FileProvenanceConstants::MLType mlType) {
+    updateAction(out, id, index);
+
+    JSONWriter& data = out.startLine();
+    data.StartObject();
+    data.Key("doc");
+    data.StartObject();
+    data.Key("inode_id");           data.Int64(row.mInodeId);
+    data.Key("create_timestamp");   data.Int64(row.mTimestamp);
+    data.Key("app_id");             writeString(data, row.mAppId);
+    data.Key("user_id");            data.Int(row.mUserId);
+    data.Key("project_i_id");       data.Int64(row.mProjectId);
+    data.Key("dataset_i_id");       data.Int64(row.mDatasetId);
+    data.Key("parent_i_id");        data.Int64(row.mParentId);
+    data.Key("inode_name");         writeString(data, row.mInodeName);
+    data.Key("project_name");       writeString(data, row.mProjectName);
+    data.Key("ml_id");              writeString(data, mlId);
+    data.Key("ml_type");            writeString(data, FileProvenanceConstants::MLTypeToStr(mlType));
+    data.Key("entry_type");         data.String("state");
+    data.Key("partition_id");       data.Int64(row.mPartitionId);
+    data.Key("r_create_timestamp"); writeString(data, readable_timestamp(row.mTimestamp));
+    data.EndObject();
+    data.Key("doc_as_upsert");
+    data.Bool(true);
+    data.EndObject();
+    out.endLine();
   }
 
-  static std::string addProjectIIdToState(std::string id, std::string index, FileProvenanceRow row) {
-    rapidjson::Document op;
-    op.SetObject();
-    rapidjson::Document::AllocatorType& opAlloc = op.GetAllocator();
-
-    rapidjson::Value opVal(rapidjson::kObjectType);
-    opVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), opAlloc), opAlloc);
-    opVal.AddMember("_type", rapidjson::Value().SetString("_doc", opAlloc), opAlloc);
-    opVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), opAlloc), opAlloc);
-    op.AddMember("update", opVal, opAlloc);
-
-    rapidjson::Document data;
-    data.SetObject();
-    rapidjson::Document::AllocatorType& dataAlloc = data.GetAllocator();
-
-    rapidjson::Value dataVal(rapidjson::kObjectType);
-
-    dataVal.AddMember("project_i_id",     rapidjson::Value().SetInt64(row.mProjectId), dataAlloc);
-
-    data.AddMember("doc", dataVal, dataAlloc);
-    data.AddMember("doc_as_upsert", rapidjson::Value().SetBool(true), dataAlloc);
-
-    rapidjson::StringBuffer opBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> opWriter(opBuffer);
-    op.Accept(opWriter);
-
-    rapidjson::StringBuffer dataBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> dataWriter(dataBuffer);
-    data.Accept(dataWriter);
-
-    std::stringstream out;
-    out << opBuffer.GetString() << std::endl << dataBuffer.GetString();
-    LOG_TRACE("file prov - elastic - project inode id" << out.str());
-    return out.str();
+  static void addProjectIIdToState(ElasticBulkWriter& out, const std::string& id, const std::string& index, FileProvenanceRow& row) {
+    updateAction(out, id, index);
+
+    JSONWriter& data = out.startLine();
+    data.StartObject();
+    data.Key("doc");
+    data.StartObject();
+    data.Key("project_i_id");
+    data.Int64(row.mProjectId);
+    data.EndObject();
+    data.Key("doc_as_upsert");
+    data.Bool(true);
+    data.EndObject();
+    out.endLine();
   }
 
-  static std::string addXAttrToState(std::string id, std::string index, FileProvenanceRow row, std::string val) {
-    //id
-    rapidjson::Document cleanupId;
-    cleanupId.SetObject();
-    rapidjson::Document::AllocatorType& cleanupAlloc = cleanupId.GetAllocator();
-
-    rapidjson::Value cleanupIdVal(rapidjson::kObjectType);
-    cleanupIdVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), cleanupAlloc), cleanupAlloc);
-    cleanupIdVal.AddMember("_type", rapidjson::Value().SetString("_doc", cleanupAlloc), cleanupAlloc);
-    cleanupIdVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), cleanupAlloc), cleanupAlloc);
-
-    cleanupId.AddMember("update", cleanupIdVal, cleanupId.GetAllocator());
-
+  static void addXAttrToState(ElasticBulkWriter& out, const std::string& id, const std::string& index, FileProvenanceRow& row,
+          const std::string& val) {
     //clean previous
-    rapidjson::Document cleanup;
-    cleanup.SetObject();
-
-    std::stringstream script;
-    script << "if(ctx._source.containsKey(\"" << FileProvenanceConstants::XATTR << "\")){ ";
-    script << "if(ctx._source." << FileProvenanceConstants::XATTR << ".containsKey(\"" << row.mXAttrName << "\")){ ";
-    script << "ctx._source." << FileProvenanceConstants::XATTR << ".remove(\"" << row.mXAttrName <<  "\");";
-    script << "} else{ ctx.op=\"noop\";}";
-    script << "} else{ ctx.op=\"noop\";}";
-
-    rapidjson::Value scriptVal(script.str().c_str(), cleanup.GetAllocator());
-    cleanup.AddMember("scripted_upsert", rapidjson::Value().SetBool(true), cleanup.GetAllocator());
-    cleanup.AddMember("script", scriptVal, cleanup.GetAllocator());
-    rapidjson::Document emptyUpsert;
-    emptyUpsert.SetObject();
-    cleanup.AddMember("upsert", emptyUpsert, cleanup.GetAllocator());
-
-    //id
-    rapidjson::Document op;
-    op.SetObject();
-    rapidjson::Document::AllocatorType& opAlloc = op.GetAllocator();
-
-    rapidjson::Value opVal(rapidjson::kObjectType);
-    opVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), opAlloc), opAlloc);
-    opVal.AddMember("_type", rapidjson::Value().SetString("_doc", opAlloc), opAlloc);
-    opVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), opAlloc), opAlloc);
-    op.AddMember("update", opVal, opAlloc);
+    updateAction(out, id, index);
+
+    JSONWriter& cleanup = out.startLine();
+    cleanup.StartObject();
+    cleanup.Key("scripted_upsert");
+    cleanup.Bool(true);
+    cleanup.Key("script");
+    writeString(cleanup, removeXAttrScript(row.mXAttrName));
+    cleanup.Key("upsert");
+    cleanup.StartObject();
+    cleanup.EndObject();
+    cleanup.EndObject();
+    out.endLine();
 
     //update
-    rapidjson::Document data;
-    data.SetObject();
-    rapidjson::Document::AllocatorType& dataAlloc = data.GetAllocator();
-
-    rapidjson::Value dataVal(rapidjson::kObjectType);
-    rapidjson::Value dataValAux(rapidjson::kObjectType);
-
-    rapidjson::Value provXAttr(FileProvenanceConstants::XATTR.c_str(), dataAlloc);
-    rapidjson::Value xattrKey(row.mXAttrName.c_str(), dataAlloc);
-    rapidjson::Value xattr(rapidjson::kObjectType);
-    rapidjson::Value xAttrAux1(val.c_str(), dataAlloc);
-    xattr.AddMember("raw", xAttrAux1, dataAlloc);
-
-    rapidjson::Document xattrJson(&data.GetAllocator()); 
-    if(!xattrJson.Parse(val.c_str()).HasParseError()) {     
-      xattr.AddMember("value", xattrJson.Move(), dataAlloc);
+    updateAction(out, id, index);
+
+    JSONWriter& data = out.startLine();
+    data.StartObject();
+    data.Key("doc");
+    data.StartObject();
+    writeKey(data, FileProvenanceConstants::XATTR);
+    data.StartObject();
+    writeKey(data, row.mXAttrName);
+    data.StartObject();
+    data.Key("raw");
+    writeString(data, val);
+    data.Key("value");
+    if (out.parseJSON(val)) {
+      out.writeParsed(data);
     } else {
-      rapidjson::Value xAttrAux2(val.c_str(), dataAlloc);
-      xattr.AddMember("value", xAttrAux2, dataAlloc);
+      writeString(data, val);
     }
-    dataValAux.AddMember(xattrKey, xattr, dataAlloc);
-    dataVal.AddMember(provXAttr, dataValAux, dataAlloc);
-    data.AddMember("doc", dataVal, dataAlloc);
-    data.AddMember("doc_as_upsert", rapidjson::Value().SetBool(true), dataAlloc);
-    //done
-    rapidjson::StringBuffer cleanupIdBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> cleanupIdWriter(cleanupIdBuffer);
-    cleanupId.Accept(cleanupIdWriter);
-
-    rapidjson::StringBuffer cleanupBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> cleanupWriter(cleanupBuffer);
-    cleanup.Accept(cleanupWriter);
-
-    rapidjson::StringBuffer opBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> opWriter(opBuffer);
-    op.Accept(opWriter);
-
-    rapidjson::StringBuffer dataBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> dataWriter(dataBuffer);
-    data.Accept(dataWriter);
-    
-    std::stringstream out;
-    out << cleanupIdBuffer.GetString()  << std::endl 
-        << cleanupBuffer.GetString()    << std::endl 
-        << opBuffer.GetString()         << std::endl 
-        << dataBuffer.GetString();
-    LOG_TRACE("file prov - elastic - update xattr" << out.str());
-    return out.str();
+    data.EndObject();
+    data.EndObject();
+    data.EndObject();
+    data.Key("doc_as_upsert");
+    data.Bool(true);
+    data.EndObject();
+    out.endLine();
   }
 
-  static std::string deleteXAttrFromState(std::string id, std::string index, FileProvenanceRow row) {
-    //id
-    rapidjson::Document cleanupId;
-    cleanupId.SetObject();
-    rapidjson::Document::AllocatorType& cleanupAlloc = cleanupId.GetAllocator();
-
-    rapidjson::Value cleanupIdVal(rapidjson::kObjectType);
-    cleanupIdVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), cleanupAlloc), cleanupAlloc);
-    cleanupIdVal.AddMember("_type", rapidjson::Value().SetString("_doc", cleanupAlloc), cleanupAlloc);
-    cleanupIdVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), cleanupAlloc), cleanupAlloc);
-    cleanupId.AddMember("update", cleanupIdVal, cleanupAlloc);
-
-    //cleanup
-    rapidjson::Document cleanup;
-    cleanup.SetObject();
-
-    std::stringstream script;
-    script << "if(ctx._source.containsKey(\"" << FileProvenanceConstants::XATTR << "\")){ ";
-    script << "if(ctx._source." << FileProvenanceConstants::XATTR << ".containsKey(\"" << row.mXAttrName << "\")){ ";
-    script << "ctx._source." << FileProvenanceConstants::XATTR << ".remove(\"" << row.mXAttrName <<  "\");";
-    script << "} else{ ctx.op=\"noop\";}";
-    script << "} else{ ctx.op=\"noop\";}";
-
-    rapidjson::Value scriptVal(script.str().c_str(), cleanup.GetAllocator());
-    cleanup.AddMember("script", scriptVal, cleanup.GetAllocator());
-
-    //done
-    rapidjson::StringBuffer cleanupIdBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> cleanupIdWriter(cleanupIdBuffer);
-    cleanupId.Accept(cleanupIdWriter);
-
-    rapidjson::StringBuffer cleanupBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> cleanupWriter(cleanupBuffer);
-    cleanup.Accept(cleanupWriter);
-    
-    std::stringstream out;
-    out << cleanupIdBuffer.GetString() << std::endl 
-        << cleanupBuffer.GetString();
-    LOG_TRACE("file prov - elastic - delete xattr" << out.str());
-    return out.str();
-  }
-
-  static std::string deadState(std::string id, std::string index) {
-
-    rapidjson::Document op;
-    op.SetObject();
-    rapidjson::Document::AllocatorType& opAlloc = op.GetAllocator();
-
-    rapidjson::Value opVal(rapidjson::kObjectType);
-
-    opVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), opAlloc), opAlloc);
-    opVal.AddMember("_type", rapidjson::Value().SetString("_doc", opAlloc), opAlloc);
-    opVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), opAlloc), opAlloc);
+  static void deleteXAttrFromState(ElasticBulkWriter& out, const std::string& id, const std::string& index, FileProvenanceRow& row) {
+    updateAction(out, id, index);
 
-    op.AddMember("delete", opVal, opAlloc);
+    JSONWriter& cleanup = out.startLine();
+    cleanup.StartObject();
+    cleanup.Key("script");
+    writeString(cleanup, removeXAttrScript(row.mXAttrName));
+    cleanup.EndObject();
+    out.endLine();
+  }
 
-    rapidjson::StringBuffer reqBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> reqWriter(reqBuffer);
-    op.Accept(reqWriter);
-    
-    std::stringstream out;
-    out << reqBuffer.GetString();
-    LOG_TRACE("file prov - elastic - delete view" << out.str());
-    return out.str();
+  static void deadState(ElasticBulkWriter& out, const std::string& id, const std::string& index) {
+    action(out, "delete", id, index);
   }
 
-  static std::string fileOp(std::string id, std::string index, FileProvenanceRow row, std::string mlId, FileProvenanceConstants::MLType mlType) {
-    rapidjson::Document op;
-    op.SetObject();
-    rapidjson::Document::AllocatorType& opAlloc = op.GetAllocator();
-
-    rapidjson::Value opVal(rapidjson::kObjectType);
-    opVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), opAlloc), opAlloc);
-    opVal.AddMember("_type", rapidjson::Value().SetString("_doc", opAlloc), opAlloc);
-    opVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), opAlloc), opAlloc);
-
-    op.AddMember("update", opVal, opAlloc);
-
-    rapidjson::Document data;
-    data.SetObject();
-    rapidjson::Document::AllocatorType& dataAlloc = data.GetAllocator();
-
-    rapidjson::Value dataVal(rapidjson::kObjectType);
-
-    dataVal.AddMember("inode_id",         rapidjson::Value().SetInt64(row.mInodeId), dataAlloc);
-    dataVal.AddMember("inode_operation",  rapidjson::Value().SetString(row.mOperation.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("logical_time",     rapidjson::Value().SetInt(row.mLogicalTime), dataAlloc);
-    dataVal.AddMember("timestamp",        rapidjson::Value().SetInt64(row.mTimestamp), dataAlloc);
-    dataVal.AddMember("app_id",           rapidjson::Value().SetString(row.mAppId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("user_id",           rapidjson::Value().SetInt(row.mUserId), dataAlloc);
-    dataVal.AddMember("project_i_id",     rapidjson::Value().SetInt64(row.mProjectId), dataAlloc);
-    dataVal.AddMember("dataset_i_id",     rapidjson::Value().SetInt64(row.mDatasetId), dataAlloc);
-    dataVal.AddMember("parent_i_id",      rapidjson::Value().SetInt64(row.mParentId), dataAlloc);
-    dataVal.AddMember("inode_name",       rapidjson::Value().SetString(row.mInodeName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("project_name",     rapidjson::Value().SetString(row.mProjectName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_id",            rapidjson::Value().SetString(mlId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_type",          rapidjson::Value().SetString(FileProvenanceConstants::MLTypeToStr(mlType).c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("entry_type",       rapidjson::Value().SetString("operation", dataAlloc), dataAlloc);
-    dataVal.AddMember("partition_id",     rapidjson::Value().SetInt64(row.mPartitionId), dataAlloc);
-    dataVal.AddMember("r_timestamp",      rapidjson::Value().SetString(readable_timestamp(row.mTimestamp).c_str(), dataAlloc), dataAlloc);
-     
-    data.AddMember("doc", dataVal, dataAlloc);
-    data.AddMember("doc_as_upsert", rapidjson::Value().SetBool(true), dataAlloc);
-
-    rapidjson::StringBuffer opBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> opWriter(opBuffer);
-    op.Accept(opWriter);
-
-    rapidjson::StringBuffer dataBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> dataWriter(dataBuffer);
-    data.Accept(dataWriter);
-    
-    std::stringstream out;
-    out << opBuffer.GetString() << std::endl << dataBuffer.GetString();
-    LOG_TRACE("file prov - elastic - file op" << out.str());
-    return out.str();
+  static void fileOp(ElasticBulkWriter& out, const std::string& id, const std::string& index, FileProvenanceRow& row,
+          const std::string& mlId, FileProvenanceConstants::MLType mlType) {
+    updateAction(out, id, index);
+
+    JSONWriter& data = out.startLine();
+    data.StartObject();
+    data.Key("doc");
+    data.StartObject();
+    opFields(data, row, mlId, mlType);
+    data.EndObject();
+    data.Key("doc_as_upsert");
+    data.Bool(true);
+    data.EndObject();
+    out.endLine();
   }
 
-  static std::string addXAttrOp(std::string id, std::string index, FileProvenanceRow row, std::string val, std::string mlId, FileProvenanceConstants::MLType mlType) {
-    rapidjson::Document op;
-    op.SetObject();
-    rapidjson::Document::AllocatorType& opAlloc = op.GetAllocator();
-
-    rapidjson::Value opVal(rapidjson::kObjectType);
-    opVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), opAlloc), opAlloc);
-    opVal.AddMember("_type", rapidjson::Value().SetString("_doc", opAlloc), opAlloc);
-    opVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), opAlloc), opAlloc);
-
-    op.AddMember("update", opVal, opAlloc);
-
-    rapidjson::Document data;
-    data.SetObject();
-    rapidjson::Document::AllocatorType& dataAlloc = data.GetAllocator();
-
-    rapidjson::Value dataVal(rapidjson::kObjectType);
-    rapidjson::Value dataValAux(rapidjson::kObjectType);
-
-    dataVal.AddMember("inode_id",         rapidjson::Value().SetInt64(row.mInodeId), dataAlloc);
-    dataVal.AddMember("inode_operation",  rapidjson::Value().SetString(row.mOperation.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("logical_time",     rapidjson::Value().SetInt(row.mLogicalTime), dataAlloc);
-    dataVal.AddMember("timestamp",        rapidjson::Value().SetInt64(row.mTimestamp), dataAlloc);
-    dataVal.AddMember("app_id",           rapidjson::Value().SetString(row.mAppId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("user_id",           rapidjson::Value().SetInt(row.mUserId), dataAlloc);
-    dataVal.AddMember("project_i_id",     rapidjson::Value().SetInt64(row.mProjectId), dataAlloc);
-    dataVal.AddMember("dataset_i_id",     rapidjson::Value().SetInt64(row.mDatasetId), dataAlloc);
-    dataVal.AddMember("parent_i_id",      rapidjson::Value().SetInt64(row.mParentId), dataAlloc);
-    dataVal.AddMember("inode_name",       rapidjson::Value().SetString(row.mInodeName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("project_name",     rapidjson::Value().SetString(row.mProjectName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_id",            rapidjson::Value().SetString(mlId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_type",          rapidjson::Value().SetString(FileProvenanceConstants::MLTypeToStr(mlType).c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("entry_type",       rapidjson::Value().SetString("operation", dataAlloc), dataAlloc);
-    dataVal.AddMember("partition_id",     rapidjson::Value().SetInt64(row.mPartitionId), dataAlloc);
-    dataVal.AddMember("r_timestamp",      rapidjson::Value().SetString(readable_timestamp(row.mTimestamp).c_str(), dataAlloc), dataAlloc);
-
-    rapidjson::Value xattr(rapidjson::kObjectType);
-    xattr.AddMember("raw", rapidjson::Value().SetString(val.c_str(), dataAlloc), dataAlloc);
-    rapidjson::Document xattrJson(&data.GetAllocator());
-    if(!xattrJson.Parse(val.c_str()).HasParseError()) {     
-      xattr.AddMember("value", xattrJson.Move(), dataAlloc);
+  static void addXAttrOp(ElasticBulkWriter& out, const std::string& id, const std::string& index, FileProvenanceRow& row,
+          const std::string& val, const std::string& mlId, FileProvenanceConstants::MLType mlType) {
+    updateAction(out, id, index);
+
+    JSONWriter& data = out.startLine();
+    data.StartObject();
+    data.Key("doc");
+    data.StartObject();
+    opFields(data, row, mlId, mlType);
+    writeKey(data, FileProvenanceConstants::XATTR);
+    data.StartObject();
+    writeKey(data, row.mXAttrName);
+    data.StartObject();
+    data.Key("raw");
+    writeString(data, val);
+    if (out.parseJSON(val)) {
+      data.Key("value");
+      out.writeParsed(data);
     }
-    // rapidjson::Value xattrKey(row.mXAttrName.c_str(), dataAlloc);
-    rapidjson::Value provXAttr(FileProvenanceConstants::XATTR.c_str(), dataAlloc);
-    rapidjson::Value xattrKey(row.mXAttrName.c_str(), dataAlloc);
-    dataValAux.AddMember(xattrKey, xattr, dataAlloc);
-    dataVal.AddMember(provXAttr, dataValAux, dataAlloc);
-    // dataVal.AddMember(xattrKey, xattr, dataAlloc);
-    data.AddMember("doc", dataVal, dataAlloc);
-    data.AddMember("doc_as_upsert", rapidjson::Value().SetBool(true), dataAlloc);
-
-    rapidjson::StringBuffer opBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> opWriter(opBuffer);
-    op.Accept(opWriter);
-
-    rapidjson::StringBuffer dataBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> dataWriter(dataBuffer);
-    data.Accept(dataWriter);
-    
-    std::stringstream out;
-    out << opBuffer.GetString() << std::endl << dataBuffer.GetString();
-    LOG_TRACE("file prov - elastic - add xattr op" << out.str());
-    return out.str();
+    data.EndObject();
+    data.EndObject();
+    data.EndObject();
+    data.Key("doc_as_upsert");
+    data.Bool(true);
+    data.EndObject();
+    out.endLine();
   }
 
-  static std::string deleteXAttrOp(std::string id, std::string index, FileProvenanceRow row, std::string mlId, FileProvenanceConstants::MLType mlType) {
-    rapidjson::Document op;
-    op.SetObject();
-    rapidjson::Document::AllocatorType& opAlloc = op.GetAllocator();
-
-    rapidjson::Value opVal(rapidjson::kObjectType);
-    opVal.AddMember("_id", rapidjson::Value().SetString(id.c_str(), opAlloc), opAlloc);
-    opVal.AddMember("_type", rapidjson::Value().SetString("_doc", opAlloc), opAlloc);
-    opVal.AddMember("_index", rapidjson::Value().SetString(index.c_str(), opAlloc), opAlloc);
-
-    op.AddMember("update", opVal, opAlloc);
-
-    rapidjson::Document data;
-    data.SetObject();
-    rapidjson::Document::AllocatorType& dataAlloc = data.GetAllocator();
-
-    rapidjson::Value dataVal(rapidjson::kObjectType);
-
-    dataVal.AddMember("inode_id",         rapidjson::Value().SetInt64(row.mInodeId), dataAlloc);
-    dataVal.AddMember("inode_operation",  rapidjson::Value().SetString(row.mOperation.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("logical_time",     rapidjson::Value().SetInt(row.mLogicalTime), dataAlloc);
-    dataVal.AddMember("timestamp",        rapidjson::Value().SetInt64(row.mTimestamp), dataAlloc);
-    dataVal.AddMember("app_id",           rapidjson::Value().SetString(row.mAppId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("user_id",           rapidjson::Value().SetInt(row.mUserId), dataAlloc);
-    dataVal.AddMember("project_i_id",     rapidjson::Value().SetInt64(row.mProjectId), dataAlloc);
-    dataVal.AddMember("dataset_i_id",     rapidjson::Value().SetInt64(row.mDatasetId), dataAlloc);
-    dataVal.AddMember("parent_i_id",      rapidjson::Value().SetInt64(row.mParentId), dataAlloc);
-    dataVal.AddMember("inode_name",       rapidjson::Value().SetString(row.mInodeName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("project_name",     rapidjson::Value().SetString(row.mProjectName.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_id",            rapidjson::Value().SetString(mlId.c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("ml_type",          rapidjson::Value().SetString(FileProvenanceConstants::MLTypeToStr(mlType).c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("entry_type",       rapidjson::Value().SetString("operation", dataAlloc), dataAlloc);
-    dataVal.AddMember("partition_id",     rapidjson::Value().SetInt64(row.mPartitionId), dataAlloc);
-    dataVal.AddMember("r_timestamp",      rapidjson::Value().SetString(readable_timestamp(row.mTimestamp).c_str(), dataAlloc), dataAlloc);
-    dataVal.AddMember("xattr_prov_key", rapidjson::Value().SetString(row.mXAttrName.c_str(), dataAlloc), dataAlloc);
-
-    data.AddMember("doc", dataVal, dataAlloc);
-    data.AddMember("doc_as_upsert", rapidjson::Value().SetBool(true), dataAlloc);
-
-    rapidjson::StringBuffer opBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> opWriter(opBuffer);
-    op.Accept(opWriter);
-
-    rapidjson::StringBuffer dataBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> dataWriter(dataBuffer);
-    data.Accept(dataWriter);
-    
-    std::stringstream out;
-    out << opBuffer.GetString() << std::endl << dataBuffer.GetString();
-    LOG_TRACE("file prov - elastic - delete xattr op" << out.str());
-    return out.str();
+  static void deleteXAttrOp(ElasticBulkWriter& out, const std::string& id, const std::string& index, FileProvenanceRow& row,
+          const std::string& mlId, FileProvenanceConstants::MLType mlType) {
+    updateAction(out, id, index);
+
+    JSONWriter& data = out.startLine();
+    data.StartObject();
+    data.Key("doc");
+    data.StartObject();
+    opFields(data, row, mlId, mlType);
+    data.Key("xattr_prov_key");
+    writeString(data, row.mXAttrName);
+    data.EndObject();
+    data.Key("doc_as_upsert");
+    data.Bool(true);
+    data.EndObject();
+    out.endLine();
   }
 
   static std::string readable_timestamp(Int64 timestamp) {
@@ -452,16 +205,78 @@ public:
     return readable_timestamp.str();
   }
 
-  static std::string opId(FileProvenanceRow row) {
-    std::stringstream out;
-    out << row.mInodeId << "-" << row.mOperation << "-" << row.mLogicalTime << "-" << row.mTimestamp << "-" << row.mAppId << "-" << row.mUserId;
-    return out.str();
+  static std::string opId(FileProvenanceRow& row) {
+    std::string out = std::to_string(row.mInodeId);
+    out.append("-").append(row.mOperation);
+    out.append("-").append(std::to_string(row.mLogicalTime));
+    out.append("-").append(std::to_string(row.mTimestamp));
+    out.append("-").append(row.mAppId);
+    out.append("-").append(std::to_string(row.mUserId));
+    return out;
+  }
+
+  static std::string stateId(FileProvenanceRow& row) {
+    return std::to_string(row.mInodeId);
+  }
+
+private:
+  static void writeString(JSONWriter& writer, const std::string& value) {
+    writer.String(value.c_str(), static_cast<rapidjson::SizeType>(value.length()));
   }
 
-  static std::string stateId(FileProvenanceRow row) {
-    std::stringstream out;
-    out << row.mInodeId;
-    return out.str();
+  static void writeKey(JSONWriter& writer, const std::string& value) {
+    writer.Key(value.c_str(), static_cast<rapidjson::SizeType>(value.length()));
+  }
+
+  static void action(ElasticBulkWriter& out, const char* type, const std::string& id, const std::string& index) {
+    JSONWriter& op = out.startAction();
+    op.StartObject();
+    op.Key(type);
+    op.StartObject();
+    op.Key("_id");
+    writeString(op, id);
+    op.Key("_type");
+    op.String("_doc");
+    op.Key("_index");
+    writeString(op, index);
+    op.EndObject();
+    op.EndObject();
+    out.endLine();
+  }
+
+  static void updateAction(ElasticBulkWriter& out, const std::string& id, const std::string& index) {
+    action(out, "update", id, index);
+  }
+
+  static void opFields(JSONWriter& data, FileProvenanceRow& row, const std::string& mlId,
+          FileProvenanceConstants::MLType mlType) {
+    data.Key("inode_id");         data.Int64(row.mInodeId);
+    data.Key("inode_operation");  writeString(data, row.mOperation);
+    data.Key("logical_time");     data.Int(row.mLogicalTime);
+    data.Key("timestamp");        data.Int64(row.mTimestamp);
+    data.Key("app_id");           writeString(data, row.mAppId);
+    data.Key("user_id");          data.Int(row.mUserId);
+    data.Key("project_i_id");     data.Int64(row.mProjectId);
+    data.Key("dataset_i_id");     data.Int64(row.mDatasetId);
+    data.Key("parent_i_id");      data.Int64(row.mParentId);
+    data.Key("inode_name");       writeString(data, row.mInodeName);
+    data.Key("project_name");     writeString(data, row.mProjectName);
+    data.Key("ml_id");            writeString(data, mlId);
+    data.Key("ml_type");          writeString(data, FileProvenanceConstants::MLTypeToStr(mlType));
+    data.Key("entry_type");       data.String("operation");
+    data.Key("partition_id");     data.Int64(row.mPartitionId);
+    data.Key("r_timestamp");      writeString(data, readable_timestamp(row.mTimestamp));
+  }
+
+  static std::string removeXAttrScript(const std::string& xattrName) {
+    const std::string& field = FileProvenanceConstants::XATTR;
+    std::string script;
+    script.append("if(ctx._source.containsKey(\"").append(field).append("\")){ ");
+    script.append("if(ctx._source.").append(field).append(".containsKey(\"").append(xattrName).append("\")){ ");
+    script.append("ctx._source.").append(field).append(".remove(\"").append(xattrName).append("\");");
+    script.append("} else{ ctx.op=\"noop\";}");
+    script.append("} else{ ctx.op=\"noop\";}");
+    return script;
   }
 };
 
@@ -470,32 +285,57 @@ void FileProvenanceElasticDataReader::processAddedandDeleted(Pq* data_batch, eBu
 
   for (Pq::iterator it = data_batch->begin(); it != data_batch->end(); ++it) {
     FileProvenanceRow row = *it;
+    mBulkOps.clear();
     ProcessRowResult result = process_row(row);
-    LogHandler* lh = mFileLogTable.getLogHandler(result.mLogPK, result.mCompanionPK);
+    LogHandler* lh = mFileLogTable.getLogHandler(result.mLogPK, result.mCompanionPK, row.mEpoch);
     if (inodes.find(row.mInodeId) != inodes.end() || result.mProvOp == FileProvenanceConstantsRaw::Operation::OP_DELETE) {
-      std::string elasticBulkOps = getElasticBulkOps(result.mElasticOps);
-      bulk.push(lh, row.mEventCreationTime, elasticBulkOps);
+      bulk.push(lh, row.mEventCreationTime, getElasticBulkOps(), mBulkOps.getActions());
     } else {
       LOG_DEBUG("file prov - prep - op: " << row.getPK().to_string() << " hdfs inode missing file:" << row.mInodeName << "dataset:" << row.mDatasetName);
-      bulk.push(lh, row.mEventCreationTime, FileProvenanceConstants::ELASTIC_NOP);
+      bulk.push(lh, row.mEventCreationTime, FileProvenanceConstants::ELASTIC_NOP, 0);
     }
   }
 }
 
-ULSet FileProvenanceElasticDataReader::getViewInodes(Pq* data_batch) {
-  AnyVec anyVec;
+int FileProvenanceElasticDataReader::prefetch(Pq* data_batch) {
+  INodePKs pks = getViewInodesPKs(data_batch);
+  AsyncRead* read = new AsyncRead();
+  if (!inodesTable.prepareGet(mNdbConnection, pks, read)) {
+    delete read;
+    return 0;
+  }
+  mPrefetchedINodes[data_batch] = read;
+  return 1;
+}
+
+void FileProvenanceElasticDataReader::waitForPrefetched(int transactions) {
+  DBTableBase::waitForAsyncTransactions(mNdbConnection, transactions);
+}
+
+INodePKs FileProvenanceElasticDataReader::getViewInodesPKs(Pq* data_batch) {
+  INodePKs pks;
   for (Pq::iterator it = data_batch->begin(); it != data_batch->end(); ++it) {
     FileProvenanceRow row = *it;
     std::pair<FileProvenanceConstants::MLType, std::string> mlAux = FileProvenanceConstants::parseML(row);
     if(mlAux.first != FileProvenanceConstants::MLType::NONE) {
-      AnyMap pk;
-      pk[0] = row.mParentId;
-      pk[1] = row.mInodeName;
-      pk[2] = row.mPartitionId;
-      anyVec.push_back(pk);
+      pks.push_back(INodePK(row.mParentId, row.mInodeName, row.mPartitionId));
     }
   }
-  INodeVec inodesAux = inodesTable.get(mNdbConnection, anyVec);
+  return pks;
+}
+
+ULSet FileProvenanceElasticDataReader::getViewInodes(Pq* data_batch) {
+  INodeVec inodesAux;
+  boost::unordered_map<Pq*, AsyncRead*>::iterator prefetched = mPrefetchedINodes.find(data_batch);
+  if (prefetched == mPrefetchedINodes.end()) {
+    INodePKs pks = getViewInodesPKs(data_batch);
+    inodesAux = inodesTable.get(mNdbConnection, pks);
+  } else {
+    AsyncRead* read = prefetched->second;
+    mPrefetchedINodes.erase(prefetched);
+    inodesAux = inodesTable.completeGet(read);
+    delete read;
+  }
   ULSet inodes;
   for (INodeVec::iterator it = inodesAux.begin(); it != inodesAux.end(); ++it) {
     INodeRow row = *it;
@@ -504,21 +344,15 @@ ULSet FileProvenanceElasticDataReader::getViewInodes(Pq* data_batch) {
   return inodes;
 }
 
-std::string FileProvenanceElasticDataReader::getElasticBulkOps(std::list <std::string> bulkOps) {
-  std::stringstream out;
-  if (bulkOps.empty()) {
-    out << FileProvenanceConstants::ELASTIC_NOP;
-  } else {
-    for (std::string op : bulkOps) {
-      out << op << std::endl;
-    }
+std::string FileProvenanceElasticDataReader::getElasticBulkOps() {
+  if (mBulkOps.empty()) {
+    return FileProvenanceConstants::ELASTIC_NOP;
   }
-  return out.str();
+  return mBulkOps.str();
 }
 
 ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow row) {
   LOG_DEBUG("file prov - processing:" << row.getPK().to_string() << " name:" << row.mInodeName << " dataset:" << row.mDatasetName);
-  std::list<std::string> bulkOps;
   FileProvenanceConstantsRaw::Operation fileOp = FileProvenanceConstantsRaw::findOp(row.mOperation);
   std::pair<FileProvenanceConstants::MLType, std::string> mlAux = FileProvenanceConstants::parseML(row);
   LOG_DEBUG("file prov - ml type:" << mlAux.first << " inode:" << row.mInodeId << " name:" << row.mInodeName);
@@ -565,14 +399,11 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
             switch (datasetProvCore.get()) {
               case FileProvenanceConstants::STORE_NONE: break;
               case FileProvenanceConstants::STORE_STATE: {
-                std::string state = ElasticHelper::aliveState(ElasticHelper::stateId(row), projectIndex, row, mlAux.second, mlAux.first);
-                bulkOps.push_back(state);
+                ElasticHelper::aliveState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row, mlAux.second, mlAux.first);
               } break;
               case FileProvenanceConstants::STORE_ALL: {
-                std::string state = ElasticHelper::aliveState(ElasticHelper::stateId(row), projectIndex, row, mlAux.second, mlAux.first);
-                bulkOps.push_back(state);
-                std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-                bulkOps.push_back(op);
+                ElasticHelper::aliveState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row, mlAux.second, mlAux.first);
+                ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
               } break;
               default: {
                 LOG_WARN("file prov - unhandled prov state:" << datasetProvCore.get() << " - skipping it");
@@ -585,8 +416,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           case FileProvenanceConstants::MLType::EXPERIMENT_PART:
           case FileProvenanceConstants::MLType::MODEL_PART: {
             if (datasetProvCore.get() == FileProvenanceConstants::STORE_ALL) {
-              std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-              bulkOps.push_back(op);
+              ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
             }
           } break;
           default: {
@@ -594,7 +424,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           }
         }
       }
-      return rowResult(bulkOps, row.getPK(), boost::none, fileOp);
+      return rowResult(row.getPK(), boost::none, fileOp);
     } break;
     case FileProvenanceConstantsRaw::Operation::OP_DELETE: {
       if(!skipElasticOp) {
@@ -608,14 +438,11 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
             switch (datasetProvCore.get()) {
               case FileProvenanceConstants::STORE_NONE: break;
               case FileProvenanceConstants::STORE_STATE: {
-                std::string state = ElasticHelper::deadState(ElasticHelper::stateId(row), projectIndex);
-                bulkOps.push_back(state);
+                ElasticHelper::deadState(mBulkOps, ElasticHelper::stateId(row), projectIndex);
               } break;
               case FileProvenanceConstants::STORE_ALL: {
-                std::string state = ElasticHelper::deadState(ElasticHelper::stateId(row), projectIndex);
-                bulkOps.push_back(state);
-                std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-                bulkOps.push_back(op);
+                ElasticHelper::deadState(mBulkOps, ElasticHelper::stateId(row), projectIndex);
+                ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
               } break;
               default: {
                 LOG_WARN("file prov - unhandled prov state:" << datasetProvCore.get() << " - skipping it");
@@ -628,8 +455,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           case FileProvenanceConstants::MLType::EXPERIMENT_PART:
           case FileProvenanceConstants::MLType::MODEL_PART: {
             if (datasetProvCore.get() == FileProvenanceConstants::STORE_ALL) {
-              std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-              bulkOps.push_back(op);
+              ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
             }
           } break;
           default: {
@@ -638,9 +464,9 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
         }
       }
       if (row.mInodeId == row.mDatasetId) {
-        return rowResult(bulkOps, row.getPK(), datasetProvCoreRow.get().getPK(), fileOp);
+        return rowResult(row.getPK(), datasetProvCoreRow.get().getPK(), fileOp);
       } else {
-        return rowResult(bulkOps, row.getPK(), boost::none, fileOp);
+        return rowResult(row.getPK(), boost::none, fileOp);
       }
     } break;
     case FileProvenanceConstantsRaw::Operation::OP_MODIFY_DATA:
@@ -657,8 +483,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
               case FileProvenanceConstants::STORE_NONE: break;
               case FileProvenanceConstants::STORE_STATE: break;
               case FileProvenanceConstants::STORE_ALL: {
-                std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-                bulkOps.push_back(op);
+                ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
               } break;
               default: {
                 LOG_WARN("file prov - unhandled prov state:" << datasetProvCore.get() << " - skipping it");
@@ -671,8 +496,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           case FileProvenanceConstants::MLType::EXPERIMENT_PART:
           case FileProvenanceConstants::MLType::MODEL_PART: {
             if (datasetProvCore.get() == FileProvenanceConstants::STORE_ALL) {
-              std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-              bulkOps.push_back(op);
+              ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
             }
           } break;
           default: {
@@ -680,7 +504,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           }
         }
       }
-      return rowResult(bulkOps, row.getPK(), boost::none, fileOp);
+      return rowResult(row.getPK(), boost::none, fileOp);
     } break;
     case FileProvenanceConstantsRaw::Operation::OP_XATTR_ADD:
     case FileProvenanceConstantsRaw::Operation::OP_XATTR_UPDATE: {
@@ -702,13 +526,11 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           if (!skipElasticOp) {
             switch (datasetProvCore.get()) {
               case FileProvenanceConstants::ProvOpStoreType::STORE_NONE: {
-                std::string state = ElasticHelper::deadState(ElasticHelper::stateId(row), projectIndex);
-                bulkOps.push_back(state);
+                ElasticHelper::deadState(mBulkOps, ElasticHelper::stateId(row), projectIndex);
               } break;
               case FileProvenanceConstants::ProvOpStoreType::STORE_STATE:
               case FileProvenanceConstants::ProvOpStoreType::STORE_ALL: {
-                std::string state = ElasticHelper::aliveState(ElasticHelper::stateId(row), projectIndex, row, mlAux.second, mlAux.first);
-                bulkOps.push_back(state);
+                ElasticHelper::aliveState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row, mlAux.second, mlAux.first);
               } break;
               default: {
                 LOG_WARN("file prov - unhandled prov state:" << datasetProvCore.get() << " - skipping it");
@@ -730,21 +552,16 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
             switch (datasetProvCore.get()) {
               case FileProvenanceConstants::ProvOpStoreType::STORE_STATE: {
                 if (row.mXAttrName == FileProvenanceConstants::XATTR_PROJECT_IID) {
-                  std::string projIIdStateVal = ElasticHelper::addProjectIIdToState(ElasticHelper::stateId(row), projectIndex, row);
-                  bulkOps.push_back(projIIdStateVal);
+                  ElasticHelper::addProjectIIdToState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row);
                 }
-                std::string xattrStateVal = ElasticHelper::addXAttrToState(ElasticHelper::stateId(row), projectIndex, row, xattr.get().mValue);
-                bulkOps.push_back(xattrStateVal);
+                ElasticHelper::addXAttrToState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row, xattr.get().mValue);
               } break;
               case FileProvenanceConstants::ProvOpStoreType::STORE_ALL: {
                 if (row.mXAttrName == FileProvenanceConstants::XATTR_PROJECT_IID) {
-                  std::string projIIdStateVal = ElasticHelper::addProjectIIdToState(ElasticHelper::stateId(row), projectIndex, row);
-                  bulkOps.push_back(projIIdStateVal);
+                  ElasticHelper::addProjectIIdToState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row);
                 }
-                std::string xattrStateVal = ElasticHelper::addXAttrToState(ElasticHelper::stateId(row), projectIndex, row, xattr.get().mValue);
-                bulkOps.push_back(xattrStateVal);
-                std::string xattrOpVal = ElasticHelper::addXAttrOp(ElasticHelper::opId(row), projectIndex, row, xattr.get().mValue, mlAux.second, mlAux.first);
-                bulkOps.push_back(xattrOpVal);
+                ElasticHelper::addXAttrToState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row, xattr.get().mValue);
+                ElasticHelper::addXAttrOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, xattr.get().mValue, mlAux.second, mlAux.first);
               } break;
               case FileProvenanceConstants::ProvOpStoreType::STORE_NONE: break;
               default: {
@@ -758,8 +575,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           case FileProvenanceConstants::MLType::EXPERIMENT_PART:
           case FileProvenanceConstants::MLType::MODEL_PART: {
             if (datasetProvCore.get() == FileProvenanceConstants::STORE_ALL) {
-              std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-              bulkOps.push_back(op);
+              ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
             }
           } break;
           default: {
@@ -769,12 +585,12 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
       }
       if (row.mXAttrName == FileProvenanceConstantsRaw::XATTR_PROV_CORE) {
         if (datasetProvCoreRow && datasetProvCoreRow.get().getPK().mInodeLogicalTime < xattrBufferKey.mInodeLogicalTime) {
-          return rowResult(bulkOps, row.getPK(), datasetProvCoreRow.get().getPK(), fileOp);
+          return rowResult(row.getPK(), datasetProvCoreRow.get().getPK(), fileOp);
         } else {
-          return rowResult(bulkOps, row.getPK(), boost::none, fileOp);
+          return rowResult(row.getPK(), boost::none, fileOp);
         }
       } else {
-        return rowResult(bulkOps, row.getPK(), xattrBufferKey, fileOp);
+        return rowResult(row.getPK(), xattrBufferKey, fileOp);
       }
     } break;
     case FileProvenanceConstantsRaw::Operation::OP_XATTR_DELETE: {
@@ -793,14 +609,11 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
             switch (datasetProvCore.get()) {
               case FileProvenanceConstants::STORE_NONE: break;
               case FileProvenanceConstants::STORE_STATE: {
-                std::string xattrStateVal = ElasticHelper::deleteXAttrFromState(ElasticHelper::stateId(row), projectIndex, row);
-                bulkOps.push_back(xattrStateVal);
+                ElasticHelper::deleteXAttrFromState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row);
               } break;
               case FileProvenanceConstants::STORE_ALL: {
-                std::string xattrStateVal = ElasticHelper::deleteXAttrFromState(ElasticHelper::stateId(row), projectIndex, row);
-                bulkOps.push_back(xattrStateVal);
-                std::string xattrOpVal = ElasticHelper::deleteXAttrOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-                bulkOps.push_back(xattrOpVal);
+                ElasticHelper::deleteXAttrFromState(mBulkOps, ElasticHelper::stateId(row), projectIndex, row);
+                ElasticHelper::deleteXAttrOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
               } break;
               default: {
                 LOG_WARN("file prov - unhandled prov state:" << datasetProvCore.get() << " - skipping it");
@@ -813,8 +626,7 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           case FileProvenanceConstants::MLType::EXPERIMENT_PART:
           case FileProvenanceConstants::MLType::MODEL_PART: {
             if (datasetProvCore.get() == FileProvenanceConstants::STORE_ALL) {
-              std::string op = ElasticHelper::fileOp(ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
-              bulkOps.push_back(op);
+              ElasticHelper::fileOp(mBulkOps, ElasticHelper::opId(row), projectIndex, row, mlAux.second, mlAux.first);
             }
           } break;
           default: {
@@ -822,11 +634,11 @@ ProcessRowResult FileProvenanceElasticDataReader::process_row(FileProvenanceRow
           }
         }
       }
-      return rowResult(bulkOps, row.getPK(), xattrBufferKey, fileOp);
+      return rowResult(row.getPK(), xattrBufferKey, fileOp);
     } break;
     default: {
       LOG_WARN("file prov - operation not implemented:" << row.mOperation);
-      return rowResult(bulkOps, row.getPK(), boost::none, fileOp);
+      return rowResult(row.getPK(), boost::none, fileOp);
     }
   }
 }
@@ -849,10 +661,9 @@ bool FileProvenanceElasticDataReader::projectExists(Int64 projectIId, Int64 time
   }
 }
 
-ProcessRowResult FileProvenanceElasticDataReader::rowResult(std::list<std::string> elasticOps, FileProvenancePK logPK,
+ProcessRowResult FileProvenanceElasticDataReader::rowResult(FileProvenancePK logPK,
                                   boost::optional<FPXAttrBufferPK> companionPK, FileProvenanceConstantsRaw::Operation provOp) {
   ProcessRowResult result;
-  result.mElasticOps = elasticOps;
   result.mLogPK = logPK;
   result.mCompanionPK = companionPK;
   result.mProvOp = provOp;
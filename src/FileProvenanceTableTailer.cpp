@@ -23,48 +23,41 @@ FileProvenanceTableTailer::FileProvenanceTableTailer(Ndb *ndb, Ndb* ndbRecovery,
         int prov_file_lru_cap, int prov_core_lru_cap)
 : RCTableTailer(ndb, ndbRecovery, new FileProvenanceLogTable(prov_file_lru_cap, prov_core_lru_cap), poll_maxTimeToWait, barrier) {
   mQueue = new CPRq();
-  mCurrentPriorityQueue = new PRpq();
 }
 
 void FileProvenanceTableTailer::handleEvent(NdbDictionary::Event::TableEvent eventType, FileProvenanceRow pre,
         FileProvenanceRow row) {
-  mLock.lock();
-  mCurrentPriorityQueue->push(row);
-  int size = mCurrentPriorityQueue->size();
-  mLock.unlock();
+  row.mEpoch = getEventEpoch();
+  mCurrentRows.push_back(row);
+  queued(row);
 
-  LOG_TRACE("file prov - push provenance log for [" << row.mInodeName << "] to queue[" << size << "], Op [" << row.mOperation << "]");
+  LOG_TRACE("file prov - push provenance log for [" << row.mInodeName << "] to queue[" << mCurrentRows.size() << "], Op [" << row.mOperation << "]");
 
 }
 
 void FileProvenanceTableTailer::barrierChanged() {
-  PRpq* pq = NULL;
-  mLock.lock();
-  if (!mCurrentPriorityQueue->empty()) {
-    pq = mCurrentPriorityQueue;
-    mCurrentPriorityQueue = new PRpq();
-  }
-  mLock.unlock();
-
-  if (pq != NULL) {
-    LOG_TRACE("file prov --------------------------------------NEW BARRIER (" << pq->size() << " events )------------------- ");
-    pushToQueue(pq);
+  if (mCurrentRows.empty()) {
+    return;
   }
+  Pq rows;
+  rows.swap(mCurrentRows);
+  LOG_TRACE("file prov --------------------------------------NEW BARRIER (" << rows.size() << " events )------------------- ");
+  radixSort<FILE_PROVENANCE_SORT_WORDS>(rows);
+  addToGroup(rows);
 }
 
 FileProvenanceRow FileProvenanceTableTailer::consume() {
   FileProvenanceRow row;
   mQueue->wait_and_pop(row);
+  dequeued(row);
   LOG_TRACE("file prov - pop inode [" << row.mInodeId << "] from queue \n" << row.to_string());
   return row;
 }
 
-void FileProvenanceTableTailer::pushToQueue(PRpq *curr) {
-  while (!curr->empty()) {
-    mQueue->push(curr->top());
-    curr->pop();
+void FileProvenanceTableTailer::pushToQueue(Pq& rows) {
+  for (FileProvenanceRow& row : rows) {
+    mQueue->push(std::move(row));
   }
-  delete curr;
 }
 
 FileProvenanceTableTailer::~FileProvenanceTableTailer() {
@@ -20,14 +20,15 @@
 #include "FsMutationsDataReader.h"
 #include "HopsworksOpsLogTailer.h"
 
-FsMutationsDataReader::FsMutationsDataReader(MConn connection, const bool hopsworks, const int lru_cap, const std::string search_index, const std::string featurestore_index)
-: NdbDataReader<FsMutationRow, MConn>(connection, hopsworks), mInodesTable(lru_cap), mDatasetTable(lru_cap), mProjectTable(lru_cap), mSearchIndex(search_index), mFeaturestoreIndex(featurestore_index) {
+FsMutationsDataReader::FsMutationsDataReader(MConn connection, const bool hopsworks, const int lru_cap, const std::string search_index, const std::string featurestore_index,
+    const int max_batches_in_flight)
+: NdbDataReader<FsMutationRow, MConn>(connection, hopsworks, max_batches_in_flight), mInodesTable(lru_cap), mDatasetTable(lru_cap), mProjectTable(lru_cap), mSearchIndex(search_index), mFeaturestoreIndex(featurestore_index) {
 }
 
 void FsMutationsDataReader::processAddedandDeleted(Fmq* data_batch, eBulk&
 bulk) {
 
-  INodeMap inodes = mInodesTable.get(mNdbConnection.hopsConnection, data_batch);
+  INodeMap inodes = getINodes(data_batch);
   XAttrMap xattrs = mXAttrTable.get(mNdbConnection.hopsConnection, data_batch);
   if (mHopsworksEnabled) {
     ULSet dataset_inode_ids;
@@ -38,6 +39,124 @@ bulk) {
     mDatasetTable.loadProjectIds(mNdbConnection.hopsworksConnection, dataset_inode_ids, mProjectTable);
   }
   createJSON(data_batch, inodes, xattrs, bulk);
+  removeSuperseded(data_batch, bulk);
+}
+
+struct CoalescedMutation {
+  Fmq::size_type mLatest;
+  bool mReplace;
+};
+
+void FsMutationsDataReader::coalesce(Fmq* data_batch) {
+  if (data_batch->size() < 2) {
+    return;
+  }
+
+  typedef boost::unordered_map<FsMutationKey, CoalescedMutation> CoalescedMap;
+  CoalescedMap latest;
+  for (Fmq::size_type i = 0; i < data_batch->size(); i++) {
+    FsMutationRow& row = (*data_batch)[i];
+    //a dataset change only updates the dataset of the document, it never
+    //supersedes the add, update or rename that creates the document
+    if (row.mOperation == FsChangeDataset) {
+      continue;
+    }
+    CoalescedMap::iterator it = latest.find(FsMutationKey(row));
+    if (it == latest.end()) {
+      CoalescedMutation m = {i, false};
+      latest[FsMutationKey(row)] = m;
+    } else if (row.mLogicalTime >= (*data_batch)[it->second.mLatest].mLogicalTime) {
+      it->second.mLatest = i;
+    }
+  }
+
+  if (latest.size() == data_batch->size()) {
+    return;
+  }
+
+  Fmq coalesced;
+  Fmq superseded;
+  for (Fmq::size_type i = 0; i < data_batch->size(); i++) {
+    FsMutationRow& row = (*data_batch)[i];
+    CoalescedMap::iterator it = latest.find(FsMutationKey(row));
+    if (row.mOperation == FsChangeDataset) {
+      //keep the dataset change unless the inode is deleted afterwards
+      if (it != latest.end()) {
+        FsMutationRow& latestRow = (*data_batch)[it->second.mLatest];
+        if (latestRow.mOperation == FsDelete
+            && latestRow.mLogicalTime >= row.mLogicalTime) {
+          superseded.push_back(row);
+          continue;
+        }
+      }
+      coalesced.push_back(row);
+      continue;
+    }
+    CoalescedMutation& m = it->second;
+    if (i == m.mLatest) {
+      coalesced.push_back(row);
+      continue;
+    }
+    if (row.mOperation == XAttrUpdate || row.mOperation == XAttrDelete) {
+      m.mReplace = true;
+    }
+    superseded.push_back(row);
+  }
+
+  if (superseded.empty()) {
+    return;
+  }
+
+  //an xattr that was updated or removed before being added again has to
+  //replace the old value instead of being merged into it
+  for (FsMutationRow& row : coalesced) {
+    if (row.mOperation == XAttrAdd && latest[FsMutationKey(row)].mReplace) {
+      row.mOperation = XAttrUpdate;
+    }
+  }
+
+  LOG_DEBUG("coalesced " << data_batch->size() << " fs mutations into "
+      << coalesced.size());
+  data_batch->swap(coalesced);
+  mSupersededMutations[data_batch].swap(superseded);
+}
+
+void FsMutationsDataReader::removeSuperseded(Fmq* data_batch, eBulk& bulk) {
+  boost::unordered_map<Fmq*, Fmq>::iterator it = mSupersededMutations.find(data_batch);
+  if (it == mSupersededMutations.end()) {
+    return;
+  }
+  //the superseded logs carry no document but are removed with the bulk
+  for (FsMutationRow& row : it->second) {
+    bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime, "", 0);
+  }
+  mSupersededMutations.erase(it);
+}
+
+int FsMutationsDataReader::prefetch(Fmq* data_batch) {
+  AsyncRead* read = new AsyncRead();
+  if (!mInodesTable.prepareGet(mNdbConnection.hopsConnection, data_batch, read)) {
+    delete read;
+    return 0;
+  }
+  mPrefetchedINodes[data_batch] = read;
+  return 1;
+}
+
+void FsMutationsDataReader::waitForPrefetched(int transactions) {
+  DBTableBase::waitForAsyncTransactions(mNdbConnection.hopsConnection, transactions);
+}
+
+INodeMap FsMutationsDataReader::getINodes(Fmq* data_batch) {
+  boost::unordered_map<Fmq*, AsyncRead*>::iterator it = mPrefetchedINodes.find(data_batch);
+  if (it == mPrefetchedINodes.end()) {
+    return mInodesTable.get(mNdbConnection.hopsConnection, data_batch);
+  }
+  AsyncRead* read = it->second;
+  mPrefetchedINodes.erase(it);
+  INodeMap inodes = mInodesTable.completeGet(mNdbConnection.hopsConnection, data_batch, read);
+  delete read;
+  return inodes;
 }
 
 void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
@@ -48,10 +167,11 @@ void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
 
     if (row.isINodeOperation()) {
       if (!row.requiresReadingINode()) {
-        bulk.push(nullptr, row.mEventCreationTime, INodeRow::to_delete_json(mFeaturestoreIndex, row.mInodeId));
+        bulk.push(nullptr, row.mEventCreationTime, INodeRow::to_delete_json(mFeaturestoreIndex, row.mInodeId), 1);
         //Handle the delete and change dataset
         bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime,
-                INodeRow::to_delete_change_dataset_json(mSearchIndex, row));
+                INodeRow::to_delete_change_dataset_json(mSearchIndex, row),
+                INodeRow::delete_change_dataset_items(row));
         continue;
       }
 
@@ -59,9 +179,9 @@ void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
         LOG_DEBUG(
             " Data for inode: " << row.getParentId() << ", " << row
             .getINodeName() << ", " << row.mInodeId << " was not found");
-        bulk.push(nullptr, row.mEventCreationTime, INodeRow::to_delete_json(mFeaturestoreIndex, row.mInodeId));
+        bulk.push(nullptr, row.mEventCreationTime, INodeRow::to_delete_json(mFeaturestoreIndex, row.mInodeId), 1);
         bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime,
-                  INodeRow::to_delete_json(mSearchIndex, row.mInodeId));
+                  INodeRow::to_delete_json(mSearchIndex, row.mInodeId), 1);
         continue;
       }
 
@@ -82,14 +202,14 @@ void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
             LOG_DEBUG("featurestore type:" << docType << "name:" << nameParts.get().first << " version:" << std::to_string(nameParts.get().second));
             bulk.push(nullptr, row.mEventCreationTime,
                     FSMutationsJSONBuilder::featurestoreDoc(mFeaturestoreIndex, docType, inode.mId, nameParts.get().first,
-                            nameParts.get().second, projectId, projectName, datasetINodeId));
+                            nameParts.get().second, projectId, projectName, datasetINodeId), 1);
           }
         }
       }
 
       //FsAdd, FsUpdate, FsRename are handled the same way
       bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime,
-                inode.to_create_json(mSearchIndex, datasetINodeId, projectId));
+                inode.to_create_json(mSearchIndex, datasetINodeId, projectId), 1);
     } else if (row.isXAttrOperation()) {
       Int64 datasetINodeId = DONT_EXIST_INT();
       int projectId = DONT_EXIST_INT();
@@ -105,9 +225,9 @@ void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
       if (!row.requiresReadingXAttr()) {
         //handle delete xattr
         if(FileProvenanceConstants::isPartOfFeaturestore(row.mInodeParentId, datasetINodeId, projectName, datasetName) != DONT_EXIST_STR()) {
-          bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row));
+          bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row), 1);
         }
-        bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row));
+        bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row), 1);
         continue;
       }
 
@@ -118,9 +238,9 @@ void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
         << row.getNamespace() <<  " for inode " << row.mInodeId
         << " was not found");
         if(FileProvenanceConstants::isPartOfFeaturestore(row.mInodeParentId, datasetINodeId, projectName, datasetName) != DONT_EXIST_STR()) {
-          bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row));
+          bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row), 1);
         }
-        bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row));
+        bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row), 1);
         continue;
       }
 
@@ -129,9 +249,9 @@ void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
         LOG_DEBUG(" Data for all xattrs of inode " << row.mInodeId
                                       << " was not found");
         if(FileProvenanceConstants::isPartOfFeaturestore(row.mInodeParentId, datasetINodeId, projectName, datasetName) != DONT_EXIST_STR()) {
-          bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row));
+          bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row), 1);
         }
-        bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row));
+        bulk.push(mFSLogTable.getLogRemovalHandler(row), row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row), 1);
         continue;
       }
 
@@ -144,18 +264,20 @@ void FsMutationsDataReader::createJSON(Fmq* pending, INodeMap& inodes,
             boost::optional<std::pair<std::string, int>> nameParts = FileProvenanceConstants::splitNameVersion(row.mInodeName);
             if(nameParts) {
 //              LOG_INFO("featurestore name:" << nameParts.get().first << " version:" << nameParts.get().second << " xattr:" << row.getXAttrName());
-              bulk.push(nullptr, row.mEventCreationTime, xAttrRow.to_upsert_json(mFeaturestoreIndex, row.mOperation));
+              bulk.push(nullptr, row.mEventCreationTime, xAttrRow.to_upsert_json(mFeaturestoreIndex, row.mOperation),
+                  XAttrRow::upsert_items(row.mOperation));
             }
           }
-          bulk.push(logh, row.mEventCreationTime, xAttrRow.to_upsert_json(mSearchIndex, row.mOperation));
+          bulk.push(logh, row.mEventCreationTime, xAttrRow.to_upsert_json(mSearchIndex, row.mOperation),
+              XAttrRow::upsert_items(row.mOperation));
         } else {
           LOG_DEBUG(" Data for xattr: " << row.getXAttrName() << ", "
           << row.getNamespace() <<  " for inode " << row.mInodeId
           << " was not ""found");
           if(FileProvenanceConstants::isPartOfFeaturestore(row.mInodeParentId, datasetINodeId, projectName, datasetName) != DONT_EXIST_STR()) {
-            bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row));
+            bulk.push(nullptr, row.mEventCreationTime, XAttrRow::to_delete_json(mFeaturestoreIndex, row), 1);
           }
-          bulk.push(logh, row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row));
+          bulk.push(logh, row.mEventCreationTime, XAttrRow::to_delete_json(mSearchIndex, row), 1);
         }
       }
     }else{
@@ -23,22 +23,23 @@
 //const static ptime EPOCH_TIME(boost::gregorian::date(1970,1,1)); 
 
 FsMutationsTableTailer::FsMutationsTableTailer(Ndb* ndb, Ndb* ndbRecovery,
-    const int poll_maxTimeToWait, const Barrier barrier) : RCTableTailer(ndb,
-        ndbRecovery, new FsMutationsLogTable(), poll_maxTimeToWait, barrier) {
-  mQueue = new CFSq();
-  mCurrentPriorityQueue = new FSpq();
+    const int poll_maxTimeToWait, const Barrier barrier, const int num_queues)
+    : RCTableTailer(ndb, ndbRecovery, new FsMutationsLogTable(),
+        poll_maxTimeToWait, barrier), mNumQueues(std::max(num_queues, 1)) {
+  for (int i = 0; i < mNumQueues; i++) {
+    mQueues.push_back(new CFSq());
+  }
   //    mTimeTakenForEventsToArrive = 0;
   //    mNumOfEvents = 0;
   //    mPrintEveryNEvents = 0;
 }
 
 void FsMutationsTableTailer::handleEvent(NdbDictionary::Event::TableEvent eventType, FsMutationRow pre, FsMutationRow row) {
-  mLock.lock();
-  mCurrentPriorityQueue->push(row);
-  int size = mCurrentPriorityQueue->size();
-  mLock.unlock();
+  row.mEpoch = getEventEpoch();
+  mCurrentRows.push_back(row);
+  queued(row);
 
-  LOG_DEBUG("push inode [" << row.getINodeName() << "] to queue[" << size <<
+  LOG_DEBUG("push inode [" << row.getINodeName() << "] to queue[" << mCurrentRows.size() <<
   "], Op [" << FsOpTypeToStr(row.mOperation) << "]");
   
   //    ptime t = EPOCH_TIME + boost::posix_time::milliseconds(row.mTimestamp);
@@ -53,37 +54,53 @@ void FsMutationsTableTailer::handleEvent(NdbDictionary::Event::TableEvent eventT
 }
 
 void FsMutationsTableTailer::barrierChanged() {
-  FSpq* pq = NULL;
-  mLock.lock();
-  if (!mCurrentPriorityQueue->empty()) {
-    pq = mCurrentPriorityQueue;
-    mCurrentPriorityQueue = new FSpq();
-  }
-  mLock.unlock();
-
-  if (pq != NULL) {
-    LOG_TRACE("--------------------------------------NEW BARRIER (" << pq->size() << " events )------------------- ");
-    pushToQueue(pq);
+  if (mCurrentRows.empty()) {
+    return;
   }
+  Fmq rows;
+  rows.swap(mCurrentRows);
+  LOG_TRACE("--------------------------------------NEW BARRIER (" << rows.size() << " events )------------------- ");
+  radixSort<FS_MUTATION_SORT_WORDS>(rows);
+  addToGroup(rows);
 }
 
 FsMutationRow FsMutationsTableTailer::consume() {
+  return consumeMultiQueue(0);
+}
+
+FsMutationRow FsMutationsTableTailer::consumeMultiQueue(int queue_id) {
+  if (queue_id == SINGLE_QUEUE) {
+    queue_id = 0;
+  }
   FsMutationRow row;
-  mQueue->wait_and_pop(row);
-  LOG_DEBUG(" pop inode [" << row.mInodeId << "] from queue \n" << row.to_string());
+  mQueues[queue_id]->wait_and_pop(row);
+  dequeued(row);
+  LOG_DEBUG(" pop inode [" << row.mInodeId << "] from queue [" << queue_id
+      << "] \n" << row.to_string());
   return row;
 }
 
+int FsMutationsTableTailer::getNumQueues() const {
+  return mNumQueues;
+}
+
+int FsMutationsTableTailer::getQueueId(const FsMutationRow& row) const {
+  if (mNumQueues == 1) {
+    return 0;
+  }
+  return static_cast<Uint64>(row.mInodeId) % mNumQueues;
+}
+
 
-void FsMutationsTableTailer::pushToQueue(FSpq* curr) {
-  while (!curr->empty()) {
-    mQueue->push(curr->top());
-    curr->pop();
+void FsMutationsTableTailer::pushToQueue(Fmq& rows) {
+  for (FsMutationRow& row : rows) {
+    mQueues[getQueueId(row)]->push(std::move(row));
   }
-  delete curr;
 }
 
 FsMutationsTableTailer::~FsMutationsTableTailer() {
-  delete mQueue;
+  for (CFSq* queue : mQueues) {
+    delete queue;
+  }
 }
 
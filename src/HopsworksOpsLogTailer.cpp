@@ -54,7 +54,7 @@ void HopsworksOpsLogTailer::handleDataset(ptime arrivalTime, eBulk &bulk, Hopswo
     json = dataset.to_upsert_json(mSearchIndex);
     eventType = logEvent.mOpType == HopsworksAdd ? eEvent::EventType::AddEvent : eEvent::EventType::UpdateEvent;
   }
-  bulk.push(mHopsworksLogTable.getLogRemovalHandler(logEvent), arrivalTime, json, eventType, eEvent::AssetType::Dataset);
+  bulk.push(mHopsworksLogTable.getLogRemovalHandler(logEvent), arrivalTime, json, 1, eventType, eEvent::AssetType::Dataset);
 }
 
 void HopsworksOpsLogTailer::handleProject(ptime arrivalTime, eBulk &bulk, HopsworksOpRow logEvent){
@@ -69,7 +69,12 @@ void HopsworksOpsLogTailer::handleProject(ptime arrivalTime, eBulk &bulk, Hopswo
     json = project.to_upsert_json(mSearchIndex, logEvent.mInodeId);
     eventType = logEvent.mOpType == HopsworksAdd ? eEvent::EventType::AddEvent : eEvent::EventType::UpdateEvent;
   }
-  bulk.push(mHopsworksLogTable.getLogRemovalHandler(logEvent), arrivalTime, json, eventType, eEvent::AssetType::Project);
+  bulk.push(mHopsworksLogTable.getLogRemovalHandler(logEvent), arrivalTime, json, 1, eventType, eEvent::AssetType::Project);
+}
+
+void HopsworksOpsLogTailer::waitForCapacity() {
+  MemoryBudget::getInstance().waitForCapacity(mHopsworksLogTable.getName(),
+      getHeldBytes(), [this]{ return checkEventBuffer(); });
 }
 
 HopsworksOpsLogTailer::~HopsworksOpsLogTailer(){
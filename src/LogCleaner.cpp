@@ -0,0 +1,143 @@
+/*
+ * This file is part of ePipe
+ * Copyright (C) 2019, Logical Clocks AB. All rights reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "LogCleaner.h"
+
+LogCleaner::LogCleaner(const std::string pipe_name, LogRemover* remover)
+: mPipeName(pipe_name), mRemover(remover), mCheckpoint(nullptr), mStarted(false), mShutdown(false),
+mPending(0), mRemoved(0), mMissing(0), mBatches(0), mLagMS(0) {
+}
+
+void LogCleaner::start() {
+  if (mStarted) {
+    return;
+  }
+  mThread = boost::thread(&LogCleaner::run, this);
+  mStarted = true;
+}
+
+void LogCleaner::add(std::vector<const LogHandler*>& handlers) {
+  LogCleanerJob job;
+  for (const LogHandler* handler : handlers) {
+    if (handler != nullptr) {
+      job.mHandlers.push_back(handler);
+    }
+  }
+  if (job.mHandlers.empty()) {
+    return;
+  }
+  job.mEnqueueTime = Utils::getCurrentTime();
+  mPending += job.mHandlers.size();
+  mQueue.push(std::move(job));
+}
+
+void LogCleaner::add(const LogHandler* handler) {
+  std::vector<const LogHandler*> handlers(1, handler);
+  add(handlers);
+}
+
+void LogCleaner::setCheckpoint(EpochCheckpoint* checkpoint) {
+  mCheckpoint = checkpoint;
+}
+
+void LogCleaner::shutdown() {
+  if (!mStarted || mShutdown) {
+    return;
+  }
+  mShutdown = true;
+  // wake up the cleaner thread to drain the queue
+  mQueue.push(LogCleanerJob());
+  mThread.join();
+  LOG_INFO(mPipeName << " log cleaner stopped, " << mRemoved
+      << " logs removed");
+}
+
+void LogCleaner::run() {
+  while (true) {
+    LogCleanerJob job;
+    mQueue.wait_and_pop(job);
+    ptime oldest = job.mEnqueueTime;
+    std::vector<const LogHandler*> handlers;
+    handlers.swap(job.mHandlers);
+    while (handlers.size() < LOG_CLEANER_MAX_BATCH && mQueue.try_pop(job)) {
+      handlers.insert(handlers.end(), job.mHandlers.begin(),
+          job.mHandlers.end());
+      if (oldest.is_not_a_date_time()) {
+        oldest = job.mEnqueueTime;
+      }
+    }
+
+    if (!handlers.empty()) {
+      removeLogs(handlers);
+      mLagMS = Utils::getTimeDiffInMilliseconds(oldest,
+          Utils::getCurrentTime());
+    }
+
+    if (mShutdown && mQueue.empty()) {
+      if (mCheckpoint != nullptr) {
+        mCheckpoint->persist(true);
+      }
+      break;
+    }
+
+    if (mCheckpoint != nullptr) {
+      mCheckpoint->persist();
+    }
+  }
+}
+
+void LogCleaner::removeLogs(std::vector<const LogHandler*>& handlers) {
+  std::vector<const LogHandler*>::iterator it = handlers.begin();
+  while (it != handlers.end()) {
+    std::vector<const LogHandler*>::iterator end = it + std::min(
+        static_cast<std::ptrdiff_t>(LOG_CLEANER_MAX_BATCH), handlers.end() - it);
+    std::vector<const LogHandler*> batch(it, end);
+    int missing = std::min(mRemover->removeLogs(batch),
+        static_cast<int>(batch.size()));
+    LOG_DEBUG(mPipeName << " log cleaner removed " << batch.size()
+        << " logs, " << missing << " were already removed");
+    mMissing += missing;
+    mRemoved += batch.size() - missing;
+    mPending -= batch.size();
+    mBatches++;
+    if (mCheckpoint != nullptr) {
+      mCheckpoint->removed(batch);
+    }
+    it = end;
+  }
+}
+
+std::string LogCleaner::getMetrics() {
+  std::stringstream out;
+  out << "epipe_" << mPipeName << "_log_cleanup_lag_milliseconds " << mLagMS
+      << std::endl;
+  out << "epipe_" << mPipeName << "_log_cleanup_pending " << mPending
+      << std::endl;
+  out << "epipe_" << mPipeName << "_log_cleanup_removed_total " << mRemoved
+      << std::endl;
+  out << "epipe_" << mPipeName << "_log_cleanup_missing_total " << mMissing
+      << std::endl;
+  out << "epipe_" << mPipeName << "_log_cleanup_batches_total " << mBatches
+      << std::endl;
+  return out.str();
+}
+
+LogCleaner::~LogCleaner() {
+  shutdown();
+}
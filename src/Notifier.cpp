@@ -21,23 +21,30 @@
 
 Notifier::Notifier(const char* connection_string, const char* database_name,
     const char* meta_database_name, const char* hive_meta_database_name,
-        const TableUnitConf mutations_tu,
+        const TableUnitConf mutations_tu, const int mutations_partitions,
         const TableUnitConf elastic_provenance_tu, const int poll_maxTimeToWait,
         const HttpClientConfig elastic_client_config, const bool hopsworks,
         const std::string elastic_search_index, const std::string elastic_featurestore_index,
         const std::string elastic_app_provenance_index,
-        const int elastic_batch_size, const int elastic_issue_time,
-        const int lru_cap, const int prov_file_lru_cap, const int prov_core_lru_cap, const bool recovery,
-        const bool stats, Barrier barrier, const bool hiveCleaner, const
-        std::string metricsServer)
+        const int elastic_batch_size, const int elastic_issue_time, const int elastic_max_in_flight,
+        const int batch_target_latency, const int elastic_max_bulk, const int memory_budget_mb, const int lru_cap, const int prov_file_lru_cap, const int prov_core_lru_cap,
+        const int ndb_async_batches, const bool recovery,
+        const bool stats, Barrier barrier, const EpochGroupConf epoch_group, const EventSourceConf event_source,
+        const std::string checkpoint_dir, const bool hiveCleaner, const std::string metricsServer)
 : ClusterConnectionBase(connection_string, database_name, meta_database_name, hive_meta_database_name), 
-    mMutationsTU(mutations_tu), mFileProvenanceTU(elastic_provenance_tu), mAppProvenanceTU(elastic_provenance_tu),
+    mMutationsTU(mutations_tu), mMutationsPartitions(std::max(mutations_partitions, 1)),
+    mFileProvenanceTU(elastic_provenance_tu), mAppProvenanceTU(elastic_provenance_tu),
     mPollMaxTimeToWait(poll_maxTimeToWait),  mElasticClientConfig(elastic_client_config), mHopsworksEnabled(hopsworks),
     mElasticSearchIndex(elastic_search_index), mElasticFeaturestoreIndex(elastic_featurestore_index),
     mElasticAppProvenanceIndex(elastic_app_provenance_index),
     mElasticBatchsize(elastic_batch_size), mElasticIssueTime(elastic_issue_time),
+    mElasticMaxInFlight(elastic_max_in_flight), mBatchTargetLatency(batch_target_latency),
+    mElasticMaxBulk(elastic_max_bulk), mMemoryBudgetMB(memory_budget_mb),
     mLRUCap(lru_cap), mProvFileLRUCap(prov_file_lru_cap), mProvCoreLRUCap(prov_core_lru_cap),
-    mRecovery(recovery), mStats(stats), mBarrier(barrier), mHiveCleaner(hiveCleaner), mMetricsServer(metricsServer) {
+    mNdbAsyncBatches(ndb_async_batches),
+    mRecovery(recovery), mStats(stats), mBarrier(barrier), mEpochGroup(epoch_group),
+    mEventSource(event_source), mCheckpointDir(checkpoint_dir),
+    mHiveCleaner(hiveCleaner), mMetricsServer(metricsServer) {
   setup();
 }
 
@@ -46,8 +53,10 @@ void Notifier::start() {
   ptime t1 = getCurrentTime();
 
   if (mMutationsTU.isEnabled()) {
-    mFsMutationsDataReaders->start();
-    mFsMutationsBatcher->start();
+    for (int i = 0; i < mMutationsPartitions; i++) {
+      mFsMutationsDataReaders[i]->start();
+      mFsMutationsBatchers[i]->start();
+    }
     mFsMutationsTableTailer->start();
   }
 
@@ -93,7 +102,9 @@ void Notifier::start() {
   }
 
   if (mMutationsTU.isEnabled()) {
-    mFsMutationsBatcher->waitToFinish();
+    for (FsMutationsBatcher* batcher : mFsMutationsBatchers) {
+      batcher->waitToFinish();
+    }
     mFsMutationsTableTailer->waitToFinish();
   }
 
@@ -131,13 +142,15 @@ void Notifier::start() {
 }
 
 void Notifier::setup() {
+  MemoryBudget::getInstance().setLimit(static_cast<Uint64>(mMemoryBudgetMB) * 1024 * 1024);
+
   if (mMutationsTU.isEnabled() || mHopsworksEnabled) {
     MConn ndb_connections_elastic;
     ndb_connections_elastic.hopsworksConnection = create_ndb_connection(mMetaDatabaseName);
     ndb_connections_elastic.hopsConnection = create_ndb_connection(mDatabaseName);
 
     mProjectsElasticSearch = new ProjectsElasticSearch(mElasticClientConfig,
-            mElasticIssueTime, mElasticBatchsize, mStats, ndb_connections_elastic);
+            mElasticIssueTime, mElasticBatchsize, mElasticMaxInFlight, mStats, ndb_connections_elastic);
   }
 
 
@@ -147,18 +160,34 @@ void Notifier::setup() {
         create_ndb_connection(mDatabaseName) : nullptr;
 
     mFsMutationsTableTailer = new FsMutationsTableTailer(mutations_tailer_connection,
-        mutations_tailer_recovery_connection, mPollMaxTimeToWait, mBarrier);
-
-    MConn* mutations_connections = new MConn[mMutationsTU.mNumReaders];
-    for (int i = 0; i < mMutationsTU.mNumReaders; i++) {
-      mutations_connections[i].hopsConnection = create_ndb_connection(mDatabaseName);
-      mutations_connections[i].hopsworksConnection = create_ndb_connection(mMetaDatabaseName);
+        mutations_tailer_recovery_connection, mPollMaxTimeToWait, mBarrier,
+        mMutationsPartitions);
+    mFsMutationsTableTailer->setEventSource(mEventSource);
+    mFsMutationsTableTailer->setEpochGrouping(mEpochGroup);
+    setupCheckpoint(mFsMutationsTableTailer, LogType::FSLOG, mProjectsElasticSearch);
+
+    for (int p = 0; p < mMutationsPartitions; p++) {
+      MConn* mutations_connections = new MConn[mMutationsTU.mNumReaders];
+      for (int i = 0; i < mMutationsTU.mNumReaders; i++) {
+        mutations_connections[i].hopsConnection = create_ndb_connection(mDatabaseName);
+        mutations_connections[i].hopsworksConnection = create_ndb_connection(mMetaDatabaseName);
+      }
+
+      int partition = mMutationsPartitions > 1 ? p : SINGLE_QUEUE;
+      FsMutationsDataReaders* data_readers = new FsMutationsDataReaders(mutations_connections,
+              mMutationsTU.mNumReaders, mHopsworksEnabled, mProjectsElasticSearch, mLRUCap,
+              mElasticSearchIndex, mElasticFeaturestoreIndex, mNdbAsyncBatches, partition);
+      mFsMutationsDataReaders.push_back(data_readers);
+      mFsMutationsBatchers.push_back(new FsMutationsBatcher(mFsMutationsTableTailer,
+              data_readers, mMutationsTU.mWaitTime, mMutationsTU.mBatchSize, partition));
     }
-
-    mFsMutationsDataReaders = new FsMutationsDataReaders(mutations_connections, mMutationsTU.mNumReaders,
-            mHopsworksEnabled, mProjectsElasticSearch, mLRUCap, mElasticSearchIndex, mElasticFeaturestoreIndex);
-    mFsMutationsBatcher = new FsMutationsBatcher(mFsMutationsTableTailer, mFsMutationsDataReaders,
-            mMutationsTU.mWaitTime, mMutationsTU.mBatchSize);
+    BatchController* controller = createBatchController("fs", mProjectsElasticSearch);
+    for (int p = 0; controller != nullptr && p < mMutationsPartitions; p++) {
+      controller->addBatcher(mFsMutationsBatchers[p], BatchController::Stage::Ndb,
+          getPartitionStage("batcher", mMutationsPartitions > 1 ? p : SINGLE_QUEUE));
+    }
+    LOG_INFO("fs mutations are processed by " << mMutationsPartitions
+        << " pipelines partitioned by dataset");
   }
 
   if (mHopsworksEnabled) {
@@ -168,41 +197,54 @@ void Notifier::setup() {
     mhopsworksOpsLogTailer = new HopsworksOpsLogTailer(ops_log_tailer_connection,
         ops_log_tailer_recovery_connection, mPollMaxTimeToWait, mBarrier,
             mProjectsElasticSearch, mLRUCap, mElasticSearchIndex);
+    mhopsworksOpsLogTailer->setEventSource(mEventSource);
   }
 
   if (mFileProvenanceTU.isEnabled()) {
     //file
     Ndb* ndb_elastic_file_provenance_conn = create_ndb_connection(mDatabaseName);
     mFileProvenanceElastic = new FileProvenanceElastic(mElasticClientConfig,
-      mElasticIssueTime, mElasticBatchsize, mStats, ndb_elastic_file_provenance_conn, mProvFileLRUCap, mProvCoreLRUCap);
+      mElasticIssueTime, mElasticBatchsize, mElasticMaxInFlight, mStats, ndb_elastic_file_provenance_conn,
+      mProvFileLRUCap, mProvCoreLRUCap);
 
     Ndb* elastic_file_provenance_tailer_connection = create_ndb_connection(mDatabaseName);
     Ndb* elastic_file_provenance_tailer_recovery_connection = mRecovery ? create_ndb_connection(mDatabaseName) : nullptr;
     mFileProvenanceTableTailer = new FileProvenanceTableTailer(
         elastic_file_provenance_tailer_connection, elastic_file_provenance_tailer_recovery_connection,
         mPollMaxTimeToWait, mBarrier, mProvFileLRUCap, mProvCoreLRUCap);
+    mFileProvenanceTableTailer->setEventSource(mEventSource);
+    mFileProvenanceTableTailer->setEpochGrouping(mEpochGroup);
+    setupCheckpoint(mFileProvenanceTableTailer, LogType::PROVFILELOG, mFileProvenanceElastic);
 
     SConn* file_prov_hops_connections = new SConn[mFileProvenanceTU.mNumReaders];
     for (int i = 0; i < mFileProvenanceTU.mNumReaders; i++) {
       file_prov_hops_connections[i] = create_ndb_connection(mDatabaseName);
     }
     mFileProvenanceElasticDataReaders = new FileProvenanceElasticDataReaders(file_prov_hops_connections,
-      mFileProvenanceTU.mNumReaders, mHopsworksEnabled, mFileProvenanceElastic, mProvFileLRUCap, mProvCoreLRUCap, mLRUCap);
+      mFileProvenanceTU.mNumReaders, mHopsworksEnabled, mFileProvenanceElastic, mProvFileLRUCap, mProvCoreLRUCap, mLRUCap,
+      mNdbAsyncBatches);
     mFileProvenanceBatcher = new RCBatcher<FileProvenanceRow, SConn>(
       mFileProvenanceTableTailer, mFileProvenanceElasticDataReaders,
       mFileProvenanceTU.mWaitTime, mFileProvenanceTU.mBatchSize);
+    BatchController* controller = createBatchController("file_prov", mFileProvenanceElastic);
+    if (controller != nullptr) {
+      controller->addBatcher(mFileProvenanceBatcher, BatchController::Stage::Ndb, "batcher");
+    }
   }
   if (mAppProvenanceTU.isEnabled()) {
     //app
     Ndb* ndb_elastic_app_provenance_conn = create_ndb_connection(mDatabaseName);
     mAppProvenanceElastic = new AppProvenanceElastic(mElasticClientConfig, mElasticAppProvenanceIndex,
-      mElasticIssueTime, mElasticBatchsize, mStats, ndb_elastic_app_provenance_conn);
+      mElasticIssueTime, mElasticBatchsize, mElasticMaxInFlight, mStats, ndb_elastic_app_provenance_conn);
 
     Ndb* elastic_app_provenance_tailer_connection = create_ndb_connection(mDatabaseName);
     Ndb* elastic_app_provenance_tailer_recovery_connection = mRecovery ? create_ndb_connection(mDatabaseName) : nullptr;
     mAppProvenanceTableTailer = new AppProvenanceTableTailer(
         elastic_app_provenance_tailer_connection, elastic_app_provenance_tailer_recovery_connection,
         mPollMaxTimeToWait, mBarrier);
+    mAppProvenanceTableTailer->setEventSource(mEventSource);
+    mAppProvenanceTableTailer->setEpochGrouping(mEpochGroup);
+    setupCheckpoint(mAppProvenanceTableTailer, LogType::PROVAPPLOG, mAppProvenanceElastic);
 
     SConn* elastic_app_provenance_connections = new SConn[mAppProvenanceTU.mNumReaders];
     for (int i = 0; i < mAppProvenanceTU.mNumReaders; i++) {
@@ -213,6 +255,10 @@ void Notifier::setup() {
     mAppProvenanceBatcher = new RCBatcher<AppProvenanceRow, SConn>(
       mAppProvenanceTableTailer, mAppProvenanceElasticDataReaders,
       mAppProvenanceTU.mWaitTime, mAppProvenanceTU.mBatchSize);
+    BatchController* controller = createBatchController("app_prov", mAppProvenanceElastic);
+    if (controller != nullptr) {
+      controller->addBatcher(mAppProvenanceBatcher, BatchController::Stage::Ndb, "batcher");
+    }
   }
 
 
@@ -262,21 +308,59 @@ void Notifier::setup() {
     std::vector<MetricsProvider*> providers;
     if(mMutationsTU.isEnabled()){
       providers.push_back(mProjectsElasticSearch);
+      providers.push_back(mFsMutationsTableTailer);
     }
     if(mFileProvenanceTU.isEnabled()){
       providers.push_back(mFileProvenanceElastic);
+      providers.push_back(mFileProvenanceTableTailer);
     }
     if(mAppProvenanceTU.isEnabled()){
       providers.push_back(mAppProvenanceElastic);
+      providers.push_back(mAppProvenanceTableTailer);
     }
+    providers.insert(providers.end(), mBatchControllers.begin(), mBatchControllers.end());
+    providers.insert(providers.end(), mCheckpoints.begin(), mCheckpoints.end());
+    providers.push_back(&MemoryBudget::getInstance());
     mMetricsProviders = new MetricsProviders(providers);
     mHttpServer = new HttpServer(mMetricsServer, *mMetricsProviders);
   }
 }
 
+BatchController* Notifier::createBatchController(const std::string pipe_name,
+    TimedRestBatcher* elastic) {
+  if (mBatchTargetLatency <= 0) {
+    return nullptr;
+  }
+  BatchController* controller = new BatchController(pipe_name,
+      mBatchTargetLatency, mElasticMaxBulk);
+  controller->addBatcher(elastic, BatchController::Stage::Elastic, "elastic");
+  elastic->setBatchController(controller);
+  mBatchControllers.push_back(controller);
+  return controller;
+}
+
+template<typename TableRow>
+void Notifier::setupCheckpoint(RCTableTailer<TableRow>* tailer, LogType type,
+    ElasticSearchBase* elastic) {
+  // without recovery the rows left in the table are never replayed, so the
+  // checkpoint would skip them on the next recovery
+  if (mCheckpointDir.empty() || !mRecovery || mEventSource.mMode == REPLAY) {
+    return;
+  }
+  EpochCheckpoint* checkpoint = new EpochCheckpoint(mCheckpointDir,
+      tailer->getTableName(), type);
+  tailer->setCheckpoint(checkpoint);
+  elastic->setCheckpoint(checkpoint);
+  mCheckpoints.push_back(checkpoint);
+}
+
 Notifier::~Notifier() {
   delete mFsMutationsTableTailer;
-  delete mFsMutationsDataReaders;
-  delete mFsMutationsBatcher;
+  for (FsMutationsDataReaders* data_readers : mFsMutationsDataReaders) {
+    delete data_readers;
+  }
+  for (FsMutationsBatcher* batcher : mFsMutationsBatchers) {
+    delete batcher;
+  }
   ndb_end(2);
 }
@@ -23,47 +23,64 @@ using namespace Utils;
 
 ProjectsElasticSearch::ProjectsElasticSearch(const HttpClientConfig elastic_client_config,
         int time_to_wait_before_inserting,
-        int bulk_size, const bool stats, MConn conn) : ElasticSearchBase
-        (elastic_client_config, time_to_wait_before_inserting, bulk_size, stats,
-         new MovingCountersBulkSet("fs")),
+        int bulk_size, int max_in_flight_batches, const bool stats, MConn conn) : ElasticSearchBase
+        (elastic_client_config, time_to_wait_before_inserting, bulk_size,
+         max_in_flight_batches, "fs", stats, new MovingCountersBulkSet("fs")),
          mConn(conn) {
   mElasticBulkAddr = getElasticSearchBulkUrl();
 }
 
-void ProjectsElasticSearch::process(std::vector<eBulk>* bulks) {
+bool ProjectsElasticSearch::send(std::vector<eBulk>* bulks) {
+  HttpBufferChain batch;
+  for (auto it = bulks->begin(); it != bulks->end();++it) {
+    it->appendBuffers(batch);
+  }
+  ParsingResponse response = httpPostRequest(mElasticBulkAddr, batch);
+  if (!response.mSuccess) {
+    setBulkItemStatus(bulks, response);
+  }
+  return response.mSuccess;
+}
+
+void ProjectsElasticSearch::acknowledge(std::vector<eBulk>* bulks, bool sent,
+    ptime start_time) {
   std::vector<const LogHandler*> logRHandlers;
-  std::string batch;
-  int fslogs=0, hopsworkslogs=0;
   for (auto it = bulks->begin(); it != bulks->end();++it) {
-    eBulk bulk = *it;
-    LOG_DEBUG(bulk.toString());
-    batch += bulk.batchJSON();
+    const eBulk& bulk = *it;
     logRHandlers.insert(logRHandlers.end(), bulk.mLogHandlers.begin(),
         bulk.mLogHandlers.end());
-    fslogs += bulk.getCount(LogType::FSLOG);
-    hopsworkslogs += bulk.getCount(LogType::HOPSWORKSLOG);
     if(mStats){
       mCounters->bulkReceived(bulk);
     }
   }
 
-  ptime start_time = Utils::getCurrentTime();
-  if (httpPostRequest(mElasticBulkAddr, batch).mSuccess) {
-    if (fslogs > 0) {
-      FsMutationsLogTable().removeLogs(mConn.hopsConnection, logRHandlers);
-    }
-
-    if(hopsworkslogs > 0){
-      HopsworksOpsLogTable().removeLogs(mConn.hopsworksConnection, logRHandlers);
-    }
+  if (sent) {
+    cleanLogs(logRHandlers);
 
     if (mStats) {
       mCounters->bulksProcessed(start_time, bulks);
     }
   }else{
-    for (auto it = bulks->begin(); it != bulks->end();++it) {
-      eBulk bulk = *it;
-      for(eEvent event : bulk.mEvents){
+    //only the events with failed items are retried, the logs of the others
+    //are removed right away
+    std::vector<const LogHandler*> ackedHandlers;
+    for (eBulk& bulk : *bulks) {
+      for(eEvent& event : bulk.mEvents){
+        if(event.getItemStatus() == eEvent::ItemStatus::ItemSucceeded){
+          ackedHandlers.push_back(event.getLogHandler());
+        }
+      }
+    }
+    cleanLogs(ackedHandlers);
+
+    for (eBulk& bulk : *bulks) {
+      for(eEvent& event : bulk.mEvents){
+        if(event.getItemStatus() == eEvent::ItemStatus::ItemSucceeded){
+          continue;
+        }
+        if(event.getItemStatus() == eEvent::ItemStatus::ItemFailed){
+          LOG_WARN("Retry failed bulk item (" << event.getItemError() << ")");
+        }
         if(!bulkRequest(event)){
           LOG_FATAL("Failure while processing log : " << event.getLogHandler
           ()->getDescription() << std::endl << event.getJSON());
@@ -76,19 +93,20 @@ void ProjectsElasticSearch::process(std::vector<eBulk>* bulks) {
   }
 }
 
-
 bool ProjectsElasticSearch::bulkRequest(eEvent& event) {
-  if (httpPostRequest(mElasticBulkAddr, event.getJSON()).mSuccess){
-    if(event.getLogHandler()->getType() == LogType::FSLOG){
-      event.getLogHandler()->removeLog(mConn.hopsConnection);
-    }else if(event.getLogHandler()->getType() == LogType::HOPSWORKSLOG){
-      event.getLogHandler()->removeLog(mConn.hopsworksConnection);
-    }
+  //coalesced mutations have no document, only their log is removed
+  if (!event.hasJSON() || httpPostRequest(mElasticBulkAddr, event.getJSON()).mSuccess){
+    cleanLog(event.getLogHandler());
     return true;
   }
   return false;
 }
 
+int ProjectsElasticSearch::removeLogs(std::vector<const LogHandler*>& handlers) {
+  return FsMutationsLogTable().removeLogs(mConn.hopsConnection, handlers)
+      + HopsworksOpsLogTable().removeLogs(mConn.hopsworksConnection, handlers);
+}
+
 ProjectsElasticSearch::~ProjectsElasticSearch() {
 }
 
@@ -61,7 +61,7 @@ Reindexer::Reindexer(const char* connection_string, const char* database_name,
 : ClusterConnectionBase(connection_string, database_name, meta_database_name, hive_meta_database_name),
   mSearchIndex(search_index), mLRUCap(lru_cap) {
   mElasticSearch = new ProjectsElasticSearch(elastic_client_config, elastic_issue_time,
-          elastic_batch_size, false, MConn());
+          elastic_batch_size, 1, false, MConn());
 }
 
 void Reindexer::run() {
@@ -86,7 +86,7 @@ void Reindexer::run() {
 
     if (projectInode.is_equal(project)) {
       eBulk bulk;
-      bulk.push(Utils::getCurrentTime(), project.to_upsert_json(mSearchIndex, projectInode.mId));
+      bulk.push(Utils::getCurrentTime(), project.to_upsert_json(mSearchIndex, projectInode.mId), 1);
       mElasticSearch->addData(bulk);
     } else {
       LOG_WARN("Project [" << project.mId << ", " << project.mInodeName
@@ -105,7 +105,7 @@ void Reindexer::run() {
   while (datasetsTable.next()) {
     DatasetRow dataset = datasetsTable.currRow();
     eBulk bulk;
-    bulk.push(Utils::getCurrentTime(), dataset.to_upsert_json(mSearchIndex));
+    bulk.push(Utils::getCurrentTime(), dataset.to_upsert_json(mSearchIndex), 1);
     mElasticSearch->addData(bulk);
     dsInfoMap[dataset.mInodeId] = DatasetInfo(dataset.mProjectId, dataset.mInodeName);
     totalDatasets++;
@@ -131,27 +131,32 @@ void Reindexer::run() {
     datasetInodeIds.insert(datasetInodeId);
     int datasetInodes = 0;
     while (!dirs.empty()) {
-      Int64 dirInodeId = dirs.front();
-      dirs.pop();
-      LOG_DEBUG("Copy Dir " << dirInodeId << " : remaining " << dirs.size() << " dirs");
+      LVec dirInodeIds;
+      while (!dirs.empty() && dirInodeIds.size() < REINDEX_SCAN_RANGES) {
+        dirInodeIds.push_back(dirs.front());
+        dirs.pop();
+      }
+      LOG_DEBUG("Copy " << dirInodeIds.size() << " Dirs : remaining " << dirs.size() << " dirs");
       //The partition id is the parent id for all files and directories under project subtree
-      INodeVec inodes = inodesTable.getByParentId(conn, dirInodeId, dirInodeId);
-      eBulk bulk;
-      for (INodeVec::iterator it = inodes.begin(); it != inodes.end(); ++it) {
-        INodeRow inode = *it;
-        if (inode.mIsDir) {
-          dirs.push(inode.mId);
+      std::vector<INodeVec> inodesByDir = inodesTable.getByParentIds(conn, dirInodeIds);
+      for (std::vector<INodeVec>::iterator dit = inodesByDir.begin(); dit != inodesByDir.end(); ++dit) {
+        eBulk bulk;
+        for (INodeVec::iterator it = dit->begin(); it != dit->end(); ++it) {
+          INodeRow inode = *it;
+          if (inode.mIsDir) {
+            dirs.push(inode.mId);
+          }
+
+          if(inode.has_xattrs()){
+            inodesWithXAttrs.insert(inode.mId);
+          }
+
+          bulk.push(Utils::getCurrentTime(), inode.to_create_json(mSearchIndex, datasetInodeId, projectId), 1);
+          totalInodes++;
+          datasetInodes++;
         }
-
-        if(inode.has_xattrs()){
-          inodesWithXAttrs.insert(inode.mId);
-        }
-
-        bulk.push(Utils::getCurrentTime(), inode.to_create_json(mSearchIndex, datasetInodeId, projectId));
-        totalInodes++;
-        datasetInodes++;
+        mElasticSearch->addData(bulk);
       }
-      mElasticSearch->addData(bulk);
     }
     datasetStats.push_back(DatasetInodes(datasetInodeId, datasetInodes));
     datasets++;
@@ -172,26 +177,33 @@ void Reindexer::run() {
   int numXAttrs = 0;
   int nonExistentXAttrs = 0;
   int nonExistentXAttrsForDatasets = 0;
-  for(ULSet::iterator it = inodesWithXAttrs.begin(); it != inodesWithXAttrs
-  .end(); ++it){
-    Int64 inodeId = *it;
-    eBulk bulk;
-    XAttrVec xattrs = xAttrTable.getByInodeId(conn, inodeId);
-    for(XAttrVec::iterator xit = xattrs.begin(); xit != xattrs.end(); ++xit){
-      XAttrRow xAttrRow = *xit;
-      if(xAttrRow.mInodeId == inodeId){
-        bulk.push(Utils::getCurrentTime(), xAttrRow.to_upsert_json(mSearchIndex));
-      }else{
-        if(datasetInodeIds.find(inodeId) == datasetInodeIds.end()){
-          LOG_WARN("XAttrs doesn't exists for [" << inodeId << "] - " << xAttrRow.to_string());
-          nonExistentXAttrs++;
+  ULSet::iterator it = inodesWithXAttrs.begin();
+  while(it != inodesWithXAttrs.end()){
+    LVec inodeIds;
+    for(; it != inodesWithXAttrs.end() && inodeIds.size() < REINDEX_SCAN_RANGES; ++it){
+      inodeIds.push_back(*it);
+    }
+    std::vector<XAttrVec> xattrsByInode = xAttrTable.getByInodeIds(conn, inodeIds);
+    for(size_t i = 0; i < inodeIds.size(); i++){
+      Int64 inodeId = inodeIds[i];
+      eBulk bulk;
+      XAttrVec& xattrs = xattrsByInode[i];
+      for(XAttrVec::iterator xit = xattrs.begin(); xit != xattrs.end(); ++xit){
+        XAttrRow xAttrRow = *xit;
+        if(xAttrRow.mInodeId == inodeId){
+          bulk.push(Utils::getCurrentTime(), xAttrRow.to_upsert_json(mSearchIndex), 1);
         }else{
-          LOG_DEBUG("Dataset [" << inodeId << "] does not have Xattrs attached");
-          nonExistentXAttrsForDatasets++;
+          if(datasetInodeIds.find(inodeId) == datasetInodeIds.end()){
+            LOG_WARN("XAttrs doesn't exists for [" << inodeId << "] - " << xAttrRow.to_string());
+            nonExistentXAttrs++;
+          }else{
+            LOG_DEBUG("Dataset [" << inodeId << "] does not have Xattrs attached");
+            nonExistentXAttrsForDatasets++;
+          }
         }
+        mElasticSearch->addData(bulk);
+        numXAttrs++;
       }
-      mElasticSearch->addData(bulk);
-      numXAttrs++;
     }
   }
 
@@ -19,20 +19,33 @@
 
 #include "TimedRestBatcher.h"
 
-TimedRestBatcher::TimedRestBatcher(const HttpClientConfig elastic_client_config, int time_to_wait_before_inserting, int bulk_size)
-    : Batcher(time_to_wait_before_inserting, bulk_size), mToProcessLength(0), mHttpClient(elastic_client_config){
+TimedRestBatcher::TimedRestBatcher(const HttpClientConfig elastic_client_config, int time_to_wait_before_inserting, int bulk_size,
+    int max_in_flight_batches, const std::string pipe_name)
+    : Batcher(time_to_wait_before_inserting, bulk_size), mToProcessLength(0), mHttpClient(elastic_client_config),
+    mPipeName(pipe_name), mMaxInFlight(max_in_flight_batches), mNextBatchIndex(0), mNextToAcknowledge(0), mInFlight(0),
+    mAcknowledging(false), mFlushRequested(false), mBatchController(nullptr){
   mToProcess = new std::vector<eBulk>();
   mShutdown = false;
-  mElasticConnetionFailed = false;
+  mFailingRequests = 0;
   mCurrentQueueSize = 0;
   mToProcessEvents = 0;
+  mQueueGauge = MemoryBudget::getInstance().getGauge(mPipeName, "rest_queue");
+  mPendingGauge = MemoryBudget::getInstance().getGauge(mPipeName, "rest_pending");
+}
+
+const std::string& TimedRestBatcher::getPipeName() const {
+  return mPipeName;
+}
+
+void TimedRestBatcher::setBatchController(BatchController* controller) {
+  mBatchController = controller;
 }
 
 void TimedRestBatcher::addData(eBulk data) {
-  LOG_DEBUG("Add Bulk JSON:" << std::endl << data.batchJSON() << std::endl);
   if(!data.mEvents.empty()){
-    mQueue.push(data);
+    mQueueGauge->add(data.mJSONLength);
     mCurrentQueueSize += data.mEvents.size();
+    mQueue.push(std::move(data));
   }else{
     LOG_DEBUG("Skip empty bulk: " << data.toString());
   }
@@ -41,27 +54,47 @@ void TimedRestBatcher::addData(eBulk data) {
 void TimedRestBatcher::shutdown(){
   LOG_INFO("Shutting down timed rest batcher...");
   mShutdown = true;
+  // wake up the batcher thread to drain the queue
+  mQueue.push(eBulk());
 }
 
 void TimedRestBatcher::run() {
   while (true) {
-    if(mShutdown && mQueue.empty()){
-      LOG_INFO("Shutdown timed rest batcher.");
-      Batcher::shutdown();
-      break;
-    }
     eBulk msg;
     mQueue.wait_and_pop(msg);
+    if (!msg.mEvents.empty()) {
+      mQueueGauge->remove(msg.mJSONLength);
+      mPendingGauge->add(msg.mJSONLength);
 
-    mLock.lock();
-    mToProcess->push_back(msg);
-    mToProcessLength += msg.mJSONLength;
-    mToProcessEvents += msg.mEvents.size();
-    mLock.unlock();
+      mLock.lock();
+      mToProcessLength += msg.mJSONLength;
+      mToProcessEvents += msg.mEvents.size();
+      mToProcess->push_back(std::move(msg));
+      mLock.unlock();
+    }
 
-    if (mToProcessLength >= mBatchSize && !mTimerProcessing) {
+    if (mToProcessLength >= mBatchSize) {
+      resetTimer();
+      processBatch();
+    } else if (mFlushRequested.exchange(false)) {
       processBatch();
     }
+
+    if(mShutdown && mQueue.empty()){
+      processBatch();
+      waitForInFlightBatches();
+      drained();
+      LOG_INFO("Shutdown timed rest batcher.");
+      Batcher::shutdown();
+      break;
+    }
+  }
+}
+
+void TimedRestBatcher::timerExpired() {
+  // the batch is sent from the batcher thread, the scheduler must not block
+  if (!mFlushRequested.exchange(true)) {
+    mQueue.push(eBulk());
   }
 }
 
@@ -77,71 +110,231 @@ void TimedRestBatcher::processBatch() {
     mToProcessEvents = 0;
     mLock.unlock();
 
-    process(data);
+    dispatch(data);
+  }
+}
 
+void TimedRestBatcher::dispatch(std::vector<eBulk>* data) {
+  ptime start_time = Utils::getCurrentTime();
+  if(mMaxInFlight <= 1){
+    bool sent = send(data);
+    acknowledge(data, sent, start_time);
+    observe(data, start_time);
+    released(data);
     delete data;
+    return;
   }
 
-  if(mShutdown){
-    LOG_INFO("Shutting down, remaining " << mQueue.size() << " bulks to process");
-    if(mQueue.empty()){
-      mQueue.push(eBulk());
-      Batcher::shutdown();
+  boost::mutex::scoped_lock lock(mAckLock);
+  if(mSenders.empty()){
+    for(int i = 0; i < mMaxInFlight; i++){
+      mSenders.push_back(new boost::thread(&TimedRestBatcher::sender, this));
+    }
+  }
+  while(mInFlight >= mMaxInFlight){
+    mAckCond.wait(lock);
+  }
+  mInFlight++;
+  eBatch* batch = new eBatch{mNextBatchIndex++, data, false, start_time};
+  LOG_DEBUG("Dispatch batch " << batch->mIndex << ", " << mInFlight << " batches in flight");
+  lock.unlock();
+
+  mSendQueue.push(batch);
+}
+
+void TimedRestBatcher::sender() {
+  while(true){
+    eBatch* batch;
+    mSendQueue.wait_and_pop(batch);
+    if(batch == nullptr){
+      break;
     }
+    batch->mSent = send(batch->mBulks);
+    acknowledgeInOrder(batch);
   }
 }
 
-ParsingResponse TimedRestBatcher::httpPostRequest(std::string requestUrl, std::string json) {
-  LOG_DEBUG("POST " << requestUrl << "\n" << json);
+void TimedRestBatcher::acknowledgeInOrder(eBatch* batch) {
+  boost::mutex::scoped_lock lock(mAckLock);
+  mSentBatches[batch->mIndex] = batch;
+  // only one sender acknowledges at a time, the others just park their batch
+  if(mAcknowledging){
+    return;
+  }
+  mAcknowledging = true;
+  while(true){
+    std::map<Uint64, eBatch*>::iterator it = mSentBatches.find(mNextToAcknowledge);
+    if(it == mSentBatches.end()){
+      break;
+    }
+    eBatch* next = it->second;
+    mSentBatches.erase(it);
+    lock.unlock();
+
+    acknowledge(next->mBulks, next->mSent, next->mStartTime);
+    observe(next->mBulks, next->mStartTime);
+    released(next->mBulks);
+    delete next->mBulks;
+    delete next;
+
+    lock.lock();
+    mNextToAcknowledge++;
+    mInFlight--;
+    mAckCond.notify_all();
+  }
+  mAcknowledging = false;
+}
+
+void TimedRestBatcher::waitForInFlightBatches() {
+  boost::mutex::scoped_lock lock(mAckLock);
+  while(mInFlight > 0){
+    mAckCond.wait(lock);
+  }
+  for(size_t i = 0; i < mSenders.size(); i++){
+    mSendQueue.push(nullptr);
+  }
+}
+
+void TimedRestBatcher::observe(std::vector<eBulk>* data, ptime start_time) {
+  if(mBatchController == nullptr){
+    return;
+  }
+  ptime done = Utils::getCurrentTime();
+  int elastic = Utils::getTimeDiffInMilliseconds(start_time, done);
+  for (const eBulk& bulk : *data) {
+    int ndb = bulk.mEndProcessing.is_not_a_date_time() ? 0 :
+        bulk.getProcessingTimeMS();
+    mBatchController->observe(bulk.getTotalTimeMS(done), ndb, elastic);
+  }
+}
+
+void TimedRestBatcher::released(std::vector<eBulk>* data) {
+  Uint64 bytes = 0;
+  for (const eBulk& bulk : *data) {
+    bytes += bulk.mJSONLength;
+  }
+  mPendingGauge->remove(bytes, data->size());
+}
+
+ParsingResponse TimedRestBatcher::httpPostRequest(std::string requestUrl, const std::string& json) {
+  return httpPostRequest(requestUrl, HttpBufferChain(1, net::buffer(json)));
+}
+
+ParsingResponse TimedRestBatcher::httpPostRequest(std::string requestUrl, const HttpBufferChain& body) {
   ptime t1 = Utils::getCurrentTime();
-  ParsingResponse resp = handleHttpRequestWithRetry(HttpVerb::POST,requestUrl, json);
+  ParsingResponse resp = handleHttpRequestWithRetry(HttpVerb::POST,requestUrl, body);
   ptime t2 = Utils::getCurrentTime();
-  LOG_INFO("POST " << requestUrl << " [" << json.length() << "]  took " <<
+  LOG_INFO("POST " << requestUrl << " [" << net::buffer_size(body) << "]  took " <<
                    Utils::getTimeDiffInMilliseconds(t1, t2) << " msec");
   return resp;
 }
 
 ParsingResponse TimedRestBatcher::httpDeleteRequest(std::string requestUrl) {
   ptime t1 = Utils::getCurrentTime();
-  ParsingResponse resp = handleHttpRequestWithRetry(HttpVerb::DELETE,requestUrl, "");
+  ParsingResponse resp = handleHttpRequestWithRetry(HttpVerb::DELETE,requestUrl, HttpBufferChain());
   ptime t2 = Utils::getCurrentTime();
   LOG_INFO("DELETE " << requestUrl << " took " <<
                      Utils::getTimeDiffInMilliseconds(t1, t2) << " msec");
   return resp;
 }
 
+bool TimedRestBatcher::setBulkItemStatus(std::vector<eBulk>* data,
+    const ParsingResponse& response) {
+  if (response.mItemErrors.empty()) {
+    return false;
+  }
+  Uint32 items = 0;
+  for (const eBulk& bulk : *data) {
+    for (const eEvent& event : bulk.mEvents) {
+      items += event.getBulkItems();
+    }
+  }
+  if (items != response.mItems) {
+    LOG_ERROR("bulk response has " << response.mItems << " items but "
+        << items << " were sent, retrying all the events of the batch");
+    return false;
+  }
+  std::vector<BulkItemError>::const_iterator error = response.mItemErrors.begin();
+  Uint32 item = 0;
+  for (eBulk& bulk : *data) {
+    for (eEvent& event : bulk.mEvents) {
+      item += event.getBulkItems();
+      if (error != response.mItemErrors.end() && error->mItem < item) {
+        event.setItemStatus(eEvent::ItemStatus::ItemFailed, error->mError);
+        while (error != response.mItemErrors.end() && error->mItem < item) {
+          ++error;
+        }
+      } else {
+        event.setItemStatus(eEvent::ItemStatus::ItemSucceeded);
+      }
+    }
+  }
+  return true;
+}
 
 ParsingResponse TimedRestBatcher::handleHttpRequestWithRetry(HttpVerb verb,
-    std::string requestUrl, std::string json){
-  ParsingResponse pr = {false, false, ""};
-  do {
+    std::string requestUrl, const HttpBufferChain& body){
+  ParsingResponse pr = {false, false, "", {}, 0};
+  // the retry state is per request, senders retry concurrently
+  bool failed = false;
+  ptime firstFailure;
+  while(true) {
     HttpResponse res;
     if(verb == HttpVerb::POST) {
-      res = mHttpClient.post(requestUrl, json);
+      res = mHttpClient.post(requestUrl, body);
     }else if (verb == HttpVerb::DELETE){
       res = mHttpClient.delete_(requestUrl);
     }
     if(res.mSuccess){
       pr = parseResponse(res.mResponse);
-      mElasticConnetionFailed = pr.mRetryable;
       if(!pr.mRetryable){
-        return pr;
+        break;
       }
     }
 
-    if(!mElasticConnetionFailed){
-      mTimeElasticConnectionFailed = Utils::getCurrentTime();
+    if(!failed){
+      failed = true;
+      firstFailure = Utils::getCurrentTime();
+      elasticConnectionFailed(firstFailure);
     }
-    mElasticConnetionFailed = true;
     LOG_ERROR("Failed to connect to elastic, " << Utils::getTimeDiffInSeconds
-        (mTimeElasticConnectionFailed, Utils::getCurrentTime())
+        (firstFailure, Utils::getCurrentTime())
                                                << " seconds have passed since first failure");
-    boost::this_thread::sleep(boost::posix_time::milliseconds(mTimeToWait));
+    boost::this_thread::sleep(boost::posix_time::milliseconds(getTimeToWait()));
+  }
 
-  } while(mElasticConnetionFailed);
+  if(failed){
+    elasticConnectionRecovered();
+  }
   return pr;
 }
 
+void TimedRestBatcher::elasticConnectionFailed(ptime failedAt) {
+  boost::mutex::scoped_lock lock(mLock);
+  if(mFailingRequests == 0 || failedAt < mTimeElasticConnectionFailed){
+    mTimeElasticConnectionFailed = failedAt;
+  }
+  mFailingRequests++;
+}
+
+void TimedRestBatcher::elasticConnectionRecovered() {
+  boost::mutex::scoped_lock lock(mLock);
+  mFailingRequests--;
+}
+
+bool TimedRestBatcher::getElasticConnectionFailure(ptime& failedSince) {
+  boost::mutex::scoped_lock lock(mLock);
+  failedSince = mTimeElasticConnectionFailed;
+  return mFailingRequests > 0;
+}
+
 TimedRestBatcher::~TimedRestBatcher() {
+  for(size_t i = 0; i < mSenders.size(); i++){
+    mSendQueue.push(nullptr);
+  }
+  for(boost::thread* sender : mSenders){
+    sender->join();
+    delete sender;
+  }
 
 }
\ No newline at end of file
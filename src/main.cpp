@@ -38,12 +38,17 @@ int main(int argc, char** argv) {
     LogSeverityLevel log_level = LogSeverityLevel::info;
 
     TableUnitConf mutations_tu = TableUnitConf();
+    int mutations_partitions = 1;
     TableUnitConf provenance_tu = TableUnitConf();
 
     bool hopsworks = true;
     std::string elastic_index = "projects";
     int elastic_batch_size = 5000;
     int elastic_issue_time = 5000;
+    int elastic_max_in_flight = 1;
+    int batch_target_latency = 0;
+    int elastic_max_bulk = 10 * 1024 * 1024;
+    int memory_budget_mb = 1024;
 
     std::string elastic_featurestore_index = "featurestore";
     std::string elastic_app_provenance_index = "appprovenance";
@@ -51,10 +56,17 @@ int main(int argc, char** argv) {
     int lru_cap = DEFAULT_MAX_CAPACITY;
     int prov_file_lru_cap = DEFAULT_MAX_CAPACITY;
     int prov_core_lru_cap = 100;
+    int ndb_async_batches = 1;
     bool recovery = true;
     bool stats = true;
 
     Barrier barrier = EPOCH;
+    EpochGroupConf epoch_group = EpochGroupConf();
+
+    EventSourceConf event_source = EventSourceConf();
+    std::string event_source_dir = ".";
+    bool replay_max_speed = false;
+    std::string checkpoint_dir = "";
 
     bool reindex = false;
     std::string reindex_of = "all";
@@ -99,6 +111,9 @@ int main(int argc, char** argv) {
          po::value<std::vector<int> >()->default_value(mutations_tu.getVector(),
                                                   mutations_tu.getString())->multitoken(),
          "WAIT_TIME BATCH_SIZE NUM_READERS")
+        ("fs_mutations_partitions",
+         po::value<int>(&mutations_partitions)->default_value(mutations_partitions),
+         "number of fs mutations pipelines, events are partitioned by inode so that independent inodes are processed in parallel")
         ("provenance_tu",
          po::value<std::vector<int> >()->default_value(provenance_tu.getVector(),
                                                   provenance_tu.getString())->multitoken(),
@@ -120,9 +135,24 @@ int main(int argc, char** argv) {
         ("ewait_time",
          po::value<int>(&elastic_issue_time)->default_value(elastic_issue_time),
          "time to wait in miliseconds before issuing a bulk request to Elasticsearch if the batch size wasn't reached")
+        ("elastic_max_inflight",
+         po::value<int>(&elastic_max_in_flight)->default_value(elastic_max_in_flight),
+         "max number of bulk requests to Elasticsearch in flight per pipeline, logs are still removed in order")
+        ("batch_target_latency",
+         po::value<int>(&batch_target_latency)->default_value(batch_target_latency),
+         "target end to end latency in miliseconds, the batch sizes and wait times are adapted at runtime to meet it. 0 keeps them static")
+        ("elastic_max_bulk",
+         po::value<int>(&elastic_max_bulk)->default_value(elastic_max_bulk),
+         "max size in bytes of an Elasticsearch bulk request when the batch sizes are adapted")
+        ("memory_budget",
+         po::value<int>(&memory_budget_mb)->default_value(memory_budget_mb),
+         "memory budget in MB of all the queues between the table tailers and Elasticsearch, the tailers stop polling NDB while it is exhausted. 0 is unbounded")
         ("lru_cap", po::value<int>(&lru_cap)->default_value(lru_cap), "LRU Cache max capacity")
         ("prov_file_lru_cap", po::value<int>(&prov_file_lru_cap)->default_value(prov_file_lru_cap), "Prov File LRU Cache max capacity")
         ("prov_core_lru_cap", po::value<int>(&prov_core_lru_cap)->default_value(prov_core_lru_cap), "Prov Core LRU Cache max capacity")
+        ("ndb_async_batches",
+         po::value<int>(&ndb_async_batches)->default_value(ndb_async_batches),
+         "max number of queued batches per data reader whose inode reads are sent together on the NDB asynchronous api. 1 keeps all reads synchronous")
         ("recovery", po::value<bool>(&recovery)->default_value(recovery),
          "enable or disable startup recovery")
         ("stats", po::value<bool>(&stats)->default_value(stats),
@@ -131,6 +161,18 @@ int main(int argc, char** argv) {
             (metricsServer),"binding ip and port for the metrics server")
         ("barrier", po::value<int>()->default_value(barrier),
          "Table tailer barrier type. EPOCH=0, GCI=1")
+        ("epoch_group",
+         po::value<std::vector<int> >()->default_value(epoch_group.getVector(),
+                                                  epoch_group.getString())->multitoken(),
+         "MAX_ROWS MAX_BYTES MAX_HOLD_TIME consecutive barriers are grouped until MAX_ROWS rows or MAX_BYTES bytes are reached or MAX_HOLD_TIME miliseconds passed. 0 for MAX_HOLD_TIME releases every barrier on its own")
+        ("event_source", po::value<int>()->default_value(event_source.mMode),
+         "Table tailer event source. LIVE=0, CAPTURE=1, REPLAY=2")
+        ("event_source_dir", po::value<std::string>(&event_source_dir)->default_value(event_source_dir),
+         "directory to write captured events to or to replay them from")
+        ("replay_max_speed", po::value<bool>(&replay_max_speed)->default_value(replay_max_speed),
+         "replay captured events as fast as possible instead of at the recorded speed")
+        ("checkpoint_dir", po::value<std::string>(&checkpoint_dir)->default_value(checkpoint_dir),
+         "directory to persist the highest removed epoch of each log table to, the recovery then skips the rows up to it. Empty disables it")
         ("reindex", po::value<bool>(&reindex)->default_value(reindex),
          "initialize an empty index with all metadata")
         ("reindex_of", po::value<std::string>(&reindex_of)->default_value(reindex_of),
@@ -193,6 +235,15 @@ int main(int argc, char** argv) {
       barrier = static_cast<Barrier> (vm["barrier"].as<int>());
     }
 
+    if (vm.count("epoch_group")) {
+      epoch_group.update(vm["epoch_group"].as<std::vector<int> >());
+    }
+
+    if (vm.count("event_source")) {
+      event_source = EventSourceConf(static_cast<EventSourceMode> (vm["event_source"].as<int>()),
+          event_source_dir, replay_max_speed);
+    }
+
     if (vm.count("log_level")) {
       log_level = static_cast<LogSeverityLevel> (vm["log_level"].as<int>());
     }
@@ -242,13 +293,13 @@ int main(int argc, char** argv) {
                                        database_name.c_str(),
                                        meta_database_name.c_str(),
                                        hive_meta_database_name.c_str(),
-                                       mutations_tu, provenance_tu,
+                                       mutations_tu, mutations_partitions, provenance_tu,
                                        poll_maxTimeToWait, config,
                                        hopsworks, elastic_index, elastic_featurestore_index,
                                        elastic_app_provenance_index,
                                        elastic_batch_size, elastic_issue_time,
-                                       lru_cap, prov_file_lru_cap, prov_core_lru_cap,
-                                       recovery, stats, barrier,
+                                       elastic_max_in_flight, batch_target_latency, elastic_max_bulk, memory_budget_mb, lru_cap, prov_file_lru_cap, prov_core_lru_cap,
+                                       ndb_async_batches, recovery, stats, barrier, epoch_group, event_source, checkpoint_dir,
                                        hiveCleaner, metricsServer);
       notifer->start();
     }